@@ -41,6 +41,37 @@ input_getc (void)
   return key;
 }
 
+/* Retrieves a key from the input buffer, like input_getc(), but
+   if it has to wait, gives up and returns -1 as soon as STOP
+   returns true.  STOP is checked again whenever input_wake() is
+   called with the same TAG (see intq_getc_unless()). */
+int
+input_getc_unless (bool (*stop) (void), void *tag)
+{
+  enum intr_level old_level;
+  int key;
+
+  old_level = intr_disable ();
+  key = intq_getc_unless (&buffer, stop, tag);
+  serial_notify ();
+  intr_set_level (old_level);
+
+  return key;
+}
+
+/* Wakes the thread, if any, waiting for a key in
+   input_getc_unless() with TAG, so that it checks whether to give
+   up. */
+void
+input_wake (void *tag)
+{
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  intq_wake (&buffer, tag);
+  intr_set_level (old_level);
+}
+
 /* Returns true if the input buffer is full,
    false otherwise.
    Interrupts must be off. */
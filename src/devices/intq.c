@@ -12,6 +12,7 @@ intq_init (struct intq *q)
 {
   lock_init (&q->lock);
   q->not_full = q->not_empty = NULL;
+  q->not_empty_tag = NULL;
   q->head = q->tail = 0;
 }
 
@@ -54,6 +55,48 @@ intq_getc (struct intq *q)
   return byte;
 }
 
+/* Like intq_getc(), but if Q is empty, gives up and returns -1
+   as soon as STOP returns true.  STOP is called before sleeping
+   and each time intq_wake() wakes the thread, which it does
+   only if given the same TAG, a nonnull pointer that identifies
+   whoever may want the wait to stop. */
+int
+intq_getc_unless (struct intq *q, bool (*stop) (void), void *tag)
+{
+  ASSERT (tag != NULL);
+  ASSERT (intr_get_level () == INTR_OFF);
+  while (intq_empty (q))
+    {
+      ASSERT (!intr_context ());
+      if (stop ())
+        return -1;
+      lock_acquire (&q->lock);
+      if (intq_empty (q) && !stop ())
+        {
+          q->not_empty_tag = tag;
+          wait (q, &q->not_empty);
+          q->not_empty_tag = NULL;
+        }
+      lock_release (&q->lock);
+    }
+
+  return intq_getc (q);
+}
+
+/* Wakes the thread, if any, sleeping in intq_getc_unless() until
+   a byte is added to Q, if it gave TAG, so that it gives up if
+   its STOP now returns true. */
+void
+intq_wake (struct intq *q, void *tag)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  if (q->not_empty != NULL && q->not_empty_tag == tag)
+    {
+      thread_unblock (q->not_empty);
+      q->not_empty = NULL;
+    }
+}
+
 /* Adds BYTE to the end of Q.
    If Q is full, sleeps until a byte is removed.
    When called from an interrupt handler, Q must not be full. */
@@ -27,6 +27,7 @@ struct intq
     struct lock lock;           /* Only one thread may wait at once. */
     struct thread *not_full;    /* Thread waiting for not-full condition. */
     struct thread *not_empty;   /* Thread waiting for not-empty condition. */
+    void *not_empty_tag;        /* Its tag, see intq_getc_unless(). */
 
     /* Queue. */
     uint8_t buf[INTQ_BUFSIZE];  /* Buffer. */
@@ -38,6 +39,8 @@ void intq_init (struct intq *);
 bool intq_empty (const struct intq *);
 bool intq_full (const struct intq *);
 uint8_t intq_getc (struct intq *);
+int intq_getc_unless (struct intq *, bool (*stop) (void), void *tag);
+void intq_wake (struct intq *, void *tag);
 void intq_putc (struct intq *, uint8_t);
 
 #endif /* devices/intq.h */
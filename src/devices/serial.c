@@ -33,6 +33,13 @@
 #define MCR_REG (IO_BASE + 4)   /* MODEM Control Register. */
 #define LSR_REG (IO_BASE + 5)   /* Line Status Register (read-only). */
 
+/* Interrupt Identification Register bits. */
+#define IIR_FIFO 0xc0           /* FIFOs enabled. */
+
+/* FIFO Control Register bits. */
+#define FCR_ENABLE 0x01         /* Enable FIFOs. */
+#define FCR_CLEAR 0x06          /* Clear receive and transmit FIFOs. */
+
 /* Interrupt Enable Register bits. */
 #define IER_RECV 0x01           /* Interrupt when data received. */
 #define IER_XMIT 0x02           /* Interrupt when transmit finishes. */
@@ -47,6 +54,7 @@
 /* Line Status Register. */
 #define LSR_DR 0x01             /* Data Ready: received data byte is in RBR. */
 #define LSR_THRE 0x20           /* THR Empty. */
+#define LSR_TEMT 0x40           /* Transmitter empty, FIFO included. */
 
 /* Transmission mode. */
 static enum { UNINIT, POLL, QUEUE } mode;
@@ -54,8 +62,21 @@ static enum { UNINIT, POLL, QUEUE } mode;
 /* Data to be transmitted. */
 static struct intq txq;
 
+/* Size of the transmit FIFO: 16 on a 16550A, 1 on older UARTs
+   without a working FIFO.  When the UART reports its transmitter
+   empty, this many bytes can be written to it back to back. */
+#define FIFO_SIZE 16
+static int tx_fifo_size;
+
+/* Number of bytes that can still be written to the transmit FIFO
+   without checking the UART.  The FIFO only drains, so this never
+   overstates the room in it. */
+static int tx_room;
+
 static void set_serial (int bps);
 static void putc_poll (uint8_t);
+static bool tx_ready (void);
+static void xmit_queue (void);
 static void write_ier (void);
 static intr_handler_func serial_interrupt;
 
@@ -68,7 +89,8 @@ init_poll (void)
 {
   ASSERT (mode == UNINIT);
   outb (IER_REG, 0);                    /* Turn off all interrupts. */
-  outb (FCR_REG, 0);                    /* Disable FIFO. */
+  outb (FCR_REG, FCR_ENABLE | FCR_CLEAR); /* Enable FIFO, if any. */
+  tx_fifo_size = (inb (IIR_REG) & IIR_FIFO) == IIR_FIFO ? FIFO_SIZE : 1;
   set_serial (9600);                    /* 9.6 kbps, N-8-1. */
   outb (MCR_REG, MCR_OUT2);             /* Required to enable interrupts. */
   intq_init (&txq);
@@ -98,31 +120,53 @@ serial_init_queue (void)
 void
 serial_putc (uint8_t byte) 
 {
+  serial_write (&byte, 1);
+}
+
+/* Sends the SIZE bytes in BUFFER to the serial port.  Interrupts
+   are disabled once for the whole buffer rather than once per
+   byte, and the transmit FIFO is filled in bursts. */
+void
+serial_write (const void *buffer, size_t size) 
+{
+  const uint8_t *p = buffer;
   enum intr_level old_level = intr_disable ();
 
   if (mode != QUEUE)
     {
       /* If we're not set up for interrupt-driven I/O yet,
-         use dumb polling to transmit a byte. */
+         use dumb polling to transmit. */
       if (mode == UNINIT)
         init_poll ();
-      putc_poll (byte); 
+      while (size-- > 0)
+        putc_poll (*p++); 
     }
   else 
     {
-      /* Otherwise, queue a byte and update the interrupt enable
-         register. */
-      if (old_level == INTR_OFF && intq_full (&txq)) 
+      /* Otherwise, queue the bytes and update the interrupt
+         enable register. */
+      while (size-- > 0)
         {
-          /* Interrupts are off and the transmit queue is full.
-             If we wanted to wait for the queue to empty,
-             we'd have to reenable interrupts.
-             That's impolite, so we'll send a character via
-             polling instead. */
-          putc_poll (intq_getc (&txq)); 
+          if (intq_full (&txq))
+            {
+              xmit_queue ();
+              write_ier ();
+              if (old_level == INTR_OFF && intq_full (&txq)) 
+                {
+                  /* Interrupts are off and the transmit queue is
+                     full.  If we wanted to wait for the queue to
+                     empty, we'd have to reenable interrupts.
+                     That's impolite, so we'll send a character
+                     via polling instead. */
+                  putc_poll (intq_getc (&txq)); 
+                }
+            }
+          intq_putc (&txq, *p++); 
         }
 
-      intq_putc (&txq, byte); 
+      /* Start sending right away if the UART is idle, instead of
+         waiting for it to interrupt. */
+      xmit_queue ();
       write_ier ();
     }
   
@@ -130,13 +174,16 @@ serial_putc (uint8_t byte)
 }
 
 /* Flushes anything in the serial buffer out the port in polling
-   mode. */
+   mode, and waits for the UART to finish sending it. */
 void
 serial_flush (void) 
 {
   enum intr_level old_level = intr_disable ();
   while (!intq_empty (&txq))
     putc_poll (intq_getc (&txq));
+  if (mode != UNINIT)
+    while ((inb (LSR_REG) & LSR_TEMT) == 0)
+      continue;
   intr_set_level (old_level);
 }
 
@@ -200,9 +247,33 @@ putc_poll (uint8_t byte)
 {
   ASSERT (intr_get_level () == INTR_OFF);
 
-  while ((inb (LSR_REG) & LSR_THRE) == 0)
+  while (!tx_ready ())
     continue;
   outb (THR_REG, byte);
+  tx_room--;
+}
+
+/* Returns true if the transmit FIFO has room for a byte. */
+static bool
+tx_ready (void) 
+{
+  if (tx_room == 0 && (inb (LSR_REG) & LSR_THRE) != 0)
+    tx_room = tx_fifo_size;
+  return tx_room > 0;
+}
+
+/* Moves bytes from the transmit queue to the UART for as long as
+   it has room for them. */
+static void
+xmit_queue (void) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (!intq_empty (&txq) && tx_ready ()) 
+    {
+      outb (THR_REG, intq_getc (&txq));
+      tx_room--;
+    }
 }
 
 /* Serial interrupt handler. */
@@ -220,8 +291,7 @@ serial_interrupt (struct intr_frame *f UNUSED)
 
   /* As long as we have a byte to transmit, and the hardware is
      ready to accept a byte for transmission, transmit a byte. */
-  while (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0) 
-    outb (THR_REG, intq_getc (&txq));
+  xmit_queue ();
 
   /* Update interrupt enable register based on queue status. */
   write_ier ();
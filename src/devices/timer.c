@@ -7,6 +7,9 @@
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#ifdef USERPROG
+#include "userprog/vdso.h"
+#endif
   
 /* See [8254] for hardware details of the 8254 timer chip. */
 
@@ -180,6 +183,11 @@ timer_interrupt (struct intr_frame *args UNUSED)
 {
   ticks++;
   thread_tick (ticks);
+#ifdef USERPROG
+  /* After thread_tick(), so that it publishes a fresh load
+     average. */
+  vdso_tick (ticks);
+#endif
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
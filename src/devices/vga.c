@@ -50,50 +50,66 @@ init (void)
    characters in the conventional ways.  */
 void
 vga_putc (int c)
+{
+  char ch = c;
+
+  vga_write (&ch, 1);
+}
+
+/* Writes the SIZE characters in BUFFER to the VGA text display.
+   The hardware cursor, which takes slow port I/O to move, is
+   only updated once, at the end. */
+void
+vga_write (const char *buffer, size_t size)
 {
   /* Disable interrupts to lock out interrupt handlers
      that might write to the console. */
   enum intr_level old_level = intr_disable ();
 
   init ();
-  
-  switch (c) 
+
+  while (size-- > 0)
     {
-    case '\n':
-      newline ();
-      break;
-
-    case '\f':
-      cls ();
-      break;
-
-    case '\b':
-      if (cx > 0)
-        cx--;
-      break;
+      uint8_t c = *buffer++;
+
+      switch (c) 
+        {
+        case '\n':
+          newline ();
+          break;
+
+        case '\f':
+          cls ();
+          break;
+
+        case '\b':
+          if (cx > 0)
+            cx--;
+          break;
       
-    case '\r':
-      cx = 0;
-      break;
-
-    case '\t':
-      cx = ROUND_UP (cx + 1, 8);
-      if (cx >= COL_CNT)
-        newline ();
-      break;
-
-    case '\a':
-      intr_set_level (old_level);
-      speaker_beep ();
-      intr_disable ();
-      break;
+        case '\r':
+          cx = 0;
+          break;
+
+        case '\t':
+          cx = ROUND_UP (cx + 1, 8);
+          if (cx >= COL_CNT)
+            newline ();
+          break;
+
+        case '\a':
+          intr_set_level (old_level);
+          speaker_beep ();
+          intr_disable ();
+          break;
       
-    default:
-      fb[cy][cx][0] = c;
-      fb[cy][cx][1] = GRAY_ON_BLACK;
-      if (++cx >= COL_CNT)
-        newline ();
-      break;
+        default:
+          fb[cy][cx][0] = c;
+          fb[cy][cx][1] = GRAY_ON_BLACK;
+          if (++cx >= COL_CNT)
+            newline ();
+          break;
+        }
     }
 
   /* Update cursor position. */
@@ -101,7 +117,7 @@ vga_putc (int c)
 
   intr_set_level (old_level);
 }
-
+
 /* Clears the screen and moves the cursor to the upper left. */
 static void
 cls (void)
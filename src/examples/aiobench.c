@@ -0,0 +1,134 @@
+/* aiobench.c
+
+   Reads a file a page at a time and does some computation on
+   each page, first with blocking pread() calls and then through
+   asynchronous I/O rings, which let the reads of later pages
+   overlap the computation on earlier ones.  Reports CPU cycles
+   for each way, and for the I/O and computation alone.
+
+   Usage: aiobench [WORK] [DEPTH] */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include <tsc.h>
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 32
+#define FILE_SIZE (PAGE_CNT * PAGE_SIZE)
+#define RING_SIZE 16
+
+static char bufs[PAGE_CNT][PAGE_SIZE];
+static struct aio_sqe sqes[RING_SIZE];
+static struct aio_cqe cqes[RING_SIZE];
+static struct aio_ring ring = {0, 0, 0, 0, RING_SIZE, sqes, cqes};
+
+/* Does WORK rounds of computation on page PAGE. */
+static unsigned
+compute (const char *page, int work)
+{
+  unsigned sum = 0;
+  int i, j;
+
+  for (i = 0; i < work; i++)
+    for (j = 0; j < PAGE_SIZE; j += 64)
+      sum = sum * 31 + page[j];
+  return sum;
+}
+
+/* Queues a read of page PAGE of file FD. */
+static void
+queue_read (int fd, int page)
+{
+  struct aio_sqe *sqe = &sqes[ring.sq_tail % RING_SIZE];
+
+  sqe->op = AIO_READ;
+  sqe->fd = fd;
+  sqe->buf = bufs[page];
+  sqe->len = PAGE_SIZE;
+  sqe->offset = page * PAGE_SIZE;
+  sqe->user_data = page;
+  ring.sq_tail++;
+}
+
+int
+main (int argc, char *argv[])
+{
+  int work = argc > 1 ? atoi (argv[1]) : 4;
+  int depth = argc > 2 ? atoi (argv[2]) : 8;
+  uint64_t start, io_cycles, work_cycles, sync_cycles, async_cycles;
+  unsigned sum = 0;
+  int submitted, completed;
+  int fd;
+  int i;
+
+  if (work < 0 || depth <= 0 || depth > RING_SIZE)
+    {
+      printf ("usage: aiobench [WORK] [DEPTH]\n");
+      return EXIT_FAILURE;
+    }
+  if (!create ("aiobench.tmp", FILE_SIZE))
+    {
+      printf ("aiobench: create failed\n");
+      return EXIT_FAILURE;
+    }
+  fd = open ("aiobench.tmp");
+  if (fd < 0 || !aio_setup (&ring))
+    {
+      printf ("aiobench: setup failed\n");
+      return EXIT_FAILURE;
+    }
+
+  start = rdtsc ();
+  for (i = 0; i < PAGE_CNT; i++)
+    pread (fd, bufs[i], PAGE_SIZE, i * PAGE_SIZE);
+  io_cycles = rdtsc () - start;
+
+  start = rdtsc ();
+  for (i = 0; i < PAGE_CNT; i++)
+    sum += compute (bufs[i], work);
+  work_cycles = rdtsc () - start;
+
+  start = rdtsc ();
+  for (i = 0; i < PAGE_CNT; i++)
+    {
+      pread (fd, bufs[i], PAGE_SIZE, i * PAGE_SIZE);
+      sum += compute (bufs[i], work);
+    }
+  sync_cycles = rdtsc () - start;
+
+  start = rdtsc ();
+  submitted = completed = 0;
+  while (completed < PAGE_CNT)
+    {
+      while (submitted < PAGE_CNT && submitted - completed < depth)
+        queue_read (fd, submitted++);
+      aio_enter (1);
+      while (ring.cq_head != ring.cq_tail)
+        {
+          struct aio_cqe *cqe = &cqes[ring.cq_head % RING_SIZE];
+
+          if (cqe->result != PAGE_SIZE)
+            {
+              printf ("aiobench: read of page %u failed\n", cqe->user_data);
+              return EXIT_FAILURE;
+            }
+          sum += compute (bufs[cqe->user_data], work);
+          ring.cq_head++;
+          completed++;
+        }
+    }
+  async_cycles = rdtsc () - start;
+
+  printf ("%d pages, work %d, depth %d (checksum %u)\n",
+          PAGE_CNT, work, depth, sum);
+  printf ("%-20s %14llu\n", "reads alone", io_cycles);
+  printf ("%-20s %14llu\n", "computation alone", work_cycles);
+  printf ("%-20s %14llu\n", "pread+compute", sync_cycles);
+  printf ("%-20s %14llu\n", "aio+compute", async_cycles);
+
+  close (fd);
+  remove ("aiobench.tmp");
+  return EXIT_SUCCESS;
+}
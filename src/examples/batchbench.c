@@ -0,0 +1,87 @@
+/* batchbench.c
+
+   Compares making small system calls one at a time with making
+   them in batches through batch(), in CPU cycles per call.  Each
+   round is tell(), filesize(), seek() and a zero-length write()
+   to the console, the kind of calls that cost little besides the
+   trap itself.
+
+   Usage: batchbench [ITERATIONS] */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include <syscall-nr.h>
+#include <tsc.h>
+
+#define CALLS_PER_ROUND 4
+#define MAX_ROUNDS 16
+
+static struct syscall_rec recs[CALLS_PER_ROUND * MAX_ROUNDS];
+
+int
+main (int argc, char *argv[])
+{
+  int iterations = argc > 1 ? atoi (argv[1]) : 1000;
+  uint64_t start, cycles;
+  struct batch b;
+  int rounds, calls;
+  int fd;
+  int i, j;
+
+  if (iterations <= 0)
+    {
+      printf ("usage: batchbench [ITERATIONS]\n");
+      return EXIT_FAILURE;
+    }
+  if (!create ("batchbench.tmp", 512)
+      || (fd = open ("batchbench.tmp")) < 0)
+    {
+      printf ("batchbench: create failed\n");
+      return EXIT_FAILURE;
+    }
+
+  start = rdtsc ();
+  for (i = 0; i < iterations; i++)
+    {
+      tell (fd);
+      filesize (fd);
+      seek (fd, 0);
+      write (STDOUT_FILENO, "", 0);
+    }
+  cycles = rdtsc () - start;
+  printf ("%-16s %12llu\n", "single calls",
+          cycles / (iterations * CALLS_PER_ROUND));
+
+  for (rounds = 1; rounds <= MAX_ROUNDS; rounds *= 2)
+    {
+      batch_init (&b, recs, rounds * CALLS_PER_ROUND);
+      calls = 0;
+      start = rdtsc ();
+      for (i = 0; i < iterations; i += rounds)
+        {
+          for (j = 0; j < rounds; j++)
+            {
+              batch_add (&b, SYS_TELL, 1, fd);
+              batch_add (&b, SYS_FILESIZE, 1, fd);
+              batch_add (&b, SYS_SEEK, 2, fd, 0);
+              batch_add (&b, SYS_WRITE, 3, STDOUT_FILENO, "", 0);
+            }
+          if (batch_run (&b, BATCH_STOP_ON_ERROR)
+              != rounds * CALLS_PER_ROUND)
+            {
+              printf ("batchbench: batch stopped early\n");
+              return EXIT_FAILURE;
+            }
+          calls += rounds * CALLS_PER_ROUND;
+        }
+      cycles = rdtsc () - start;
+      printf ("batch of %-7d %12llu\n", rounds * CALLS_PER_ROUND,
+              cycles / calls);
+    }
+
+  close (fd);
+  remove ("batchbench.tmp");
+  return EXIT_SUCCESS;
+}
@@ -1,33 +1,44 @@
 /* cat.c
 
-   Prints files specified on command line to the console. */
+   Prints files specified on command line to the console, or
+   standard input if there are none, so that cat can end a
+   pipeline. */
 
 #include <stdio.h>
 #include <syscall.h>
 
+/* Copies FD to standard output until end of file. */
+static void
+copy_out (int fd)
+{
+  for (;;)
+    {
+      char buffer[1024];
+      int bytes_read = read (fd, buffer, sizeof buffer);
+      if (bytes_read <= 0)
+        break;
+      write (STDOUT_FILENO, buffer, bytes_read);
+    }
+}
+
 int
-main (int argc, char *argv[]) 
+main (int argc, char *argv[])
 {
   bool success = true;
   int i;
-  
-  for (i = 1; i < argc; i++) 
+
+  if (argc == 1)
+    copy_out (STDIN_FILENO);
+  for (i = 1; i < argc; i++)
     {
       int fd = open (argv[i]);
-      if (fd < 0) 
+      if (fd < 0)
         {
           printf ("%s: open failed\n", argv[i]);
           success = false;
           continue;
         }
-      for (;;) 
-        {
-          char buffer[1024];
-          int bytes_read = read (fd, buffer, sizeof buffer);
-          if (bytes_read == 0)
-            break;
-          write (STDOUT_FILENO, buffer, bytes_read);
-        }
+      copy_out (fd);
       close (fd);
     }
   return success ? EXIT_SUCCESS : EXIT_FAILURE;
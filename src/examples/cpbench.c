@@ -0,0 +1,81 @@
+/* cpbench.c
+
+   Compares copying a file with a loop of read() and write()
+   calls through a user buffer against copy_file_range(), which
+   moves the data inside the kernel.  Reports CPU cycles per
+   copy of a FILE_SIZE-byte file for several user buffer sizes.
+
+   Usage: cpbench [ITERATIONS] */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include <tsc.h>
+
+#define FILE_SIZE (64 * 1024)
+
+static char buf[4096];
+
+int
+main (int argc, char *argv[])
+{
+  int iterations = argc > 1 ? atoi (argv[1]) : 20;
+  uint64_t start, cycles;
+  int in_fd, out_fd;
+  int size;
+  int i;
+
+  if (iterations <= 0)
+    {
+      printf ("usage: cpbench [ITERATIONS]\n");
+      return EXIT_FAILURE;
+    }
+  if (!create ("cpbench.in", FILE_SIZE) || !create ("cpbench.out", FILE_SIZE))
+    {
+      printf ("cpbench: create failed\n");
+      return EXIT_FAILURE;
+    }
+  in_fd = open ("cpbench.in");
+  out_fd = open ("cpbench.out");
+  if (in_fd < 0 || out_fd < 0)
+    {
+      printf ("cpbench: open failed\n");
+      return EXIT_FAILURE;
+    }
+
+  printf ("%-24s %14s\n", "method", "cycles/copy");
+  for (size = 512; size <= (int) sizeof buf; size *= 2)
+    {
+      start = rdtsc ();
+      for (i = 0; i < iterations; i++)
+        {
+          int n;
+
+          seek (in_fd, 0);
+          seek (out_fd, 0);
+          while ((n = read (in_fd, buf, size)) > 0)
+            write (out_fd, buf, n);
+        }
+      cycles = rdtsc () - start;
+      printf ("read+write %5d bytes   %14llu\n", size,
+              cycles / iterations);
+    }
+
+  start = rdtsc ();
+  for (i = 0; i < iterations; i++)
+    {
+      seek (in_fd, 0);
+      seek (out_fd, 0);
+      while (copy_file_range (in_fd, out_fd, FILE_SIZE) > 0)
+        continue;
+    }
+  cycles = rdtsc () - start;
+  printf ("%-24s %14llu\n", "copy_file_range", cycles / iterations);
+
+  close (in_fd);
+  close (out_fd);
+  remove ("cpbench.in");
+  remove ("cpbench.out");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,57 @@
+/* execbench.c
+
+   Measures how fast processes can be started: runs a trivial
+   program, this one with a "child" argument, COUNT times one
+   after another, waiting for each, and reports execs per second
+   and CPU cycles per exec.  Every exec after the first should
+   find the program in the kernel's exec cache.  That the cache
+   runs the right image is checked by the exec-cache and
+   exec-recreate tests; this only measures how fast it is.
+
+   Usage: execbench [COUNT] */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include <tsc.h>
+
+int
+main (int argc, char *argv[])
+{
+  int count = 100;
+  uint64_t start, cycles;
+  int64_t start_usecs, usecs;
+  int i;
+
+  if (argc == 2 && !strcmp (argv[1], "child"))
+    return EXIT_SUCCESS;
+  if (argc > 1)
+    count = atoi (argv[1]);
+  if (count <= 0)
+    {
+      printf ("usage: execbench [COUNT]\n");
+      return EXIT_FAILURE;
+    }
+
+  start_usecs = clock_usecs ();
+  start = rdtsc ();
+  for (i = 0; i < count; i++)
+    {
+      pid_t pid = exec ("execbench child");
+
+      if (pid == PID_ERROR || wait (pid) != EXIT_SUCCESS)
+        {
+          printf ("execbench: exec %d failed\n", i);
+          return EXIT_FAILURE;
+        }
+    }
+  cycles = rdtsc () - start;
+  usecs = clock_usecs () - start_usecs;
+
+  printf ("%d execs in %lld us: %lld execs/s, %llu cycles/exec\n",
+          count, usecs, count * 1000000LL / (usecs > 0 ? usecs : 1),
+          cycles / count);
+  return EXIT_SUCCESS;
+}
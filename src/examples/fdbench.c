@@ -0,0 +1,87 @@
+/* fdbench.c
+
+   Measures the cost of I/O system calls on a file descriptor, in
+   CPU cycles per call, with 1 to 4,096 files open.  With a
+   constant-time descriptor table the numbers should not change
+   as more files are opened.
+
+   Usage: fdbench [ITERATIONS] */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include <tsc.h>
+
+#define MAX_FDS 4096
+
+static int fds[MAX_FDS];
+static char buf[64];
+
+int
+main (int argc, char *argv[])
+{
+  int iterations = argc > 1 ? atoi (argv[1]) : 1000;
+  int open_cnt = 0;
+  int target;
+
+  if (iterations <= 0)
+    {
+      printf ("usage: fdbench [ITERATIONS]\n");
+      return EXIT_FAILURE;
+    }
+  if (!create ("fdbench.tmp", sizeof buf))
+    {
+      printf ("fdbench: create failed\n");
+      return EXIT_FAILURE;
+    }
+
+  printf ("%8s %12s %12s %12s\n", "open fds", "read", "seek+tell",
+          "open+close");
+  for (target = 1; target <= MAX_FDS; target *= 4)
+    {
+      uint64_t start, read_cycles, seek_cycles, open_cycles;
+      int fd;
+      int i;
+
+      while (open_cnt < target)
+        {
+          fds[open_cnt] = open ("fdbench.tmp");
+          if (fds[open_cnt] < 0)
+            {
+              printf ("fdbench: open failed with %d files open\n",
+                      open_cnt);
+              return EXIT_FAILURE;
+            }
+          open_cnt++;
+        }
+      fd = fds[open_cnt - 1];
+
+      start = rdtsc ();
+      for (i = 0; i < iterations; i++)
+        read (fd, buf, 0);
+      read_cycles = rdtsc () - start;
+
+      start = rdtsc ();
+      for (i = 0; i < iterations; i++)
+        {
+          seek (fd, 0);
+          tell (fd);
+        }
+      seek_cycles = rdtsc () - start;
+
+      start = rdtsc ();
+      for (i = 0; i < iterations; i++)
+        close (open ("fdbench.tmp"));
+      open_cycles = rdtsc () - start;
+
+      printf ("%8d %12llu %12llu %12llu\n", open_cnt,
+              read_cycles / iterations, seek_cycles / iterations,
+              open_cycles / iterations);
+    }
+
+  while (open_cnt > 0)
+    close (fds[--open_cnt]);
+  remove ("fdbench.tmp");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,116 @@
+/* fsbench.c
+
+   Measures file system throughput with 1, 2, 4 and 8 processes
+   running at once.  Each process works on a file of its own:
+   even-numbered ones read theirs over and over, odd-numbered
+   ones write theirs.  Reports the combined throughput for each
+   number of processes; if processes do not serialize on a global
+   lock, it should hold up as more of them run.
+
+   Usage: fsbench [PASSES] */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include <tsc.h>
+
+#define FILE_SIZE (64 * 1024)
+#define MAX_PROCS 8
+
+static char buf[4096];
+
+/* Runs as child number IDX: reads or writes its file PASSES
+   times over. */
+static int
+child (int idx, int passes)
+{
+  char name[16];
+  int fd;
+  int i;
+
+  snprintf (name, sizeof name, "fsbench.%d", idx);
+  fd = open (name);
+  if (fd < 0)
+    return EXIT_FAILURE;
+  memset (buf, idx, sizeof buf);
+  for (i = 0; i < passes; i++)
+    {
+      int ofs;
+
+      seek (fd, 0);
+      for (ofs = 0; ofs < FILE_SIZE; ofs += sizeof buf)
+        if ((idx % 2 == 0 ? read (fd, buf, sizeof buf)
+             : write (fd, buf, sizeof buf)) != (int) sizeof buf)
+          return EXIT_FAILURE;
+    }
+  close (fd);
+  return EXIT_SUCCESS;
+}
+
+int
+main (int argc, char *argv[])
+{
+  int passes = 16;
+  int procs;
+  int i;
+
+  if (argc == 4 && !strcmp (argv[1], "child"))
+    return child (atoi (argv[2]), atoi (argv[3]));
+  if (argc > 1)
+    passes = atoi (argv[1]);
+  if (passes <= 0)
+    {
+      printf ("usage: fsbench [PASSES]\n");
+      return EXIT_FAILURE;
+    }
+
+  for (i = 0; i < MAX_PROCS; i++)
+    {
+      char name[16];
+
+      snprintf (name, sizeof name, "fsbench.%d", i);
+      if (!create (name, FILE_SIZE))
+        {
+          printf ("fsbench: create %s failed\n", name);
+          return EXIT_FAILURE;
+        }
+    }
+
+  printf ("%6s %14s %14s\n", "procs", "kB", "kB/Mcycle");
+  for (procs = 1; procs <= MAX_PROCS; procs *= 2)
+    {
+      pid_t pids[MAX_PROCS];
+      uint64_t start, cycles;
+      long long kb = (long long) procs * passes * (FILE_SIZE / 1024);
+
+      start = rdtsc ();
+      for (i = 0; i < procs; i++)
+        {
+          char cmd[64];
+
+          snprintf (cmd, sizeof cmd, "fsbench child %d %d", i, passes);
+          pids[i] = exec (cmd);
+        }
+      for (i = 0; i < procs; i++)
+        if (pids[i] == PID_ERROR || wait (pids[i]) != EXIT_SUCCESS)
+          {
+            printf ("fsbench: child %d failed\n", i);
+            return EXIT_FAILURE;
+          }
+      cycles = rdtsc () - start;
+
+      printf ("%6d %14lld %14lld\n", procs, kb,
+              kb * 1000000 / (long long) (cycles > 0 ? cycles : 1));
+    }
+
+  for (i = 0; i < MAX_PROCS; i++)
+    {
+      char name[16];
+
+      snprintf (name, sizeof name, "fsbench.%d", i);
+      remove (name);
+    }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,56 @@
+/* nullbench.c
+
+   Measures the latency of a system call that does no work, in
+   CPU cycles per call, entering the kernel with "int $0x30" and,
+   if the CPU supports it, with SYSENTER.  For comparison, also
+   times getpid(), which reads a kernel-shared page instead.
+
+   Usage: nullbench [ITERATIONS] */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include <tsc.h>
+
+/* Returns the average cycles taken by an empty batch() call. */
+static uint64_t
+measure (int iterations)
+{
+  uint64_t start = rdtsc ();
+  int i;
+
+  for (i = 0; i < iterations; i++)
+    batch (NULL, 0, 0);
+  return (rdtsc () - start) / iterations;
+}
+
+int
+main (int argc, char *argv[])
+{
+  int iterations = argc > 1 ? atoi (argv[1]) : 10000;
+  bool fast = syscall_fast;
+  uint64_t start;
+  int i;
+
+  if (iterations <= 0)
+    {
+      printf ("usage: nullbench [ITERATIONS]\n");
+      return EXIT_FAILURE;
+    }
+
+  syscall_fast = false;
+  printf ("%-12s %8llu cycles/call\n", "int $0x30", measure (iterations));
+  syscall_fast = fast;
+  if (fast)
+    printf ("%-12s %8llu cycles/call\n", "sysenter", measure (iterations));
+  else
+    printf ("%-12s %8s\n", "sysenter", "not supported");
+
+  start = rdtsc ();
+  for (i = 0; i < iterations; i++)
+    getpid ();
+  printf ("%-12s %8llu cycles/call\n", "getpid",
+          (rdtsc () - start) / iterations);
+  return EXIT_SUCCESS;
+}
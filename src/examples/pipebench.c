@@ -0,0 +1,150 @@
+/* pipebench.c
+
+   Moves MB megabytes from a producer process to a consumer
+   process, first through a pipe and then through a temporary
+   file, and reports the throughput of each.
+
+   Through the pipe, a child started with the pipe as its
+   standard output writes the data while we read it.  Files
+   cannot grow, so through the file, a child writes the data
+   over and over into the same 64 kB file, and once it is done,
+   we read the same amount back the same way.
+
+   Usage: pipebench [MB] */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+
+#define BUF_SIZE 4096
+#define FILE_SIZE (64 * 1024)
+#define MB (1024 * 1024)
+
+static char buf[BUF_SIZE];
+
+/* Writes MB megabytes to FD, or if FILE is true, writes them to
+   file FD a FILE_SIZE window at a time. */
+static int
+produce (int fd, int mb, bool file)
+{
+  long long left = (long long) mb * MB;
+
+  memset (buf, 'x', sizeof buf);
+  while (left > 0)
+    {
+      if (file && tell (fd) >= FILE_SIZE)
+        seek (fd, 0);
+      if (write (fd, buf, sizeof buf) != (int) sizeof buf)
+        return EXIT_FAILURE;
+      left -= sizeof buf;
+    }
+  return EXIT_SUCCESS;
+}
+
+/* Reads FD until end of file, or if FILE is true, reads MB
+   megabytes from file FD a FILE_SIZE window at a time.  Returns
+   the number of bytes read. */
+static long long
+consume (int fd, int mb, bool file)
+{
+  long long total = 0;
+
+  for (;;)
+    {
+      int n;
+
+      if (file)
+        {
+          if (total >= (long long) mb * MB)
+            break;
+          if (tell (fd) >= FILE_SIZE)
+            seek (fd, 0);
+        }
+      n = read (fd, buf, sizeof buf);
+      if (n <= 0)
+        break;
+      total += n;
+    }
+  return total;
+}
+
+/* Prints the throughput of moving TOTAL bytes in USECS
+   microseconds, labeled NAME. */
+static void
+report (const char *name, long long total, int64_t usecs)
+{
+  printf ("%-6s %10lld bytes %10lld us %8lld kB/s\n", name, total, usecs,
+          total * 1000 / 1024 * 1000 / (usecs > 0 ? usecs : 1));
+}
+
+int
+main (int argc, char *argv[])
+{
+  int mb = 100;
+  char cmd[64];
+  int64_t start;
+  long long total;
+  int fds[2], fd;
+  pid_t pid;
+
+  if (argc == 3 && !strcmp (argv[1], "pipe"))
+    return produce (STDOUT_FILENO, atoi (argv[2]), false);
+  if (argc == 3 && !strcmp (argv[1], "file"))
+    {
+      fd = open ("pipebench.tmp");
+      return fd >= 0 ? produce (fd, atoi (argv[2]), true) : EXIT_FAILURE;
+    }
+  if (argc > 1)
+    mb = atoi (argv[1]);
+  if (mb <= 0)
+    {
+      printf ("usage: pipebench [MB]\n");
+      return EXIT_FAILURE;
+    }
+
+  /* Through a pipe.  Nothing may be printed while the pipe is
+     our standard output. */
+  if (!pipe (fds))
+    {
+      printf ("pipebench: pipe failed\n");
+      return EXIT_FAILURE;
+    }
+  snprintf (cmd, sizeof cmd, "pipebench pipe %d", mb);
+  start = clock_usecs ();
+  dup2 (fds[1], STDOUT_FILENO);
+  pid = exec (cmd);
+  close (STDOUT_FILENO);
+  close (fds[1]);
+  total = consume (fds[0], mb, false);
+  close (fds[0]);
+  if (pid == PID_ERROR || wait (pid) != EXIT_SUCCESS)
+    {
+      printf ("pipebench: producer failed\n");
+      return EXIT_FAILURE;
+    }
+  report ("pipe", total, clock_usecs () - start);
+
+  /* Through a file. */
+  if (!create ("pipebench.tmp", FILE_SIZE))
+    {
+      printf ("pipebench: create failed\n");
+      return EXIT_FAILURE;
+    }
+  snprintf (cmd, sizeof cmd, "pipebench file %d", mb);
+  start = clock_usecs ();
+  pid = exec (cmd);
+  if (pid == PID_ERROR || wait (pid) != EXIT_SUCCESS)
+    {
+      printf ("pipebench: producer failed\n");
+      return EXIT_FAILURE;
+    }
+  fd = open ("pipebench.tmp");
+  total = consume (fd, mb, true);
+  close (fd);
+  report ("file", total, clock_usecs () - start);
+
+  remove ("pipebench.tmp");
+  return EXIT_SUCCESS;
+}
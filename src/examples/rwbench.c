@@ -0,0 +1,107 @@
+/* rwbench.c
+
+   Compares positioned and scatter-gather I/O system calls with
+   the loops they replace, in CPU cycles per operation:
+
+     - reading a record at a random offset with seek() and read()
+       versus a single pread();
+
+     - filling IOV_CNT separate buffers with one read() each
+       versus a single readv().
+
+   Usage: rwbench [ITERATIONS] [RECORD-SIZE] */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include <tsc.h>
+
+#define FILE_SIZE (64 * 1024)
+#define IOV_CNT 8
+#define MAX_RECORD 512
+
+static char bufs[IOV_CNT][MAX_RECORD];
+
+/* Returns a pseudo-random record-aligned offset in the file. */
+static unsigned
+random_offset (int record)
+{
+  static unsigned seed = 1;
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 8) % (FILE_SIZE / record) * record;
+}
+
+int
+main (int argc, char *argv[])
+{
+  int iterations = argc > 1 ? atoi (argv[1]) : 1000;
+  int record = argc > 2 ? atoi (argv[2]) : 64;
+  struct iovec iov[IOV_CNT];
+  uint64_t start, seek_cycles, pread_cycles, read_cycles, readv_cycles;
+  int fd;
+  int i, j;
+
+  if (iterations <= 0 || record <= 0 || record > MAX_RECORD)
+    {
+      printf ("usage: rwbench [ITERATIONS] [RECORD-SIZE]\n");
+      return EXIT_FAILURE;
+    }
+  if (!create ("rwbench.tmp", FILE_SIZE))
+    {
+      printf ("rwbench: create failed\n");
+      return EXIT_FAILURE;
+    }
+  fd = open ("rwbench.tmp");
+  if (fd < 0)
+    {
+      printf ("rwbench: open failed\n");
+      return EXIT_FAILURE;
+    }
+  for (j = 0; j < IOV_CNT; j++)
+    {
+      iov[j].iov_base = bufs[j];
+      iov[j].iov_len = record;
+    }
+
+  start = rdtsc ();
+  for (i = 0; i < iterations; i++)
+    {
+      seek (fd, random_offset (record));
+      read (fd, bufs[0], record);
+    }
+  seek_cycles = rdtsc () - start;
+
+  start = rdtsc ();
+  for (i = 0; i < iterations; i++)
+    pread (fd, bufs[0], record, random_offset (record));
+  pread_cycles = rdtsc () - start;
+
+  start = rdtsc ();
+  for (i = 0; i < iterations; i++)
+    {
+      seek (fd, 0);
+      for (j = 0; j < IOV_CNT; j++)
+        read (fd, bufs[j], record);
+    }
+  read_cycles = rdtsc () - start;
+
+  start = rdtsc ();
+  for (i = 0; i < iterations; i++)
+    {
+      seek (fd, 0);
+      readv (fd, iov, IOV_CNT);
+    }
+  readv_cycles = rdtsc () - start;
+
+  printf ("%d-byte records, %d iterations\n", record, iterations);
+  printf ("%-24s %12llu\n", "seek+read", seek_cycles / iterations);
+  printf ("%-24s %12llu\n", "pread", pread_cycles / iterations);
+  printf ("%d x read %15s %12llu\n", IOV_CNT, "",
+          read_cycles / iterations);
+  printf ("%-24s %12llu\n", "readv", readv_cycles / iterations);
+
+  close (fd);
+  remove ("rwbench.tmp");
+  return EXIT_SUCCESS;
+}
@@ -3,8 +3,12 @@
 #include <string.h>
 #include <syscall.h>
 
+/* Maximum number of commands in a pipeline. */
+#define MAX_STAGES 8
+
 static void read_line (char line[], size_t);
 static bool backspace (char **pos, char line[]);
+static void run_pipeline (char *command);
 
 int
 main (void)
@@ -30,6 +34,8 @@ main (void)
         {
           /* Empty command. */
         }
+      else if (strchr (command, '|') != NULL)
+        run_pipeline (command);
       else
         {
           pid_t pid = exec (command);
@@ -44,6 +50,69 @@ main (void)
   return EXIT_SUCCESS;
 }
 
+/* Runs COMMAND, a pipeline of commands separated by `|', with
+   each command's standard output connected to the next one's
+   standard input through a pipe.  A child started by exec()
+   inherits our standard descriptors, so each pipe end is put in
+   place with dup2() just long enough to start the child, and
+   closing the descriptor afterward gives us back the console. */
+static void
+run_pipeline (char *command)
+{
+  char *stages[MAX_STAGES];
+  pid_t pids[MAX_STAGES];
+  char *stage, *save_ptr;
+  int stage_cnt = 0;
+  int in_fd = -1;
+  int i;
+
+  for (stage = strtok_r (command, "|", &save_ptr); stage != NULL;
+       stage = strtok_r (NULL, "|", &save_ptr))
+    {
+      if (stage_cnt >= MAX_STAGES)
+        {
+          printf ("too many commands in pipeline\n");
+          return;
+        }
+      stages[stage_cnt++] = stage;
+    }
+
+  for (i = 0; i < stage_cnt; i++)
+    {
+      int fds[2] = {-1, -1};
+
+      if (i < stage_cnt - 1 && !pipe (fds))
+        {
+          printf ("pipe failed\n");
+          break;
+        }
+      if (in_fd >= 0)
+        dup2 (in_fd, STDIN_FILENO);
+      if (fds[1] >= 0)
+        dup2 (fds[1], STDOUT_FILENO);
+      pids[i] = exec (stages[i]);
+      close (STDIN_FILENO);
+      close (STDOUT_FILENO);
+
+      /* Only the children may keep the pipes open, or readers
+         would never see end of file. */
+      if (in_fd >= 0)
+        close (in_fd);
+      if (fds[1] >= 0)
+        close (fds[1]);
+      in_fd = fds[0];
+      if (pids[i] == PID_ERROR)
+        printf ("\"%s\": exec failed\n", stages[i]);
+    }
+  if (in_fd >= 0)
+    close (in_fd);
+
+  stage_cnt = i;
+  for (i = 0; i < stage_cnt; i++)
+    if (pids[i] != PID_ERROR)
+      printf ("\"%s\": exit code %d\n", stages[i], wait (pids[i]));
+}
+
 /* Reads a line of input from the user into LINE, which has room
    for SIZE bytes.  Handles backspace and Ctrl+U in the ways
    expected by Unix users.  On return, LINE will always be
@@ -0,0 +1,97 @@
+/* sysbench.c
+
+   Measures the latency of system calls, in CPU cycles per call,
+   for calls with one to three arguments, string arguments, and
+   buffers of various sizes.
+
+   Usage: sysbench [ITERATIONS] */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include <tsc.h>
+
+static char buf[4096];
+
+/* Prints the average cycles per iteration between START and now. */
+static void
+report (const char *name, uint64_t start, int iterations)
+{
+  uint64_t cycles = rdtsc () - start;
+  printf ("%-24s %8llu cycles/call\n", name, cycles / iterations);
+}
+
+int
+main (int argc, char *argv[])
+{
+  int iterations = argc > 1 ? atoi (argv[1]) : 1000;
+  uint64_t start;
+  int fd;
+  int i;
+
+  if (iterations <= 0)
+    {
+      printf ("usage: sysbench [ITERATIONS]\n");
+      return EXIT_FAILURE;
+    }
+  if (!create ("sysbench.tmp", sizeof buf))
+    {
+      printf ("sysbench: create failed\n");
+      return EXIT_FAILURE;
+    }
+  fd = open ("sysbench.tmp");
+  if (fd < 0)
+    {
+      printf ("sysbench: open failed\n");
+      return EXIT_FAILURE;
+    }
+
+  start = rdtsc ();
+  for (i = 0; i < iterations; i++)
+    tell (fd);
+  report ("tell (1 arg)", start, iterations);
+
+  start = rdtsc ();
+  for (i = 0; i < iterations; i++)
+    seek (fd, 0);
+  report ("seek (2 args)", start, iterations);
+
+  start = rdtsc ();
+  for (i = 0; i < iterations; i++)
+    read (fd, buf, 0);
+  report ("read 0 bytes (3 args)", start, iterations);
+
+  start = rdtsc ();
+  for (i = 0; i < iterations; i++)
+    {
+      seek (fd, 0);
+      read (fd, buf, 64);
+    }
+  report ("seek + read 64 bytes", start, iterations);
+
+  start = rdtsc ();
+  for (i = 0; i < iterations; i++)
+    {
+      seek (fd, 0);
+      read (fd, buf, sizeof buf);
+    }
+  report ("seek + read 4 kB", start, iterations);
+
+  start = rdtsc ();
+  for (i = 0; i < iterations; i++)
+    {
+      seek (fd, 0);
+      write (fd, buf, sizeof buf);
+    }
+  report ("seek + write 4 kB", start, iterations);
+
+  start = rdtsc ();
+  for (i = 0; i < iterations; i++)
+    open ("sysbench.nonexistent");
+  report ("open (string arg)", start, iterations);
+
+  close (fd);
+  remove ("sysbench.tmp");
+  return EXIT_SUCCESS;
+}
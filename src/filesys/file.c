@@ -1,14 +1,30 @@
 #include "filesys/file.h"
 #include <debug.h>
 #include "filesys/inode.h"
+#include "filesys/pipe.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
-/* An open file. */
+/* An open file.  After fork() one may be shared by several
+   processes, so the members other than INODE are protected by
+   LOCK.  Reads and writes at the current position hold it for
+   the whole call, so that each one gets a distinct range of the
+   file; reads and writes at explicit offsets do not take it.
+
+   A file may instead be one end of a pipe, in which case INODE
+   is a null pointer.  Reads and writes of a pipe go to the pipe,
+   which has a lock of its own, and may block for as long as the
+   other end takes; pipes have no position or length, and cannot
+   be read or written at an offset. */
 struct file 
   {
     struct inode *inode;        /* File's inode. */
+    struct pipe *pipe;          /* Pipe, if this is one end of one. */
+    bool write_end;             /* Is this the pipe's write end? */
     off_t pos;                  /* Current position. */
     bool deny_write;            /* Has file_deny_write() been called? */
+    int ref_cnt;                /* Number of holders, see file_dup(). */
+    struct lock lock;           /* Protects the above. */
   };
 
 /* Opens a file for the given INODE, of which it takes ownership,
@@ -23,6 +39,8 @@ file_open (struct inode *inode)
       file->inode = inode;
       file->pos = 0;
       file->deny_write = false;
+      file->ref_cnt = 1;
+      lock_init (&file->lock);
       return file;
     }
   else
@@ -33,43 +51,124 @@ file_open (struct inode *inode)
     }
 }
 
-/* Opens and returns a new file for the same inode as FILE.
-   Returns a null pointer if unsuccessful. */
+/* Creates a pipe and stores files for its read end in
+   *READ_END and for its write end in *WRITE_END.  Returns true
+   if successful, false if memory is exhausted. */
+bool
+file_open_pipe (struct file **read_end, struct file **write_end)
+{
+  struct pipe *pipe = pipe_create ();
+  struct file *ends[2];
+  int i;
+
+  if (pipe == NULL)
+    return false;
+  for (i = 0; i < 2; i++)
+    {
+      ends[i] = calloc (1, sizeof *ends[i]);
+      if (ends[i] == NULL)
+        {
+          if (i > 0)
+            free (ends[0]);
+          pipe_close (pipe, false);
+          pipe_close (pipe, true);
+          return false;
+        }
+      ends[i]->pipe = pipe;
+      ends[i]->write_end = i == 1;
+      ends[i]->ref_cnt = 1;
+      lock_init (&ends[i]->lock);
+    }
+  *read_end = ends[0];
+  *write_end = ends[1];
+  return true;
+}
+
+/* Opens and returns a new file for the same inode as FILE, which
+   must not be a pipe.  Returns a null pointer if unsuccessful. */
 struct file *
 file_reopen (struct file *file) 
 {
+  ASSERT (file->pipe == NULL);
   return file_open (inode_reopen (file->inode));
 }
 
-/* Closes FILE. */
+/* Returns FILE with an additional reference, so that it can be
+   held in more than one place (for example, by the file
+   descriptor tables of a parent and a child process after
+   fork()).  Unlike file_reopen(), all holders share the same
+   position.  Each reference must be dropped with file_close(). */
+struct file *
+file_dup (struct file *file) 
+{
+  ASSERT (file != NULL);
+  lock_acquire (&file->lock);
+  file->ref_cnt++;
+  lock_release (&file->lock);
+  return file;
+}
+
+/* Drops a reference to FILE, closing it when the last one goes
+   away. */
 void
 file_close (struct file *file) 
 {
-  if (file != NULL)
+  bool last;
+
+  if (file == NULL)
+    return;
+
+  lock_acquire (&file->lock);
+  last = --file->ref_cnt == 0;
+  lock_release (&file->lock);
+  if (last)
     {
-      file_allow_write (file);
-      inode_close (file->inode);
+      if (file->pipe != NULL)
+        pipe_close (file->pipe, file->write_end);
+      else
+        {
+          file_allow_write (file);
+          inode_close (file->inode);
+        }
       free (file); 
     }
 }
 
-/* Returns the inode encapsulated by FILE. */
+/* Returns the inode encapsulated by FILE, or a null pointer if
+   FILE is a pipe. */
 struct inode *
 file_get_inode (struct file *file) 
 {
   return file->inode;
 }
 
+/* Returns true if FILE is one end of a pipe. */
+bool
+file_is_pipe (const struct file *file) 
+{
+  return file->pipe != NULL;
+}
+
 /* Reads SIZE bytes from FILE into BUFFER,
    starting at the file's current position.
    Returns the number of bytes actually read,
    which may be less than SIZE if end of file is reached.
-   Advances FILE's position by the number of bytes read. */
+   Advances FILE's position by the number of bytes read.
+   If FILE is the read end of a pipe, waits until there is
+   something to read instead, and reads only what is there.
+   Reading a pipe's write end returns -1. */
 off_t
 file_read (struct file *file, void *buffer, off_t size) 
 {
-  off_t bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
+  off_t bytes_read;
+
+  if (file->pipe != NULL)
+    return !file->write_end ? pipe_read (file->pipe, buffer, size) : -1;
+
+  lock_acquire (&file->lock);
+  bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
   file->pos += bytes_read;
+  lock_release (&file->lock);
   return bytes_read;
 }
 
@@ -77,10 +176,12 @@ file_read (struct file *file, void *buffer, off_t size)
    starting at offset FILE_OFS in the file.
    Returns the number of bytes actually read,
    which may be less than SIZE if end of file is reached.
-   The file's current position is unaffected. */
+   The file's current position is unaffected.
+   FILE must not be a pipe. */
 off_t
 file_read_at (struct file *file, void *buffer, off_t size, off_t file_ofs) 
 {
+  ASSERT (file->pipe == NULL);
   return inode_read_at (file->inode, buffer, size, file_ofs);
 }
 
@@ -90,12 +191,22 @@ file_read_at (struct file *file, void *buffer, off_t size, off_t file_ofs)
    which may be less than SIZE if end of file is reached.
    (Normally we'd grow the file in that case, but file growth is
    not yet implemented.)
-   Advances FILE's position by the number of bytes read. */
+   Advances FILE's position by the number of bytes read.
+   If FILE is the write end of a pipe, waits for room as needed
+   instead, and returns -1 if the read end is closed.  Writing a
+   pipe's read end returns -1. */
 off_t
 file_write (struct file *file, const void *buffer, off_t size) 
 {
-  off_t bytes_written = inode_write_at (file->inode, buffer, size, file->pos);
+  off_t bytes_written;
+
+  if (file->pipe != NULL)
+    return file->write_end ? pipe_write (file->pipe, buffer, size) : -1;
+
+  lock_acquire (&file->lock);
+  bytes_written = inode_write_at (file->inode, buffer, size, file->pos);
   file->pos += bytes_written;
+  lock_release (&file->lock);
   return bytes_written;
 }
 
@@ -105,25 +216,84 @@ file_write (struct file *file, const void *buffer, off_t size)
    which may be less than SIZE if end of file is reached.
    (Normally we'd grow the file in that case, but file growth is
    not yet implemented.)
-   The file's current position is unaffected. */
+   The file's current position is unaffected.
+   FILE must not be a pipe. */
 off_t
 file_write_at (struct file *file, const void *buffer, off_t size,
                off_t file_ofs) 
 {
+  ASSERT (file->pipe == NULL);
   return inode_write_at (file->inode, buffer, size, file_ofs);
 }
 
+/* Copies up to SIZE bytes from IN, starting at its current
+   position, to OUT at its current position, advancing both by
+   the number of bytes copied, which is returned.  Stops early at
+   the end of either file.  The data moves BUFFER_SIZE bytes at a
+   time through kernel BUFFER.  IN and OUT must differ and must
+   not be pipes; both positions are locked for the whole copy.
+   Returns -1 without copying anything if IN and OUT are open on
+   the same inode and the ranges to copy from and to overlap,
+   since the copy would read bytes it has already overwritten. */
+off_t
+file_copy (struct file *out, struct file *in, off_t size,
+           void *buffer, off_t buffer_size)
+{
+  struct file *first = in < out ? in : out;
+  struct file *second = in < out ? out : in;
+  off_t copied = 0;
+
+  ASSERT (in != NULL && out != NULL && in != out);
+  ASSERT (in->pipe == NULL && out->pipe == NULL);
+  ASSERT (buffer_size > 0);
+
+  /* Lock in address order, since another process may be copying
+     between the same two files the other way. */
+  lock_acquire (&first->lock);
+  lock_acquire (&second->lock);
+  if (in->inode == out->inode)
+    {
+      /* Files do not grow, so the ranges end at the file's end. */
+      off_t length = inode_length (in->inode);
+      off_t n = size;
+
+      if (n > length - in->pos)
+        n = length - in->pos;
+      if (n > length - out->pos)
+        n = length - out->pos;
+      if (n > 0 && in->pos < out->pos + n && out->pos < in->pos + n)
+        copied = -1;
+    }
+  while (copied >= 0 && copied < size)
+    {
+      off_t chunk = size - copied < buffer_size ? size - copied : buffer_size;
+      off_t n = inode_read_at (in->inode, buffer, chunk, in->pos);
+
+      n = inode_write_at (out->inode, buffer, n, out->pos);
+      in->pos += n;
+      out->pos += n;
+      copied += n;
+      if (n < chunk)
+        break;
+    }
+  lock_release (&second->lock);
+  lock_release (&first->lock);
+  return copied;
+}
+
 /* Prevents write operations on FILE's underlying inode
    until file_allow_write() is called or FILE is closed. */
 void
 file_deny_write (struct file *file) 
 {
   ASSERT (file != NULL);
+  lock_acquire (&file->lock);
   if (!file->deny_write) 
     {
       file->deny_write = true;
       inode_deny_write (file->inode);
     }
+  lock_release (&file->lock);
 }
 
 /* Re-enables write operations on FILE's underlying inode.
@@ -133,18 +303,20 @@ void
 file_allow_write (struct file *file) 
 {
   ASSERT (file != NULL);
+  lock_acquire (&file->lock);
   if (file->deny_write) 
     {
       file->deny_write = false;
       inode_allow_write (file->inode);
     }
+  lock_release (&file->lock);
 }
 
-/* Returns the size of FILE in bytes. */
+/* Returns the size of FILE in bytes.  FILE must not be a pipe. */
 off_t
 file_length (struct file *file) 
 {
-  ASSERT (file != NULL);
+  ASSERT (file != NULL && file->pipe == NULL);
   return inode_length (file->inode);
 }
 
@@ -152,10 +324,36 @@ file_length (struct file *file)
    start of the file. */
 void
 file_seek (struct file *file, off_t new_pos)
+{
+  ASSERT (file != NULL);
+  ASSERT (new_pos >= 0);
+  lock_acquire (&file->lock);
+  file->pos = new_pos;
+  lock_release (&file->lock);
+}
+
+/* Locks FILE's position and returns it, so that a caller making
+   several file_read_at() or file_write_at() calls can treat them
+   as a single read or write at the current position.  The caller
+   must not block on anything that might in turn need FILE and
+   must call file_unlock_pos() when done. */
+off_t
+file_lock_pos (struct file *file)
+{
+  ASSERT (file != NULL);
+  lock_acquire (&file->lock);
+  return file->pos;
+}
+
+/* Sets FILE's position to NEW_POS and unlocks it, after
+   file_lock_pos(). */
+void
+file_unlock_pos (struct file *file, off_t new_pos)
 {
   ASSERT (file != NULL);
   ASSERT (new_pos >= 0);
   file->pos = new_pos;
+  lock_release (&file->lock);
 }
 
 /* Returns the current position in FILE as a byte offset from the
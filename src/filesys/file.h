@@ -1,21 +1,27 @@
 #ifndef FILESYS_FILE_H
 #define FILESYS_FILE_H
 
+#include <stdbool.h>
 #include "filesys/off_t.h"
 
 struct inode;
 
 /* Opening and closing files. */
 struct file *file_open (struct inode *);
+bool file_open_pipe (struct file **read_end, struct file **write_end);
 struct file *file_reopen (struct file *);
+struct file *file_dup (struct file *);
 void file_close (struct file *);
 struct inode *file_get_inode (struct file *);
+bool file_is_pipe (const struct file *);
 
 /* Reading and writing. */
 off_t file_read (struct file *, void *, off_t);
 off_t file_read_at (struct file *, void *, off_t size, off_t start);
 off_t file_write (struct file *, const void *, off_t);
 off_t file_write_at (struct file *, const void *, off_t size, off_t start);
+off_t file_copy (struct file *out, struct file *in, off_t size,
+                 void *buffer, off_t buffer_size);
 
 /* Preventing writes. */
 void file_deny_write (struct file *);
@@ -25,5 +31,7 @@ void file_allow_write (struct file *);
 void file_seek (struct file *, off_t);
 off_t file_tell (struct file *);
 off_t file_length (struct file *);
+off_t file_lock_pos (struct file *);
+void file_unlock_pos (struct file *, off_t);
 
 #endif /* filesys/file.h */
@@ -5,6 +5,7 @@
 #include "filesys/file.h"
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
+#include "filesys/pipe.h"
 #include "filesys/directory.h"
 
 /* Partition that contains the file system. */
@@ -23,6 +24,7 @@ filesys_init (bool format)
 
   inode_init ();
   free_map_init ();
+  pipe_init ();
 
   if (format) 
     do_format ();
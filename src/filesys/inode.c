@@ -6,6 +6,7 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -28,6 +29,31 @@ bytes_to_sectors (off_t size)
   return DIV_ROUND_UP (size, BLOCK_SECTOR_SIZE);
 }
 
+/* Synchronization.
+
+   The file system does its own locking, so that processes using
+   different files, or reading the same one, do not wait for each
+   other:
+
+     - OPEN_INODES_LOCK protects the list of open inodes and each
+       inode's open count.  It is never held across disk I/O: the
+       first opener of an inode enters it into the list, then
+       reads it from disk with its DATA_LOCK held, and other
+       openers wait for that lock until the inode is loaded.
+
+     - Each inode's DATA_LOCK protects its deny-write count,
+       removed flag and version, and serializes writes to it, so that two
+       writes to parts of the same sector cannot lose each other's
+       bytes.  An inode's length never changes, since files do not
+       grow, so reads take no lock at all; the block layer makes
+       each sector read or write atomic.
+
+     - Each inode's LOCK is not used here, but by higher layers
+       that need to make several calls on one inode atomic, such
+       as directory updates (see inode_lock()).
+
+   The free map has a lock of its own (see free-map.c). */
+
 /* In-memory inode. */
 struct inode 
   {
@@ -36,6 +62,10 @@ struct inode
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+    unsigned long version;              /* Changed by every write. */
+    bool loaded;                        /* Has DATA been read yet? */
+    struct lock data_lock;              /* Protects the above, writes. */
+    struct lock lock;                   /* See inode_lock(). */
     struct inode_disk data;             /* Inode content. */
   };
 
@@ -56,12 +86,14 @@ byte_to_sector (const struct inode *inode, off_t pos)
 /* List of open inodes, so that opening a single inode twice
    returns the same `struct inode'. */
 static struct list open_inodes;
+static struct lock open_inodes_lock;
 
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
   list_init (&open_inodes);
+  lock_init (&open_inodes_lock);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -114,6 +146,8 @@ inode_open (block_sector_t sector)
   struct list_elem *e;
   struct inode *inode;
 
+  lock_acquire (&open_inodes_lock);
+
   /* Check whether this inode is already open. */
   for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
        e = list_next (e)) 
@@ -121,7 +155,15 @@ inode_open (block_sector_t sector)
       inode = list_entry (e, struct inode, elem);
       if (inode->sector == sector) 
         {
-          inode_reopen (inode);
+          inode->open_cnt++;
+          lock_release (&open_inodes_lock);
+
+          /* Wait for its first opener to read it in. */
+          if (!inode->loaded)
+            {
+              lock_acquire (&inode->data_lock);
+              lock_release (&inode->data_lock);
+            }
           return inode; 
         }
     }
@@ -129,15 +171,28 @@ inode_open (block_sector_t sector)
   /* Allocate memory. */
   inode = malloc (sizeof *inode);
   if (inode == NULL)
-    return NULL;
+    {
+      lock_release (&open_inodes_lock);
+      return NULL;
+    }
 
-  /* Initialize. */
+  /* Initialize.  The inode is read with only its data lock held,
+     which a concurrent opener of the same sector waits for. */
   list_push_front (&open_inodes, &inode->elem);
   inode->sector = sector;
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
+  inode->version = 0;
+  inode->loaded = false;
+  lock_init (&inode->data_lock);
+  lock_init (&inode->lock);
+  lock_acquire (&inode->data_lock);
+  lock_release (&open_inodes_lock);
+
   block_read (fs_device, inode->sector, &inode->data);
+  inode->loaded = true;
+  lock_release (&inode->data_lock);
   return inode;
 }
 
@@ -146,7 +201,11 @@ struct inode *
 inode_reopen (struct inode *inode)
 {
   if (inode != NULL)
-    inode->open_cnt++;
+    {
+      lock_acquire (&open_inodes_lock);
+      inode->open_cnt++;
+      lock_release (&open_inodes_lock);
+    }
   return inode;
 }
 
@@ -168,10 +227,12 @@ inode_close (struct inode *inode)
     return;
 
   /* Release resources if this was the last opener. */
+  lock_acquire (&open_inodes_lock);
   if (--inode->open_cnt == 0)
     {
       /* Remove from inode list and release lock. */
       list_remove (&inode->elem);
+      lock_release (&open_inodes_lock);
  
       /* Deallocate blocks if removed. */
       if (inode->removed) 
@@ -183,6 +244,8 @@ inode_close (struct inode *inode)
 
       free (inode); 
     }
+  else
+    lock_release (&open_inodes_lock);
 }
 
 /* Marks INODE to be deleted when it is closed by the last caller who
@@ -191,7 +254,26 @@ void
 inode_remove (struct inode *inode) 
 {
   ASSERT (inode != NULL);
+  lock_acquire (&inode->data_lock);
   inode->removed = true;
+  lock_release (&inode->data_lock);
+}
+
+/* Returns true if INODE has been removed. */
+bool
+inode_is_removed (const struct inode *inode)
+{
+  return inode->removed;
+}
+
+/* Returns INODE's version, which changes whenever INODE is
+   written, so that callers caching its contents can tell whether
+   their copy is still current.  Versions are only comparable
+   while INODE stays open. */
+unsigned long
+inode_version (const struct inode *inode)
+{
+  return inode->version;
 }
 
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
@@ -262,8 +344,12 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
   off_t bytes_written = 0;
   uint8_t *bounce = NULL;
 
+  lock_acquire (&inode->data_lock);
   if (inode->deny_write_cnt)
-    return 0;
+    {
+      lock_release (&inode->data_lock);
+      return 0;
+    }
 
   while (size > 0) 
     {
@@ -312,6 +398,9 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       offset += chunk_size;
       bytes_written += chunk_size;
     }
+  if (bytes_written > 0)
+    inode->version++;
+  lock_release (&inode->data_lock);
   free (bounce);
 
   return bytes_written;
@@ -322,8 +411,10 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 void
 inode_deny_write (struct inode *inode) 
 {
+  lock_acquire (&inode->data_lock);
   inode->deny_write_cnt++;
   ASSERT (inode->deny_write_cnt <= inode->open_cnt);
+  lock_release (&inode->data_lock);
 }
 
 /* Re-enables writes to INODE.
@@ -332,9 +423,11 @@ inode_deny_write (struct inode *inode)
 void
 inode_allow_write (struct inode *inode) 
 {
+  lock_acquire (&inode->data_lock);
   ASSERT (inode->deny_write_cnt > 0);
   ASSERT (inode->deny_write_cnt <= inode->open_cnt);
   inode->deny_write_cnt--;
+  lock_release (&inode->data_lock);
 }
 
 /* Returns the length, in bytes, of INODE's data. */
@@ -343,3 +436,21 @@ inode_length (const struct inode *inode)
 {
   return inode->data.length;
 }
+
+/* Acquires INODE's lock, which callers hold to make a sequence
+   of operations on INODE atomic with respect to other holders;
+   for example, a directory's inode is locked while an entry is
+   looked up and added.  The inode functions themselves neither
+   take nor require it. */
+void
+inode_lock (struct inode *inode)
+{
+  lock_acquire (&inode->lock);
+}
+
+/* Releases INODE's lock. */
+void
+inode_unlock (struct inode *inode)
+{
+  lock_release (&inode->lock);
+}
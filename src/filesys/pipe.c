@@ -0,0 +1,268 @@
+#include "filesys/pipe.h"
+#include <debug.h>
+#include <list.h>
+#include <stdint.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/process.h"
+
+/* Anonymous pipes.
+
+   A pipe is a ring buffer of PIPE_SIZE bytes with a read end and
+   a write end, each of which is a `struct file' (see
+   file_open_pipe()).  A reader waits for data while the pipe is
+   empty and some write end is still open; once every write end
+   is closed, reading an empty pipe returns 0, end of file.  A
+   writer waits for room while the pipe is full; once every read
+   end is closed, writing fails.  The pipe itself is freed when
+   both ends are closed.
+
+   A waiting reader or writer also gives up if its process starts
+   exiting.  Besides its pipe's wait queue, each waiter is listed
+   in `sleepers' along with its process, so that
+   pipe_wake_process() can wake the threads of an exiting process
+   without touching any pipe, as futex_wake_process() does for
+   futexes. */
+
+/* Bytes of data a pipe holds. */
+#define PIPE_SIZE PGSIZE
+
+struct pipe
+  {
+    struct lock lock;           /* Protects all the members. */
+    struct list readers;        /* Waiters for data. */
+    struct list writers;        /* Waiters for room. */
+    uint8_t *buf;               /* PIPE_SIZE bytes of data. */
+    size_t head;                /* Total bytes ever written. */
+    size_t tail;                /* Total bytes ever read. */
+    bool reader;                /* Is the read end open? */
+    bool writer;                /* Is the write end open? */
+  };
+
+/* A thread waiting on a pipe. */
+struct pipe_waiter
+  {
+    struct list_elem elem;      /* Element in `readers' or `writers'. */
+    bool queued;                /* Still in that list? */
+    struct list_elem sleeper_elem; /* Element in `sleepers'. */
+    struct thread *leader;      /* Main thread of waiter's process. */
+    struct semaphore sema;      /* Upped to wake the waiter. */
+  };
+
+/* Every pipe_waiter, of every pipe. */
+static struct list sleepers;
+
+/* Protects `sleepers'.  May be acquired with a pipe's lock held,
+   but not the other way around. */
+static struct lock sleepers_lock;
+
+static void wait (struct pipe *, struct list *queue);
+static void wake_all (struct list *queue);
+
+/* Initializes the list of pipe waiters. */
+void
+pipe_init (void)
+{
+  list_init (&sleepers);
+  lock_init (&sleepers_lock);
+}
+
+/* Creates and returns a new, empty pipe with both ends open, or
+   a null pointer if memory is exhausted. */
+struct pipe *
+pipe_create (void)
+{
+  struct pipe *p = malloc (sizeof *p);
+
+  if (p == NULL)
+    return NULL;
+  p->buf = palloc_get_page (0);
+  if (p->buf == NULL)
+    {
+      free (p);
+      return NULL;
+    }
+  lock_init (&p->lock);
+  list_init (&p->readers);
+  list_init (&p->writers);
+  p->head = p->tail = 0;
+  p->reader = p->writer = true;
+  return p;
+}
+
+/* Reads up to SIZE bytes from pipe P into BUFFER, waiting until
+   there is at least one byte to read or the write end is closed.
+   Returns the number of bytes read, which is 0 only at end of
+   file or if the running process starts exiting. */
+off_t
+pipe_read (struct pipe *p, void *buffer, off_t size)
+{
+  uint8_t *dst = buffer;
+  off_t bytes_read = 0;
+
+  lock_acquire (&p->lock);
+  while (p->head == p->tail && p->writer && size > 0 && !process_is_dying ())
+    wait (p, &p->readers);
+  while (bytes_read < size && p->tail < p->head)
+    {
+      /* Copy up to the end of the data or of the buffer. */
+      size_t ofs = p->tail % PIPE_SIZE;
+      size_t chunk = p->head - p->tail;
+      if (chunk > PIPE_SIZE - ofs)
+        chunk = PIPE_SIZE - ofs;
+      if (chunk > (size_t) (size - bytes_read))
+        chunk = size - bytes_read;
+
+      memcpy (dst + bytes_read, p->buf + ofs, chunk);
+      p->tail += chunk;
+      bytes_read += chunk;
+    }
+  if (bytes_read > 0)
+    wake_all (&p->writers);
+  lock_release (&p->lock);
+
+  return bytes_read;
+}
+
+/* Writes the SIZE bytes in BUFFER to pipe P, waiting for room as
+   necessary.  Returns SIZE, or fewer if the read end is closed
+   partway through or the running process starts exiting, or -1
+   if that happens before anything could be written. */
+off_t
+pipe_write (struct pipe *p, const void *buffer, off_t size)
+{
+  const uint8_t *src = buffer;
+  off_t bytes_written = 0;
+
+  lock_acquire (&p->lock);
+  while (bytes_written < size && p->reader)
+    {
+      size_t ofs = p->head % PIPE_SIZE;
+      size_t chunk = PIPE_SIZE - (p->head - p->tail);
+
+      if (chunk == 0)
+        {
+          if (process_is_dying ())
+            break;
+          wait (p, &p->writers);
+          continue;
+        }
+
+      /* Copy up to the end of the free space or of the buffer. */
+      if (chunk > PIPE_SIZE - ofs)
+        chunk = PIPE_SIZE - ofs;
+      if (chunk > (size_t) (size - bytes_written))
+        chunk = size - bytes_written;
+      memcpy (p->buf + ofs, src + bytes_written, chunk);
+      p->head += chunk;
+      bytes_written += chunk;
+      wake_all (&p->readers);
+    }
+  lock_release (&p->lock);
+
+  return bytes_written > 0 || size == 0 ? bytes_written : -1;
+}
+
+/* Closes the write end of pipe P if WRITE_END is true, its read
+   end otherwise, waking anyone waiting at the other end.  Frees
+   P once both ends are closed. */
+void
+pipe_close (struct pipe *p, bool write_end)
+{
+  bool free_pipe;
+
+  lock_acquire (&p->lock);
+  if (write_end)
+    {
+      ASSERT (p->writer);
+      p->writer = false;
+      wake_all (&p->readers);
+    }
+  else
+    {
+      ASSERT (p->reader);
+      p->reader = false;
+      wake_all (&p->writers);
+    }
+  free_pipe = !p->reader && !p->writer;
+  lock_release (&p->lock);
+
+  if (free_pipe)
+    {
+      palloc_free_page (p->buf);
+      free (p);
+    }
+}
+
+/* Wakes every thread of the process whose main thread is LEADER
+   that is waiting on any pipe, because the process is
+   exiting. */
+void
+pipe_wake_process (struct thread *leader)
+{
+  struct list_elem *e;
+
+  lock_acquire (&sleepers_lock);
+  for (e = list_begin (&sleepers); e != list_end (&sleepers);
+       e = list_next (e))
+    {
+      struct pipe_waiter *w = list_entry (e, struct pipe_waiter,
+                                          sleeper_elem);
+      if (w->leader == leader)
+        sema_up (&w->sema);
+    }
+  lock_release (&sleepers_lock);
+}
+
+/* Waits on QUEUE, one of pipe P's wait queues, until woken by
+   wake_all() or pipe_wake_process().  P's lock must be held; it
+   is released while waiting.  The caller should recheck what it
+   is waiting for afterward. */
+static void
+wait (struct pipe *p, struct list *queue)
+{
+  struct pipe_waiter w;
+
+  w.leader = process_leader (thread_current ());
+  sema_init (&w.sema, 0);
+  list_push_back (queue, &w.elem);
+  w.queued = true;
+
+  /* An exiting process is marked dying before
+     pipe_wake_process() looks for its sleepers, so checking once
+     we are listed cannot miss it. */
+  lock_acquire (&sleepers_lock);
+  list_push_back (&sleepers, &w.sleeper_elem);
+  if (process_is_dying ())
+    sema_up (&w.sema);
+  lock_release (&sleepers_lock);
+
+  lock_release (&p->lock);
+  sema_down (&w.sema);
+  lock_acquire (&p->lock);
+
+  /* Once W is off both lists, nobody can up its semaphore. */
+  if (w.queued)
+    list_remove (&w.elem);
+  lock_acquire (&sleepers_lock);
+  list_remove (&w.sleeper_elem);
+  lock_release (&sleepers_lock);
+}
+
+/* Wakes every thread waiting on QUEUE, one of a pipe's wait
+   queues.  The pipe's lock must be held. */
+static void
+wake_all (struct list *queue)
+{
+  while (!list_empty (queue))
+    {
+      struct pipe_waiter *w = list_entry (list_pop_front (queue),
+                                          struct pipe_waiter, elem);
+      w->queued = false;
+      sema_up (&w->sema);
+    }
+}
@@ -0,0 +1,17 @@
+#ifndef FILESYS_PIPE_H
+#define FILESYS_PIPE_H
+
+#include <stdbool.h>
+#include "filesys/off_t.h"
+
+struct pipe;
+struct thread;
+
+void pipe_init (void);
+struct pipe *pipe_create (void);
+off_t pipe_read (struct pipe *, void *, off_t size);
+off_t pipe_write (struct pipe *, const void *, off_t size);
+void pipe_close (struct pipe *, bool write_end);
+void pipe_wake_process (struct thread *leader);
+
+#endif /* filesys/pipe.h */
@@ -0,0 +1,58 @@
+#ifndef __LIB_AIO_H
+#define __LIB_AIO_H
+
+/* Asynchronous I/O rings, shared between a user process and the
+   kernel.  The process fills in submission queue entries and
+   advances SQ_TAIL; the aio_enter() system call takes entries
+   from SQ_HEAD onward, carries them out in the background, and
+   posts a completion queue entry for each at CQ_TAIL as it
+   finishes.  The process consumes completions and advances
+   CQ_HEAD.  Indexes run freely; entry I of a ring is at slot
+   I % ENTRIES. */
+
+/* Operations. */
+enum aio_op
+  {
+    AIO_READ,                   /* Like pread(FD, BUF, LEN, OFFSET). */
+    AIO_WRITE,                  /* Like pwrite(FD, BUF, LEN, OFFSET). */
+    AIO_OPEN,                   /* Like open(BUF). */
+    AIO_CLOSE                   /* Like close(FD). */
+  };
+
+/* Submission queue entry. */
+struct aio_sqe
+  {
+    int op;                     /* One of enum aio_op. */
+    int fd;                     /* File descriptor. */
+    void *buf;                  /* Data buffer, or file name to open. */
+    unsigned len;               /* Bytes to transfer. */
+    unsigned offset;            /* Offset in file. */
+    unsigned user_data;         /* Passed through to the completion. */
+  };
+
+/* Completion queue entry. */
+struct aio_cqe
+  {
+    unsigned user_data;         /* From the submission. */
+    int result;                 /* As from the equivalent system call. */
+  };
+
+/* A submission ring and a completion ring. */
+struct aio_ring
+  {
+    unsigned sq_head;           /* Next submission, set by the kernel. */
+    unsigned sq_tail;           /* End of submissions, set by the user. */
+    unsigned cq_head;           /* Next completion, set by the user. */
+    unsigned cq_tail;           /* End of completions, set by the kernel. */
+    unsigned entries;           /* Slots in each ring, a power of 2. */
+    struct aio_sqe *sqes;       /* Submission ring. */
+    struct aio_cqe *cqes;       /* Completion ring. */
+  };
+
+/* Most slots in a ring. */
+#define AIO_MAX_ENTRIES 64
+
+/* Most bytes a single read or write transfers. */
+#define AIO_MAX_LEN 4096
+
+#endif /* lib/aio.h */
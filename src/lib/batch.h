@@ -0,0 +1,17 @@
+#ifndef __LIB_BATCH_H
+#define __LIB_BATCH_H
+
+#include <stdint.h>
+
+/* One system call in a batch run by the batch() system call. */
+struct syscall_rec
+  {
+    int number;                 /* System call number, SYS_*. */
+    int result;                 /* Return value, set by the kernel. */
+    uint32_t args[4];           /* Arguments. */
+  };
+
+/* Flags for batch(). */
+#define BATCH_STOP_ON_ERROR 1   /* Stop after the first call that fails. */
+
+#endif /* lib/batch.h */
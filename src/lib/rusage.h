@@ -0,0 +1,17 @@
+#ifndef __LIB_RUSAGE_H
+#define __LIB_RUSAGE_H
+
+/* Memory use and page fault counts for a process, as returned by
+   the getrusage() system call.  Sizes are in pages. */
+struct rusage
+  {
+    unsigned resident;          /* User pages currently in memory. */
+    unsigned peak_resident;     /* Largest value RESIDENT has had. */
+    unsigned page_tables;       /* Page directory and page tables. */
+    unsigned minor_faults;      /* Faults resolved without I/O. */
+    unsigned major_faults;      /* Faults that read a file or swap. */
+    unsigned swapped_out;       /* Pages evicted to swap. */
+    unsigned swapped_in;        /* Pages read back from swap. */
+  };
+
+#endif /* lib/rusage.h */
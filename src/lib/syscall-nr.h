@@ -28,7 +28,29 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_FORK,                   /* Duplicate this process. */
+    SYS_GETRUSAGE,              /* Report memory use and page faults. */
+    SYS_READV,                  /* Read from a file into several buffers. */
+    SYS_WRITEV,                 /* Write to a file from several buffers. */
+    SYS_PREAD,                  /* Read from a file at a given offset. */
+    SYS_PWRITE,                 /* Write to a file at a given offset. */
+    SYS_COPY_FILE_RANGE,        /* Copy data from one file to another. */
+    SYS_AIO_SETUP,              /* Set up asynchronous I/O rings. */
+    SYS_AIO_ENTER,              /* Submit and complete asynchronous I/O. */
+    SYS_BATCH,                  /* Make several system calls at once. */
+    SYS_PIPE,                   /* Create a pipe. */
+    SYS_DUP2,                   /* Duplicate a file descriptor. */
+    SYS_SHM_CREATE,             /* Create a shared memory segment. */
+    SYS_SHM_ATTACH,             /* Map a shared memory segment. */
+    SYS_SHM_DETACH,             /* Unmap a shared memory segment. */
+    SYS_THREAD_CREATE,          /* Start a thread in this process. */
+    SYS_THREAD_EXIT,            /* Terminate this thread. */
+    SYS_THREAD_JOIN,            /* Wait for a thread to exit. */
+    SYS_FUTEX_WAIT,             /* Sleep on a futex. */
+    SYS_FUTEX_WAKE              /* Wake threads sleeping on a futex. */
   };
 
 #endif /* lib/syscall-nr.h */
@@ -0,0 +1,49 @@
+#include <syscall.h>
+#include <stdarg.h>
+#include <stddef.h>
+
+/* Starts building a batch B of at most MAX system calls in the
+   array RECS. */
+void
+batch_init (struct batch *b, struct syscall_rec *recs, unsigned max)
+{
+  b->recs = recs;
+  b->cnt = 0;
+  b->max = max;
+}
+
+/* Adds system call NUMBER, taking the ARGC arguments that
+   follow, to batch B.  Returns the record for the call, whose
+   `result' member holds its return value once the batch has run,
+   or a null pointer if B is full or ARGC is too large. */
+struct syscall_rec *
+batch_add (struct batch *b, int number, int argc, ...)
+{
+  struct syscall_rec *rec;
+  va_list args;
+  int i;
+
+  if (b->cnt >= b->max
+      || argc < 0 || argc > (int) (sizeof rec->args / sizeof *rec->args))
+    return NULL;
+
+  rec = &b->recs[b->cnt++];
+  rec->number = number;
+  rec->result = -1;
+  va_start (args, argc);
+  for (i = 0; i < argc; i++)
+    rec->args[i] = va_arg (args, uint32_t);
+  va_end (args);
+  return rec;
+}
+
+/* Runs the calls added to batch B, in order, with FLAGS as for
+   batch(), then empties B for reuse.  Returns the number of
+   calls made. */
+int
+batch_run (struct batch *b, unsigned flags)
+{
+  int ran = batch (b->recs, b->cnt, flags);
+  b->cnt = 0;
+  return ran;
+}
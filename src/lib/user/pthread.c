@@ -0,0 +1,239 @@
+#include <pthread.h>
+#include <limits.h>
+#include <stdint.h>
+#include <syscall.h>
+
+/* Threads run START (ARG) by way of run_thread() on a stack from
+   `stacks', and the slot with the same index records what
+   pthread_join() needs.  Mutexes and condition variables keep
+   their state in an int that is changed with atomic
+   instructions, and only call into the kernel, through
+   futex_wait() and futex_wake(), to sleep and to wake sleepers;
+   the mutex follows Ulrich Drepper's "Futexes Are Tricky". */
+
+/* A thread's stack pool slot. */
+struct slot
+  {
+    bool in_use;                /* Is the slot taken? */
+    pthread_t tid;              /* Thread running in it, or -1. */
+    void *(*start) (void *);    /* Function to run. */
+    void *arg;                  /* Argument to START. */
+    void *retval;               /* What pthread_join() reports. */
+  };
+
+static struct slot slots[PTHREAD_THREADS_MAX];
+static uint8_t stacks[PTHREAD_THREADS_MAX][PTHREAD_STACK_SIZE];
+
+/* Protects the `in_use' and `tid' members of `slots'. */
+static pthread_mutex_t slots_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* If *P equals OLD, sets it to NEW.  Returns the old value of *P
+   either way. */
+static inline int
+compare_exchange (int *p, int old, int new)
+{
+  int prev;
+  asm volatile ("lock cmpxchgl %2, %1"
+                : "=a" (prev), "+m" (*p)
+                : "r" (new), "0" (old)
+                : "memory");
+  return prev;
+}
+
+/* Sets *P to NEW and returns its old value. */
+static inline int
+exchange (int *p, int new)
+{
+  asm volatile ("xchgl %0, %1" : "+r" (new), "+m" (*p) : : "memory");
+  return new;
+}
+
+/* Increments *P. */
+static inline void
+increment (int *p)
+{
+  asm volatile ("lock incl %0" : "+m" (*p) : : "memory");
+}
+
+/* Returns the slot of the running thread, or a null pointer for
+   the main thread. */
+static struct slot *
+current_slot (void)
+{
+  uint8_t *sp;
+
+  asm ("movl %%esp, %0" : "=g" (sp));
+  if (sp < stacks[0] || sp >= stacks[PTHREAD_THREADS_MAX])
+    return NULL;
+  return &slots[(sp - stacks[0]) / PTHREAD_STACK_SIZE];
+}
+
+/* Entry point of a new thread, whose slot is SLOT_. */
+static void
+run_thread (void *slot_)
+{
+  struct slot *slot = slot_;
+
+  pthread_exit (slot->start (slot->arg));
+}
+
+/* Starts a thread that runs START (ARG) and stores its
+   identifier in *THREAD.  Returns 0 if successful, -1 if
+   PTHREAD_THREADS_MAX threads already exist or the kernel
+   refuses. */
+int
+pthread_create (pthread_t *thread, void *(*start) (void *), void *arg)
+{
+  struct slot *slot = NULL;
+  int tid;
+  size_t i;
+
+  pthread_mutex_lock (&slots_lock);
+  for (i = 0; i < PTHREAD_THREADS_MAX; i++)
+    if (!slots[i].in_use)
+      {
+        slot = &slots[i];
+        slot->in_use = true;
+        slot->tid = -1;
+        break;
+      }
+  pthread_mutex_unlock (&slots_lock);
+  if (slot == NULL)
+    return -1;
+
+  slot->start = start;
+  slot->arg = arg;
+  slot->retval = NULL;
+  tid = thread_create (run_thread, slot, stacks[i + 1]);
+  pthread_mutex_lock (&slots_lock);
+  if (tid == -1)
+    slot->in_use = false;
+  else
+    slot->tid = tid;
+  pthread_mutex_unlock (&slots_lock);
+  if (tid == -1)
+    return -1;
+  *thread = tid;
+  return 0;
+}
+
+/* Waits for THREAD to exit and, if RETVAL is nonnull, stores
+   the value it returned or passed to pthread_exit() in *RETVAL.
+   Returns 0 if successful, -1 if THREAD is not a thread that has
+   not been joined yet. */
+int
+pthread_join (pthread_t thread, void **retval)
+{
+  struct slot *slot = NULL;
+  size_t i;
+
+  pthread_mutex_lock (&slots_lock);
+  for (i = 0; i < PTHREAD_THREADS_MAX; i++)
+    if (slots[i].in_use && slots[i].tid == thread)
+      slot = &slots[i];
+  pthread_mutex_unlock (&slots_lock);
+  if (slot == NULL || thread_join (thread) != 0)
+    return -1;
+
+  if (retval != NULL)
+    *retval = slot->retval;
+  pthread_mutex_lock (&slots_lock);
+  slot->in_use = false;
+  pthread_mutex_unlock (&slots_lock);
+  return 0;
+}
+
+/* Ends the running thread, which pthread_join() will report as
+   returning RETVAL.  In the main thread, ends the process as
+   exit (0) does. */
+void
+pthread_exit (void *retval)
+{
+  struct slot *slot = current_slot ();
+
+  if (slot != NULL)
+    slot->retval = retval;
+  thread_exit ();
+}
+
+/* Initializes mutex M to unlocked. */
+void
+pthread_mutex_init (pthread_mutex_t *m)
+{
+  m->state = 0;
+}
+
+/* Locks mutex M, sleeping until it is unlocked if need be. */
+void
+pthread_mutex_lock (pthread_mutex_t *m)
+{
+  int c = compare_exchange (&m->state, 0, 1);
+
+  if (c == 0)
+    return;
+
+  /* Mark M as waited on, so that its holder will wake us. */
+  if (c != 2)
+    c = exchange (&m->state, 2);
+  while (c != 0)
+    {
+      futex_wait (&m->state, 2);
+      c = exchange (&m->state, 2);
+    }
+}
+
+/* Locks mutex M and returns true if it is unlocked, otherwise
+   returns false without waiting. */
+bool
+pthread_mutex_trylock (pthread_mutex_t *m)
+{
+  return compare_exchange (&m->state, 0, 1) == 0;
+}
+
+/* Unlocks mutex M, which the running thread must hold, and wakes
+   a thread waiting for it, if any. */
+void
+pthread_mutex_unlock (pthread_mutex_t *m)
+{
+  if (exchange (&m->state, 0) == 2)
+    futex_wake (&m->state, 1);
+}
+
+/* Initializes condition variable C. */
+void
+pthread_cond_init (pthread_cond_t *c)
+{
+  c->seq = 0;
+}
+
+/* Unlocks mutex M, which the running thread must hold, waits for
+   C to be signaled, and locks M again.  As with POSIX threads,
+   the wait may also end without a signal, so the caller should
+   recheck its condition in a loop. */
+void
+pthread_cond_wait (pthread_cond_t *c, pthread_mutex_t *m)
+{
+  int seq = *(volatile int *) &c->seq;
+
+  /* A signal after we read SEQ changes it, so futex_wait() will
+     not sleep through the signal. */
+  pthread_mutex_unlock (m);
+  futex_wait (&c->seq, seq);
+  pthread_mutex_lock (m);
+}
+
+/* Wakes one thread waiting on C, if any. */
+void
+pthread_cond_signal (pthread_cond_t *c)
+{
+  increment (&c->seq);
+  futex_wake (&c->seq, 1);
+}
+
+/* Wakes every thread waiting on C. */
+void
+pthread_cond_broadcast (pthread_cond_t *c)
+{
+  increment (&c->seq);
+  futex_wake (&c->seq, INT_MAX);
+}
@@ -0,0 +1,53 @@
+#ifndef __LIB_USER_PTHREAD_H
+#define __LIB_USER_PTHREAD_H
+
+#include <debug.h>
+#include <stdbool.h>
+
+/* Threads, mutexes and condition variables, after POSIX threads
+   but without attributes or error numbers.  Threads run on stacks
+   from a fixed pool, so at most PTHREAD_THREADS_MAX of them, not
+   counting the main thread, may exist at once. */
+
+/* Most threads that may be created and not yet joined. */
+#define PTHREAD_THREADS_MAX 8
+
+/* Size of each thread's stack, in bytes. */
+#define PTHREAD_STACK_SIZE (16 * 1024)
+
+/* A thread. */
+typedef int pthread_t;
+
+/* A mutex. */
+typedef struct
+  {
+    int state;          /* 0: unlocked, 1: locked, 2: also waited on. */
+  }
+pthread_mutex_t;
+
+#define PTHREAD_MUTEX_INITIALIZER { 0 }
+
+/* A condition variable. */
+typedef struct
+  {
+    int seq;            /* Incremented by every signal. */
+  }
+pthread_cond_t;
+
+#define PTHREAD_COND_INITIALIZER { 0 }
+
+int pthread_create (pthread_t *, void *(*start) (void *), void *arg);
+int pthread_join (pthread_t, void **retval);
+void pthread_exit (void *retval) NO_RETURN;
+
+void pthread_mutex_init (pthread_mutex_t *);
+void pthread_mutex_lock (pthread_mutex_t *);
+bool pthread_mutex_trylock (pthread_mutex_t *);
+void pthread_mutex_unlock (pthread_mutex_t *);
+
+void pthread_cond_init (pthread_cond_t *);
+void pthread_cond_wait (pthread_cond_t *, pthread_mutex_t *);
+void pthread_cond_signal (pthread_cond_t *);
+void pthread_cond_broadcast (pthread_cond_t *);
+
+#endif /* lib/user/pthread.h */
@@ -3,6 +3,12 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <aio.h>
+#include <batch.h>
+#include <rusage.h>
+#include <stdint.h>
+#include <uio.h>
+#include <vdso.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -45,4 +51,46 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Extensions. */
+void syscall_probe (void);
+extern bool syscall_fast;
+pid_t fork (void);
+bool getrusage (struct rusage *);
+int readv (int fd, const struct iovec *, int iovcnt);
+int writev (int fd, const struct iovec *, int iovcnt);
+int pread (int fd, void *buffer, unsigned length, unsigned offset);
+int pwrite (int fd, const void *buffer, unsigned length, unsigned offset);
+int copy_file_range (int in_fd, int out_fd, unsigned length);
+bool aio_setup (struct aio_ring *);
+int aio_enter (unsigned min_complete);
+int batch (struct syscall_rec *, unsigned cnt, unsigned flags);
+bool pipe (int fds[2]);
+int dup2 (int old_fd, int new_fd);
+int shm_create (size_t size);
+void *shm_attach (int id);
+bool shm_detach (void *addr);
+int thread_create (void (*start) (void *), void *arg, void *stack);
+void thread_exit (void) NO_RETURN;
+int thread_join (int tid);
+int futex_wait (int *uaddr, int val);
+int futex_wake (int *uaddr, int cnt);
+
+/* Helper for building batches of system calls. */
+struct batch
+  {
+    struct syscall_rec *recs;   /* Calls. */
+    unsigned cnt;               /* Number of calls added. */
+    unsigned max;               /* Number of elements in RECS. */
+  };
+
+void batch_init (struct batch *, struct syscall_rec *, unsigned max);
+struct syscall_rec *batch_add (struct batch *, int number, int argc, ...);
+int batch_run (struct batch *, unsigned flags);
+
+/* Read from kernel-shared pages, without a system call. */
+void clock_read (struct vdso_time *);
+int64_t clock_ticks (void);
+int64_t clock_usecs (void);
+pid_t getpid (void);
+
 #endif /* lib/user/syscall.h */
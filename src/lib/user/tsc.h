@@ -0,0 +1,17 @@
+#ifndef __LIB_USER_TSC_H
+#define __LIB_USER_TSC_H
+
+#include <stdint.h>
+
+/* Reads the CPU's time-stamp counter, for timing short stretches
+   of code in cycles. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint32_t lo, hi;
+
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+}
+
+#endif /* lib/user/tsc.h */
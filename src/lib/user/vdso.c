@@ -0,0 +1,79 @@
+#include <syscall.h>
+#include <tsc.h>
+#include <vdso.h>
+
+/* Reading the kernel-shared pages (see <vdso.h>), which takes no
+   system calls. */
+
+static const volatile struct vdso_time *const vdso_time
+  = (const volatile struct vdso_time *) VDSO_TIME_ADDR;
+static const volatile struct vdso_proc *const vdso_proc
+  = (const volatile struct vdso_proc *) VDSO_PROC_ADDR;
+
+/* Stores a consistent copy of the kernel's time page in *T. */
+void
+clock_read (struct vdso_time *t)
+{
+  unsigned seq;
+
+  do
+    {
+      seq = vdso_time->seq;
+      asm volatile ("" : : : "memory");
+      t->ticks = vdso_time->ticks;
+      t->tsc = vdso_time->tsc;
+      t->tsc_per_tick = vdso_time->tsc_per_tick;
+      t->timer_freq = vdso_time->timer_freq;
+      t->ready_threads = vdso_time->ready_threads;
+      t->load_avg = vdso_time->load_avg;
+      asm volatile ("" : : : "memory");
+    }
+  while ((seq & 1) != 0 || seq != vdso_time->seq);
+  t->seq = seq;
+}
+
+/* Returns the number of timer ticks since the OS booted. */
+int64_t
+clock_ticks (void)
+{
+  struct vdso_time t;
+
+  clock_read (&t);
+  return t.ticks;
+}
+
+/* Returns the number of microseconds since the OS booted, with
+   better than tick resolution once the kernel has measured the
+   rate of the CPU's time-stamp counter.  The result never goes
+   backward. */
+int64_t
+clock_usecs (void)
+{
+  struct vdso_time t;
+  uint64_t tsc, delta;
+  int64_t usecs;
+
+  clock_read (&t);
+  usecs = t.ticks * 1000000 / t.timer_freq;
+  if (t.tsc_per_tick != 0)
+    {
+      tsc = rdtsc ();
+      delta = tsc > t.tsc ? tsc - t.tsc : 0;
+
+      /* If the next tick is late, stop just short of it rather
+         than fall back to the start of this one, so that a later
+         read cannot return an earlier time. */
+      if (delta >= t.tsc_per_tick)
+        delta = t.tsc_per_tick - 1;
+      usecs += (int64_t) (delta * 1000000
+                          / ((uint64_t) t.tsc_per_tick * t.timer_freq));
+    }
+  return usecs;
+}
+
+/* Returns the process identifier of the calling process. */
+pid_t
+getpid (void)
+{
+  return vdso_proc->pid;
+}
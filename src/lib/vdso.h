@@ -0,0 +1,35 @@
+#ifndef __LIB_VDSO_H
+#define __LIB_VDSO_H
+
+#include <stdint.h>
+
+/* User addresses of the two pages that the kernel maps, read
+   only, into every process, just below where executables are
+   loaded.  User programs read the time and their process
+   identifier from them without making a system call. */
+#define VDSO_TIME_ADDR 0x08000000 /* struct vdso_time, shared. */
+#define VDSO_PROC_ADDR 0x08001000 /* struct vdso_proc, per process. */
+
+/* Time and scheduler figures, updated by the timer interrupt.
+   SEQ is odd while an update is in progress and changes with
+   every update, so a reader that finds the same even value
+   before and after reading the other members has a consistent
+   copy. */
+struct vdso_time
+  {
+    unsigned seq;               /* Update sequence number. */
+    int64_t ticks;              /* Timer ticks since boot. */
+    uint64_t tsc;               /* Time-stamp counter at that tick. */
+    uint32_t tsc_per_tick;      /* TSC cycles per tick, 0 until known. */
+    int timer_freq;             /* Timer ticks per second. */
+    int ready_threads;          /* Threads ready to run. */
+    int load_avg;               /* 100 times the load average. */
+  };
+
+/* Information about the process it is mapped into. */
+struct vdso_proc
+  {
+    int pid;                    /* Process identifier. */
+  };
+
+#endif /* lib/vdso.h */
@@ -0,0 +1,90 @@
+/* Fills the kernel pool with the pages of a cache that has a
+   shrinker, then allocates more pages.  Each allocation should
+   succeed by making the shrinker free cached pages, oldest
+   first. */
+
+#include <list.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+
+#define ALLOC_CNT 64
+
+/* A cached page.  The page itself holds this header. */
+struct cached_page
+  {
+    struct list_elem elem;
+    unsigned seq;
+  };
+
+static struct list cache;
+static bool cache_shrinkable;
+static unsigned next_freed_seq;
+static bool lru_order = true;
+
+static size_t
+cache_count (void)
+{
+  return cache_shrinkable ? list_size (&cache) : 0;
+}
+
+static size_t
+cache_scan (size_t nr)
+{
+  size_t cnt;
+
+  for (cnt = 0; cnt < nr && !list_empty (&cache); cnt++)
+    {
+      struct cached_page *p = list_entry (list_pop_front (&cache),
+                                          struct cached_page, elem);
+      if (p->seq != next_freed_seq++)
+        lru_order = false;
+      palloc_free_page (p);
+    }
+  return cnt;
+}
+
+static struct shrinker shrinker =
+  {
+    .flags = 0,
+    .count = cache_count,
+    .scan = cache_scan,
+  };
+
+void
+test_palloc_shrink (void)
+{
+  void *pages[ALLOC_CNT];
+  struct cached_page *p;
+  unsigned seq = 0;
+  int i;
+
+  list_init (&cache);
+  palloc_register_shrinker (&shrinker);
+
+  msg ("fill the kernel pool with cached pages");
+  while ((p = palloc_get_page (0)) != NULL)
+    {
+      p->seq = seq++;
+      list_push_back (&cache, &p->elem);
+    }
+  if (seq < ALLOC_CNT)
+    fail ("only %u pages cached", seq);
+  cache_shrinkable = true;
+
+  msg ("allocate %d pages", ALLOC_CNT);
+  for (i = 0; i < ALLOC_CNT; i++)
+    {
+      pages[i] = palloc_get_page (0);
+      if (pages[i] == NULL)
+        fail ("allocation %d failed with %zu pages still cached",
+              i, list_size (&cache));
+    }
+  if (!lru_order)
+    fail ("cache was not shrunk oldest first");
+
+  for (i = 0; i < ALLOC_CNT; i++)
+    palloc_free_page (pages[i]);
+  cache_scan (list_size (&cache));
+  pass ();
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-shrink) begin
+(palloc-shrink) fill the kernel pool with cached pages
+(palloc-shrink) allocate 64 pages
+(palloc-shrink) PASS
+(palloc-shrink) end
+EOF
+pass;
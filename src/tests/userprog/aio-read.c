@@ -0,0 +1,52 @@
+/* Opens, reads and closes "sample.txt" through asynchronous I/O
+   rings and checks each completion. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static struct aio_sqe sqes[4];
+static struct aio_cqe cqes[4];
+static struct aio_ring ring = {0, 0, 0, 0, 4, sqes, cqes};
+static char buf[sizeof sample];
+
+/* Submits one operation and returns the result of its
+   completion. */
+static int
+do_aio (int op, int fd, void *buffer, unsigned len)
+{
+  struct aio_sqe *sqe = &sqes[ring.sq_tail % 4];
+  struct aio_cqe *cqe;
+
+  sqe->op = op;
+  sqe->fd = fd;
+  sqe->buf = buffer;
+  sqe->len = len;
+  sqe->offset = 0;
+  sqe->user_data = ring.sq_tail;
+  ring.sq_tail++;
+  if (aio_enter (1) != 1)
+    fail ("aio_enter() did not post a completion");
+  cqe = &cqes[ring.cq_head++ % 4];
+  if (cqe->user_data != ring.sq_tail - 1)
+    fail ("completion is for the wrong submission");
+  return cqe->result;
+}
+
+void
+test_main (void) 
+{
+  int handle;
+
+  CHECK (aio_setup (&ring), "aio_setup");
+  CHECK ((handle = do_aio (AIO_OPEN, 0, "sample.txt", 0)) > 1,
+         "open \"sample.txt\"");
+  CHECK (do_aio (AIO_READ, handle, buf, sizeof sample - 1)
+         == sizeof sample - 1, "read \"sample.txt\"");
+  if (memcmp (buf, sample, sizeof sample - 1))
+    fail ("data read differs from \"sample.txt\"");
+  CHECK (do_aio (AIO_CLOSE, handle, NULL, 0) == 0, "close \"sample.txt\"");
+  CHECK (do_aio (AIO_READ, handle, buf, 1) == -1, "read closed file");
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(aio-read) begin
+(aio-read) aio_setup
+(aio-read) open "sample.txt"
+(aio-read) read "sample.txt"
+(aio-read) close "sample.txt"
+(aio-read) read closed file
+(aio-read) end
+aio-read: exit(0)
+EOF
+pass;
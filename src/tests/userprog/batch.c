@@ -0,0 +1,40 @@
+/* Makes several system calls in one batch() and checks their
+   results, then checks that BATCH_STOP_ON_ERROR stops at the
+   first failing call. */
+
+#include <syscall.h>
+#include <syscall-nr.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct syscall_rec recs[4];
+  struct syscall_rec *sizes[2];
+  struct batch b;
+
+  batch_init (&b, recs, 4);
+  batch_add (&b, SYS_CREATE, 2, "test.txt", 100);
+  batch_add (&b, SYS_CREATE, 2, "test2.txt", 200);
+  CHECK (batch_run (&b, 0) == 2, "create two files in a batch");
+  CHECK (recs[0].result && recs[1].result, "both creates succeeded");
+
+  batch_add (&b, SYS_OPEN, 1, "test.txt");
+  batch_add (&b, SYS_OPEN, 1, "test2.txt");
+  CHECK (batch_run (&b, 0) == 2, "open two files in a batch");
+  CHECK (recs[0].result > 1 && recs[1].result > 1, "both opens succeeded");
+
+  sizes[0] = batch_add (&b, SYS_FILESIZE, 1, recs[0].result);
+  sizes[1] = batch_add (&b, SYS_FILESIZE, 1, recs[1].result);
+  CHECK (batch_run (&b, 0) == 2, "get two file sizes in a batch");
+  CHECK (sizes[0]->result == 100 && sizes[1]->result == 200,
+         "file sizes are right");
+
+  batch_add (&b, SYS_REMOVE, 1, "test.txt");
+  batch_add (&b, SYS_REMOVE, 1, "no-such-file");
+  batch_add (&b, SYS_REMOVE, 1, "test2.txt");
+  CHECK (batch_run (&b, BATCH_STOP_ON_ERROR) == 2,
+         "batch stops at the failing remove");
+  CHECK (recs[0].result && !recs[1].result, "first remove succeeded");
+}
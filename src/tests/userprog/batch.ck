@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(batch) begin
+(batch) create two files in a batch
+(batch) both creates succeeded
+(batch) open two files in a batch
+(batch) both opens succeeded
+(batch) get two file sizes in a batch
+(batch) file sizes are right
+(batch) batch stops at the failing remove
+(batch) first remove succeeded
+(batch) end
+batch: exit(0)
+EOF
+pass;
@@ -0,0 +1,33 @@
+/* Child process run by shm-exec test.
+
+   Attaches the shared memory segment whose identifier is the
+   first command-line argument, checks what shm-exec wrote into
+   it, and inverts the second half. */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/userprog/shm.h"
+
+const char *test_name = "child-shm";
+
+int
+main (int argc UNUSED, char *argv[]) 
+{
+  char *buf;
+  size_t i;
+
+  if (!isdigit (*argv[1]))
+    fail ("bad command-line arguments");
+  CHECK ((buf = shm_attach (atoi (argv[1]))) != NULL, "shm_attach");
+  for (i = 0; i < SHM_SIZE; i++)
+    if (buf[i] != shm_byte (i))
+      fail ("byte %zu is %02hhx, expected %02hhx", i, buf[i], shm_byte (i));
+  for (i = SHM_SIZE / 2; i < SHM_SIZE; i++)
+    buf[i] = ~buf[i];
+  CHECK (shm_detach (buf), "shm_detach");
+
+  return 0;
+}
@@ -0,0 +1,34 @@
+/* Opens "sample.txt" twice and uses copy_file_range() to copy
+   the file onto itself.  A copy whose destination overlaps its
+   source must fail without changing the file, since it would
+   read back bytes it had already overwritten.  A copy between
+   parts that do not overlap must work. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char expected[sizeof sample - 1];
+  int in, out;
+
+  CHECK ((in = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((out = open ("sample.txt")) > 1, "open \"sample.txt\" again");
+
+  seek (out, 10);
+  CHECK (copy_file_range (in, out, 100) == -1, "overlapping copy fails");
+  check_file ("sample.txt", sample, sizeof sample - 1);
+
+  seek (out, 100);
+  CHECK (copy_file_range (in, out, 50) == 50, "disjoint copy succeeds");
+  close (in);
+  close (out);
+
+  memcpy (expected, sample, sizeof expected);
+  memcpy (expected + 100, sample, 50);
+  check_file ("sample.txt", expected, sizeof expected);
+}
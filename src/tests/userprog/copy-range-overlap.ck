@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(copy-range-overlap) begin
+(copy-range-overlap) open "sample.txt"
+(copy-range-overlap) open "sample.txt" again
+(copy-range-overlap) overlapping copy fails
+(copy-range-overlap) open "sample.txt" for verification
+(copy-range-overlap) verified contents of "sample.txt"
+(copy-range-overlap) close "sample.txt"
+(copy-range-overlap) disjoint copy succeeds
+(copy-range-overlap) open "sample.txt" for verification
+(copy-range-overlap) verified contents of "sample.txt"
+(copy-range-overlap) close "sample.txt"
+(copy-range-overlap) end
+copy-range-overlap: exit(0)
+EOF
+pass;
@@ -0,0 +1,27 @@
+/* Copies "sample.txt" to a new file with copy_file_range() and
+   verifies the copy. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int in, out, byte_cnt;
+
+  CHECK ((in = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (create ("test.txt", sizeof sample - 1), "create \"test.txt\"");
+  CHECK ((out = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  byte_cnt = copy_file_range (in, out, 4096);
+  if (byte_cnt != sizeof sample - 1)
+    fail ("copy_file_range() returned %d instead of %zu",
+          byte_cnt, sizeof sample - 1);
+  CHECK (copy_file_range (in, out, 4096) == 0, "copy at end of file");
+  close (in);
+  close (out);
+
+  check_file ("test.txt", sample, sizeof sample - 1);
+}
@@ -0,0 +1,23 @@
+/* Executes a child process twice, so that the second time its
+   image comes from the kernel's exec cache, then overwrites the
+   start of the child's executable and checks that executing it
+   again fails instead of running the stale cached image. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int fd;
+
+  CHECK (wait (exec ("child-simple")) == 81, "first exec");
+  CHECK (wait (exec ("child-simple")) == 81, "second exec");
+
+  CHECK ((fd = open ("child-simple")) > 1, "open \"child-simple\"");
+  CHECK (write (fd, "junk", 4) == 4, "overwrite ELF header");
+  close (fd);
+
+  msg ("exec(\"child-simple\"): %d", exec ("child-simple"));
+}
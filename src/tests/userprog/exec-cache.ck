@@ -0,0 +1,36 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF', <<'EOF']);
+(exec-cache) begin
+(child-simple) run
+child-simple: exit(81)
+(exec-cache) first exec
+(child-simple) run
+child-simple: exit(81)
+(exec-cache) second exec
+(exec-cache) open "child-simple"
+(exec-cache) overwrite ELF header
+load: child-simple: error loading executable
+child-simple: exit(-1)
+(exec-cache) exec("child-simple"): -1
+(exec-cache) end
+exec-cache: exit(0)
+EOF
+(exec-cache) begin
+(child-simple) run
+child-simple: exit(81)
+(exec-cache) first exec
+(child-simple) run
+child-simple: exit(81)
+(exec-cache) second exec
+(exec-cache) open "child-simple"
+(exec-cache) overwrite ELF header
+load: child-simple: error loading executable
+(exec-cache) exec("child-simple"): -1
+child-simple: exit(-1)
+(exec-cache) end
+exec-cache: exit(0)
+EOF
+pass;
@@ -0,0 +1,31 @@
+/* Executes a child process twice, so that its image is in the
+   kernel's exec cache, then removes the child's executable and
+   creates a different program under the same name.  Checks that
+   executing it runs the new program, both the first time and the
+   second, when its image comes from the cache. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int in, out, size;
+
+  CHECK (wait (exec ("child-simple")) == 81, "first exec");
+  CHECK (wait (exec ("child-simple")) == 81, "second exec");
+
+  CHECK ((in = open ("child-args")) > 1, "open \"child-args\"");
+  size = filesize (in);
+  CHECK (remove ("child-simple"), "remove \"child-simple\"");
+  CHECK (create ("child-simple", size), "create \"child-simple\"");
+  CHECK ((out = open ("child-simple")) > 1, "open \"child-simple\"");
+  CHECK (copy_file_range (in, out, size) == size,
+         "copy \"child-args\" to \"child-simple\"");
+  close (in);
+  close (out);
+
+  CHECK (wait (exec ("child-simple")) == 0, "exec new \"child-simple\"");
+  CHECK (wait (exec ("child-simple")) == 0, "exec it again");
+}
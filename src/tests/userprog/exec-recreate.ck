@@ -0,0 +1,35 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(exec-recreate) begin
+(child-simple) run
+child-simple: exit(81)
+(exec-recreate) first exec
+(child-simple) run
+child-simple: exit(81)
+(exec-recreate) second exec
+(exec-recreate) open "child-args"
+(exec-recreate) remove "child-simple"
+(exec-recreate) create "child-simple"
+(exec-recreate) open "child-simple"
+(exec-recreate) copy "child-args" to "child-simple"
+(args) begin
+(args) argc = 1
+(args) argv[0] = 'child-simple'
+(args) argv[1] = null
+(args) end
+child-simple: exit(0)
+(exec-recreate) exec new "child-simple"
+(args) begin
+(args) argc = 1
+(args) argv[0] = 'child-simple'
+(args) argv[1] = null
+(args) end
+child-simple: exit(0)
+(exec-recreate) exec it again
+(exec-recreate) end
+exec-recreate: exit(0)
+EOF
+pass;
@@ -0,0 +1,40 @@
+/* Makes a pipe the standard output of a child process, by
+   putting its write end at descriptor 1 while the child is
+   started, and checks that everything the child prints arrives
+   through the pipe, followed by end of file once the child
+   exits. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  static const char expected[] = "(child-simple) run\n";
+  char buf[128];
+  int fds[2];
+  pid_t pid;
+  int ofs, n;
+
+  CHECK (pipe (fds), "pipe");
+
+  /* No messages until the console is back. */
+  dup2 (fds[1], STDOUT_FILENO);
+  pid = exec ("child-simple");
+  close (STDOUT_FILENO);
+  close (fds[1]);
+  CHECK (pid != PID_ERROR, "exec child-simple with pipe as output");
+
+  ofs = 0;
+  while ((n = read (fds[0], buf + ofs, sizeof buf - ofs - 1)) > 0)
+    ofs += n;
+  buf[ofs] = '\0';
+  close (fds[0]);
+  if (strcmp (buf, expected))
+    fail ("read \"%s\" from pipe, expected \"%s\"", buf, expected);
+  msg ("child's output came through the pipe");
+  CHECK (wait (pid) == 81, "wait for child");
+}
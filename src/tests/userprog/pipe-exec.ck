@@ -0,0 +1,33 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF', <<'EOF', <<'EOF']);
+(pipe-exec) begin
+(pipe-exec) pipe
+child-simple: exit(81)
+(pipe-exec) exec child-simple with pipe as output
+(pipe-exec) child's output came through the pipe
+(pipe-exec) wait for child
+(pipe-exec) end
+pipe-exec: exit(0)
+EOF
+(pipe-exec) begin
+(pipe-exec) pipe
+(pipe-exec) exec child-simple with pipe as output
+child-simple: exit(81)
+(pipe-exec) child's output came through the pipe
+(pipe-exec) wait for child
+(pipe-exec) end
+pipe-exec: exit(0)
+EOF
+(pipe-exec) begin
+(pipe-exec) pipe
+(pipe-exec) exec child-simple with pipe as output
+(pipe-exec) child's output came through the pipe
+child-simple: exit(81)
+(pipe-exec) wait for child
+(pipe-exec) end
+pipe-exec: exit(0)
+EOF
+pass;
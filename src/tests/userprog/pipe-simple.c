@@ -0,0 +1,38 @@
+/* Writes to a pipe and reads the data back, then checks that
+   reading a pipe whose write end is closed returns end of file,
+   that writing one whose read end is closed fails, and that a
+   pipe cannot be read at an offset. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  static const char message[] = "Hello, pipe!";
+  char buf[64];
+  int fds[2];
+
+  CHECK (pipe (fds), "pipe");
+  CHECK (fds[0] > 2 && fds[1] > 2 && fds[0] != fds[1],
+         "pipe gives two new descriptors");
+  CHECK (write (fds[1], message, sizeof message) == sizeof message,
+         "write to pipe");
+  CHECK (read (fds[1], buf, sizeof buf) == -1, "read write end fails");
+  CHECK (pread (fds[0], buf, sizeof buf, 0) == -1, "pread fails");
+  CHECK (read (fds[0], buf, sizeof buf) == sizeof message, "read from pipe");
+  if (memcmp (buf, message, sizeof message))
+    fail ("read back wrong data");
+
+  close (fds[1]);
+  CHECK (read (fds[0], buf, sizeof buf) == 0, "read at end of file");
+  close (fds[0]);
+
+  CHECK (pipe (fds), "pipe");
+  close (fds[0]);
+  CHECK (write (fds[1], message, sizeof message) == -1,
+         "write without reader fails");
+  close (fds[1]);
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-simple) begin
+(pipe-simple) pipe
+(pipe-simple) pipe gives two new descriptors
+(pipe-simple) write to pipe
+(pipe-simple) read write end fails
+(pipe-simple) pread fails
+(pipe-simple) read from pipe
+(pipe-simple) read at end of file
+(pipe-simple) pipe
+(pipe-simple) write without reader fails
+(pipe-simple) end
+pipe-simple: exit(0)
+EOF
+pass;
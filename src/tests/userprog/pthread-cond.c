@@ -0,0 +1,91 @@
+/* Passes numbers from a producer thread to two consumer threads
+   through a small buffer guarded by a mutex and two condition
+   variables, and checks that every number arrived exactly once. */
+
+#include <pthread.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define BUF_SIZE 4
+#define ITEM_CNT 2000
+#define CONSUMER_CNT 2
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t not_empty = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t not_full = PTHREAD_COND_INITIALIZER;
+static int buf[BUF_SIZE];
+static int head, tail;          /* Items head...tail-1 are in buf. */
+static bool done;               /* Producer has put every item? */
+
+static void *
+produce (void *aux UNUSED)
+{
+  int i;
+
+  for (i = 1; i <= ITEM_CNT; i++)
+    {
+      pthread_mutex_lock (&mutex);
+      while (tail - head == BUF_SIZE)
+        pthread_cond_wait (&not_full, &mutex);
+      buf[tail++ % BUF_SIZE] = i;
+      pthread_cond_signal (&not_empty);
+      pthread_mutex_unlock (&mutex);
+    }
+
+  pthread_mutex_lock (&mutex);
+  done = true;
+  pthread_cond_broadcast (&not_empty);
+  pthread_mutex_unlock (&mutex);
+  return NULL;
+}
+
+/* Returns the sum of the items consumed. */
+static void *
+consume (void *aux UNUSED)
+{
+  int sum = 0;
+
+  for (;;)
+    {
+      pthread_mutex_lock (&mutex);
+      while (head == tail && !done)
+        pthread_cond_wait (&not_empty, &mutex);
+      if (head == tail)
+        {
+          pthread_mutex_unlock (&mutex);
+          break;
+        }
+      sum += buf[head++ % BUF_SIZE];
+      pthread_cond_signal (&not_full);
+      pthread_mutex_unlock (&mutex);
+    }
+  return (void *) sum;
+}
+
+void
+test_main (void) 
+{
+  pthread_t producer, consumers[CONSUMER_CNT];
+  int sum = 0;
+  int i;
+
+  for (i = 0; i < CONSUMER_CNT; i++)
+    CHECK (pthread_create (&consumers[i], consume, NULL) == 0,
+           "start consumer %d", i);
+  CHECK (pthread_create (&producer, produce, NULL) == 0, "start producer");
+
+  CHECK (pthread_join (producer, NULL) == 0, "join producer");
+  for (i = 0; i < CONSUMER_CNT; i++)
+    {
+      void *retval;
+
+      CHECK (pthread_join (consumers[i], &retval) == 0,
+             "join consumer %d", i);
+      sum += (int) retval;
+    }
+  if (sum != ITEM_CNT * (ITEM_CNT + 1) / 2)
+    fail ("items add up to %d, should be %d",
+          sum, ITEM_CNT * (ITEM_CNT + 1) / 2);
+  msg ("items add up to %d", sum);
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pthread-cond) begin
+(pthread-cond) start consumer 0
+(pthread-cond) start consumer 1
+(pthread-cond) start producer
+(pthread-cond) join producer
+(pthread-cond) join consumer 0
+(pthread-cond) join consumer 1
+(pthread-cond) items add up to 2001000
+(pthread-cond) end
+pthread-cond: exit(0)
+EOF
+pass;
@@ -0,0 +1,53 @@
+/* Starts several threads that each increment a shared counter
+   many times with a mutex held, joins them, and checks that no
+   increment was lost and that each thread's return value came
+   through. */
+
+#include <pthread.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define THREAD_CNT 4
+#define ITER_CNT 20000
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static volatile int counter;
+
+static void *
+increment (void *arg)
+{
+  int i;
+
+  for (i = 0; i < ITER_CNT; i++)
+    {
+      pthread_mutex_lock (&mutex);
+      counter++;
+      pthread_mutex_unlock (&mutex);
+    }
+  return arg;
+}
+
+void
+test_main (void) 
+{
+  pthread_t threads[THREAD_CNT];
+  int i;
+
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK (pthread_create (&threads[i], increment, (void *) i) == 0,
+           "pthread_create %d", i);
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      void *retval;
+
+      CHECK (pthread_join (threads[i], &retval) == 0, "pthread_join %d", i);
+      if ((int) retval != i)
+        fail ("thread %d returned %d", i, (int) retval);
+    }
+  CHECK (pthread_join (threads[0], NULL) == -1,
+         "pthread_join again must fail");
+  if (counter != THREAD_CNT * ITER_CNT)
+    fail ("counter is %d, should be %d", counter, THREAD_CNT * ITER_CNT);
+  msg ("counter is %d", counter);
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pthread-mutex) begin
+(pthread-mutex) pthread_create 0
+(pthread-mutex) pthread_create 1
+(pthread-mutex) pthread_create 2
+(pthread-mutex) pthread_create 3
+(pthread-mutex) pthread_join 0
+(pthread-mutex) pthread_join 1
+(pthread-mutex) pthread_join 2
+(pthread-mutex) pthread_join 3
+(pthread-mutex) pthread_join again must fail
+(pthread-mutex) counter is 80000
+(pthread-mutex) end
+pthread-mutex: exit(0)
+EOF
+pass;
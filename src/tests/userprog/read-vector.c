@@ -0,0 +1,38 @@
+/* Reads "sample.txt" with readv() into three buffers and with
+   pread() at an offset, checking that readv() advances the file
+   position and pread() leaves it alone. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char a[10], b[20], c[sizeof sample];
+  struct iovec iov[3] = {{a, sizeof a}, {b, sizeof b}, {c, sizeof c}};
+  char buf[16];
+  int handle;
+  int byte_cnt;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  byte_cnt = readv (handle, iov, 3);
+  if (byte_cnt != sizeof sample - 1)
+    fail ("readv() returned %d instead of %zu", byte_cnt, sizeof sample - 1);
+  if (memcmp (a, sample, sizeof a)
+      || memcmp (b, sample + sizeof a, sizeof b)
+      || memcmp (c, sample + sizeof a + sizeof b,
+                 sizeof sample - 1 - sizeof a - sizeof b))
+    fail ("readv() data differs from \"sample.txt\"");
+  CHECK (tell (handle) == sizeof sample - 1, "tell after readv");
+
+  byte_cnt = pread (handle, buf, sizeof buf, 42);
+  if (byte_cnt != sizeof buf)
+    fail ("pread() returned %d instead of %zu", byte_cnt, sizeof buf);
+  if (memcmp (buf, sample + 42, sizeof buf))
+    fail ("pread() data differs from \"sample.txt\"");
+  CHECK (tell (handle) == sizeof sample - 1, "tell after pread");
+}
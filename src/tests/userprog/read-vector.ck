@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(read-vector) begin
+(read-vector) open "sample.txt"
+(read-vector) tell after readv
+(read-vector) tell after pread
+(read-vector) end
+read-vector: exit(0)
+EOF
+pass;
@@ -0,0 +1,34 @@
+/* Creates a shared memory segment, fills it, and has a child
+   process attach the same segment, check what we wrote, and
+   write into it in turn. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/userprog/shm.h"
+
+void
+test_main (void) 
+{
+  char cmd[64];
+  char *buf;
+  size_t i;
+  int id;
+
+  CHECK ((id = shm_create (SHM_SIZE)) >= 0, "shm_create");
+  CHECK ((buf = shm_attach (id)) != NULL, "shm_attach");
+  for (i = 0; i < SHM_SIZE; i++)
+    buf[i] = shm_byte (i);
+
+  snprintf (cmd, sizeof cmd, "child-shm %d", id);
+  CHECK (wait (exec (cmd)) == 0, "wait(exec(\"child-shm\"))");
+  for (i = 0; i < SHM_SIZE; i++)
+    if (buf[i] != (i < SHM_SIZE / 2 ? shm_byte (i) : (char) ~shm_byte (i)))
+      fail ("byte %zu is %02hhx after child ran", i, buf[i]);
+  msg ("child's writes are visible");
+
+  CHECK (shm_detach (buf), "shm_detach");
+  CHECK (!shm_detach (buf), "shm_detach again must fail");
+  CHECK (shm_attach (id + 1) == NULL, "shm_attach of bad id must fail");
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(shm-exec) begin
+(shm-exec) shm_create
+(shm-exec) shm_attach
+(child-shm) shm_attach
+(child-shm) shm_detach
+child-shm: exit(0)
+(shm-exec) wait(exec("child-shm"))
+(shm-exec) child's writes are visible
+(shm-exec) shm_detach
+(shm-exec) shm_detach again must fail
+(shm-exec) shm_attach of bad id must fail
+(shm-exec) end
+shm-exec: exit(0)
+EOF
+pass;
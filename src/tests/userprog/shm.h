@@ -0,0 +1,15 @@
+#ifndef TESTS_USERPROG_SHM_H
+#define TESTS_USERPROG_SHM_H
+
+/* Size of the segment that shm-exec shares with child-shm, not a
+   multiple of the page size. */
+#define SHM_SIZE (3 * 4096 + 100)
+
+/* Returns the byte that shm-exec writes at offset OFS. */
+static inline char
+shm_byte (size_t ofs) 
+{
+  return ofs % 251;
+}
+
+#endif /* tests/userprog/shm.h */
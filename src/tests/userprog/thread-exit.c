@@ -0,0 +1,26 @@
+/* Has a second thread call exit() while the main thread sleeps
+   on a futex that is never woken, which must end the whole
+   process with the second thread's exit code. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static int never;
+static char stack[4096];
+
+static void
+exit_57 (void *aux UNUSED)
+{
+  exit (57);
+}
+
+void
+test_main (void) 
+{
+  CHECK (thread_create (exit_57, NULL, stack + sizeof stack) != -1,
+         "thread_create");
+  while (futex_wait (&never, 0) == 0)
+    continue;
+  fail ("should have exited with 57");
+}
@@ -0,0 +1,22 @@
+/* Reads the time and process identifier from the kernel-shared
+   pages and checks that they make sense. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int64_t start, usecs;
+
+  CHECK (getpid () > 0, "getpid");
+
+  start = clock_ticks ();
+  usecs = clock_usecs ();
+  while (clock_ticks () == start)
+    if (clock_usecs () < usecs)
+      fail ("clock_usecs() went backward");
+  CHECK (clock_ticks () > start, "clock_ticks advances");
+  CHECK (clock_usecs () > usecs, "clock_usecs advances");
+}
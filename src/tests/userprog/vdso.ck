@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(vdso) begin
+(vdso) getpid
+(vdso) clock_ticks advances
+(vdso) clock_usecs advances
+(vdso) end
+vdso: exit(0)
+EOF
+pass;
@@ -0,0 +1,39 @@
+/* Forks a child that reads and then overwrites a large writable
+   array, and checks that the parent's copy of the array is not
+   affected by the child's writes. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (64 * 1024)
+
+static char buf[SIZE];
+
+void
+test_main (void)
+{
+  pid_t child;
+  size_t i;
+
+  memset (buf, 'p', SIZE);
+  child = fork ();
+  if (child == 0)
+    {
+      /* Child: must see the parent's data, then gets its own
+         copy of every page it writes. */
+      for (i = 0; i < SIZE; i++)
+        if (buf[i] != 'p')
+          exit (1);
+      memset (buf, 'c', SIZE);
+      exit (buf[SIZE - 1] == 'c' ? 81 : 2);
+    }
+
+  CHECK (child > 0, "fork");
+  CHECK (wait (child) == 81, "wait for child");
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != 'p')
+      fail ("byte %zu of parent's array changed to '%c'", i, buf[i]);
+  msg ("parent's array intact");
+}
@@ -0,0 +1,41 @@
+/* Fills 2 MB of memory, more than fits in RAM, with data that
+   compresses well but differs from page to page, then verifies
+   it twice, so that the pages make round trips through swap,
+   mostly through the compressed in-memory tier. */
+
+#include <string.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (2 * 1024 * 1024)
+#define PAGE_SIZE 4096
+
+static char buf[SIZE];
+
+/* Returns the byte expected at offset OFS in buf. */
+static char
+expected (size_t ofs)
+{
+  size_t page = ofs / PAGE_SIZE;
+  return ofs % 64 == 0 ? (char) (page * 7) : (char) (page % 5);
+}
+
+void
+test_main (void)
+{
+  size_t i;
+  int pass;
+
+  msg ("write pass");
+  for (i = 0; i < SIZE; i++)
+    buf[i] = expected (i);
+
+  for (pass = 0; pass < 2; pass++)
+    {
+      msg ("read pass");
+      for (i = 0; i < SIZE; i++)
+        if (buf[i] != expected (i))
+          fail ("byte %zu is 0x%02x, expected 0x%02x",
+                i, buf[i], expected (i));
+    }
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-compress) begin
+(page-compress) write pass
+(page-compress) read pass
+(page-compress) read pass
+(page-compress) end
+EOF
+pass;
@@ -0,0 +1,37 @@
+/* Writes to every page of a static array and checks that
+   getrusage() counts each of them as resident and as a page
+   fault. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_CNT 64
+
+static char buf[PAGE_CNT * 4096];
+
+void
+test_main (void)
+{
+  struct rusage before, after;
+  size_t i;
+
+  CHECK (getrusage (&before), "getrusage");
+  for (i = 0; i < PAGE_CNT; i++)
+    buf[i * 4096] = 1;
+  CHECK (getrusage (&after), "getrusage");
+
+  if (after.resident < before.resident + PAGE_CNT)
+    fail ("resident only grew from %u to %u pages",
+          before.resident, after.resident);
+  if (after.peak_resident < after.resident)
+    fail ("peak of %u pages is below resident %u",
+          after.peak_resident, after.resident);
+  if (after.minor_faults + after.major_faults
+      < before.minor_faults + before.major_faults + PAGE_CNT)
+    fail ("only %u faults counted for %d new pages",
+          (after.minor_faults + after.major_faults)
+          - (before.minor_faults + before.major_faults), PAGE_CNT);
+  if (after.page_tables < 2)
+    fail ("%u page table pages, expected at least 2", after.page_tables);
+}
@@ -0,0 +1,33 @@
+/* Reads all of an 8 MB static array, more than fits in user
+   memory if every page gets its own frame, and checks that it is
+   zero.  Then writes to a few scattered pages and checks that
+   only they changed. */
+
+#include <string.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (8 * 1024 * 1024)
+#define STRIDE (256 * 1024)
+
+static char buf[SIZE];
+
+void
+test_main (void)
+{
+  size_t i;
+
+  msg ("read pass");
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != 0)
+      fail ("byte %zu != 0", i);
+
+  msg ("sparse write pass");
+  for (i = 0; i < SIZE; i += STRIDE)
+    buf[i] = 0x5a;
+
+  msg ("read pass");
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != (i % STRIDE == 0 ? 0x5a : 0))
+      fail ("byte %zu has wrong value 0x%02x", i, buf[i]);
+}
@@ -0,0 +1,102 @@
+#ifndef THREADS_CPU_H
+#define THREADS_CPU_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "threads/flags.h"
+
+/* Feature flags in EDX returned by CPUID leaf 1.
+   See [IA32-v2a] "CPUID". */
+#define CPUID_PSE 0x00000008    /* Page size extensions. */
+#define CPUID_SEP 0x00000800    /* SYSENTER and SYSEXIT. */
+#define CPUID_PGE 0x00002000    /* Global pages. */
+
+/* Model-specific registers for SYSENTER.  See [IA32-v3b] 4.8.7
+   "Fast System Calls". */
+#define MSR_SYSENTER_CS  0x174  /* Kernel code segment. */
+#define MSR_SYSENTER_ESP 0x175  /* Kernel stack pointer. */
+#define MSR_SYSENTER_EIP 0x176  /* Kernel entry point. */
+
+/* Control register 4 bits.  See [IA32-v3a] 2.5 "Control
+   Registers". */
+#define CR4_PSE 0x00000010      /* Page Size Extensions. */
+#define CR4_PGE 0x00000080      /* Page Global Enable. */
+
+/* Returns the feature flags that CPUID leaf 1 reports in EDX, or
+   0 if the CPU is too old to have the CPUID instruction. */
+static inline uint32_t
+cpu_features (void)
+{
+  uint32_t before, after;
+  uint32_t eax, ebx, ecx, edx;
+
+  /* CPUID is supported if software can toggle the ID flag.  See
+     [IA32-v3a] 2.3 "System Flags and Fields in the EFLAGS
+     Register". */
+  asm volatile ("pushfl; popl %0; movl %0, %1; xorl %2, %1; "
+                "pushl %1; popfl; pushfl; popl %1; pushl %0; popfl"
+                : "=&r" (before), "=&r" (after) : "i" (FLAG_ID));
+  if (((before ^ after) & FLAG_ID) == 0)
+    return 0;
+
+  asm volatile ("cpuid"
+                : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+                : "a" (1));
+  return edx;
+}
+
+/* Returns true if the CPU has working SYSENTER and SYSEXIT
+   instructions.  Early Pentium Pro processors report them but do
+   not implement them. */
+static inline bool
+cpu_has_sysenter (void)
+{
+  uint32_t eax, ebx, ecx, edx;
+  unsigned family, model, stepping;
+
+  if ((cpu_features () & CPUID_SEP) == 0)
+    return false;
+  asm volatile ("cpuid"
+                : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+                : "a" (1));
+  family = (eax >> 8) & 0xf;
+  model = (eax >> 4) & 0xf;
+  stepping = eax & 0xf;
+  return !(family == 6 && model < 3 && stepping < 3);
+}
+
+/* Writes VALUE to model-specific register MSR. */
+static inline void
+cpu_write_msr (uint32_t msr, uint64_t value)
+{
+  asm volatile ("wrmsr"
+                : : "c" (msr), "a" ((uint32_t) value),
+                    "d" ((uint32_t) (value >> 32)));
+}
+
+/* Returns the time-stamp counter. */
+static inline uint64_t
+cpu_read_tsc (void)
+{
+  uint32_t lo, hi;
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+}
+
+/* Returns the contents of control register 4. */
+static inline uint32_t
+cpu_read_cr4 (void)
+{
+  uint32_t cr4;
+  asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+  return cr4;
+}
+
+/* Stores CR4 into control register 4. */
+static inline void
+cpu_write_cr4 (uint32_t cr4)
+{
+  asm volatile ("movl %0, %%cr4" : : "r" (cr4) : "memory");
+}
+
+#endif /* threads/cpu.h */
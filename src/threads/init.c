@@ -15,6 +15,7 @@
 #include "devices/timer.h"
 #include "devices/vga.h"
 #include "devices/rtc.h"
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
@@ -25,12 +26,20 @@
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
+#include "userprog/exec-cache.h"
 #include "userprog/gdt.h"
+#include "userprog/shm.h"
 #include "userprog/syscall.h"
 #include "userprog/tss.h"
+#include "userprog/vdso.h"
 #else
 #include "tests/threads/tests.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+#endif
 #ifdef FILESYS
 #include "devices/block.h"
 #include "devices/ide.h"
@@ -116,6 +125,13 @@ main (void)
 #ifdef USERPROG
   exception_init ();
   syscall_init ();
+  vdso_init ();
+  exec_cache_init ();
+  shm_init ();
+  process_init ();
+#endif
+#ifdef VM
+  frame_init ();
 #endif
 
   /* Start thread scheduler and enable interrupts. */
@@ -132,6 +148,10 @@ main (void)
   filesys_init (format_filesys);
 #endif
 
+#ifdef VM
+  swap_init ();
+#endif
+
   printf ("Boot complete.\n");
   
   /* Run actions specified on kernel command line. */
@@ -155,16 +175,43 @@ bss_init (void)
   memset (&_start_bss, 0, &_end_bss - &_start_bss);
 }
 
-/* Populates the base page directory and page table with the
+/* Populates the base page directory and page tables with the
    kernel virtual mapping, and then sets up the CPU to use the
    new page directory.  Points init_page_dir to the page
-   directory it creates. */
+   directory it creates.
+
+   If the CPU supports it, each 4 MB of RAM that does not hold
+   kernel text is mapped with a single 4 MB page instead of a
+   page table, which saves the page table and lets one TLB entry
+   cover all of it.  Kernel text needs 4 kB pages so that it can
+   be read-only. */
 static void
 paging_init (void)
 {
   uint32_t *pd, *pt;
   size_t page;
   extern char _start, _end_kernel_text;
+  uint32_t features = cpu_features ();
+  uint32_t global = 0;
+  bool large = false;
+
+  /* The kernel mapping is the same in every page directory and
+     never changes, so if the CPU supports global pages, mark
+     kernel PTEs global to keep them in the TLB across CR3
+     loads.  See [IA32-v3a] 3.12 "Translation Lookaside Buffers
+     (TLBs)". */
+  if (features & CPUID_PGE)
+    {
+      cpu_write_cr4 (cpu_read_cr4 () | CR4_PGE);
+      global = PTE_G;
+    }
+
+  /* See [IA32-v3a] 3.7.3 "Mixing 4-KByte and 4-MByte Pages". */
+  if (features & CPUID_PSE)
+    {
+      cpu_write_cr4 (cpu_read_cr4 () | CR4_PSE);
+      large = true;
+    }
 
   pd = init_page_dir = palloc_get_page (PAL_ASSERT | PAL_ZERO);
   pt = NULL;
@@ -176,13 +223,23 @@ paging_init (void)
       size_t pte_idx = pt_no (vaddr);
       bool in_kernel_text = &_start <= vaddr && vaddr < &_end_kernel_text;
 
+      if (large
+          && pte_idx == 0
+          && page + PTSPAN / PGSIZE <= init_ram_pages
+          && !(vaddr < &_end_kernel_text && &_start < vaddr + PTSPAN))
+        {
+          pd[pde_idx] = pde_create_large (vaddr) | global;
+          page += PTSPAN / PGSIZE - 1;
+          continue;
+        }
+
       if (pd[pde_idx] == 0)
         {
           pt = palloc_get_page (PAL_ASSERT | PAL_ZERO);
           pd[pde_idx] = pde_create (pt);
         }
 
-      pt[pte_idx] = pte_create_kernel (vaddr, !in_kernel_text);
+      pt[pte_idx] = pte_create_kernel (vaddr, !in_kernel_text) | global;
     }
 
   /* Store the physical address of the page directory into CR3
@@ -264,6 +321,14 @@ parse_options (char **argv)
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
+      else if (!strcmp (name, "-rusage"))
+        process_show_rusage = true;
+#endif
+#ifdef VM
+      else if (!strcmp (name, "-stk"))
+        page_stack_limit = atoi (value);
+      else if (!strcmp (name, "-zswap"))
+        swap_cache_pages = atoi (value);
 #endif
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
@@ -386,6 +451,11 @@ usage (void)
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+          "  -rusage            Print memory use and page faults at exit.\n"
+#endif
+#ifdef VM
+          "  -stk=COUNT         Limit user stacks to COUNT pages.\n"
+          "  -zswap=COUNT       Keep up to COUNT pages of compressed swap in RAM.\n"
 #endif
           );
   shutdown_power_off ();
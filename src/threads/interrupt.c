@@ -8,6 +8,10 @@
 #include "threads/io.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#ifdef USERPROG
+#include "userprog/gdt.h"
+#include "userprog/process.h"
+#endif
 #include "devices/timer.h"
 
 /* Programmable Interrupt Controller (PIC) registers.
@@ -385,6 +389,16 @@ intr_handler (struct intr_frame *frame)
 
       if (yield_on_return) 
         thread_yield (); 
+
+#ifdef USERPROG
+      /* A thread whose process another thread has ended stops
+         here instead of going back to user mode. */
+      if (frame->cs == SEL_UCSEG && process_is_dying ())
+        {
+          intr_enable ();
+          thread_exit ();
+        }
+#endif
     }
 }
 
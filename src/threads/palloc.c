@@ -23,7 +23,17 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Kernel caches register shrinkers, so that running out of pages
+   does not make an allocation fail while some of them hold memory
+   they could give back.  When a pool is exhausted, each shrinker
+   for that pool is asked in turn to free a batch of its least
+   recently used objects, and the allocation is retried, until it
+   succeeds or no shrinker frees anything more. */
+
+/* Number of objects to ask a shrinker to free at a time. */
+#define SHRINK_BATCH 32
 
 /* A memory pool. */
 struct pool
@@ -36,9 +46,21 @@ struct pool
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
+/* Registered shrinkers.  SHRINK_LOCK serializes reclaim, and lets
+   an allocation made by a shrinker itself fail instead of
+   recursing. */
+static struct list shrinkers;
+static struct lock shrink_lock;
+
+/* Statistics. */
+static long long shrink_cnt;            /* # of times pools ran out. */
+static long long shrink_freed_cnt;      /* # of objects freed. */
+
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static size_t scan_pool (struct pool *, size_t page_cnt);
+static bool shrink (enum palloc_flags);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -59,6 +81,9 @@ palloc_init (size_t user_page_limit)
   init_pool (&kernel_pool, free_start, kernel_pages, "kernel pool");
   init_pool (&user_pool, free_start + kernel_pages * PGSIZE,
              user_pages, "user pool");
+
+  list_init (&shrinkers);
+  lock_init (&shrink_lock);
 }
 
 /* Obtains and returns a group of PAGE_CNT contiguous free pages.
@@ -77,9 +102,9 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
+  page_idx = scan_pool (pool, page_cnt);
+  while (page_idx == BITMAP_ERROR && shrink (flags))
+    page_idx = scan_pool (pool, page_cnt);
 
   if (page_idx != BITMAP_ERROR)
     pages = pool->base + PGSIZE * page_idx;
@@ -148,6 +173,71 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Registers shrinker S, which must stay valid from now on. */
+void
+palloc_register_shrinker (struct shrinker *s)
+{
+  lock_acquire (&shrink_lock);
+  list_push_back (&shrinkers, &s->elem);
+  lock_release (&shrink_lock);
+}
+
+/* Prints page allocator statistics. */
+void
+palloc_print_stats (void)
+{
+  printf ("Palloc: pools ran out %lld times, shrinkers freed %lld objects\n",
+          shrink_cnt, shrink_freed_cnt);
+}
+
+/* Marks PAGE_CNT contiguous free pages in POOL as used and
+   returns the index of the first one, or BITMAP_ERROR if there
+   is no such run. */
+static size_t
+scan_pool (struct pool *pool, size_t page_cnt)
+{
+  size_t page_idx;
+
+  lock_acquire (&pool->lock);
+  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+  lock_release (&pool->lock);
+
+  return page_idx;
+}
+
+/* Asks every shrinker for the pool that FLAGS select to free a
+   batch of objects.  Returns true if any of them freed
+   something, so that retrying the allocation may succeed. */
+static bool
+shrink (enum palloc_flags flags)
+{
+  struct list_elem *e;
+  size_t freed = 0;
+
+  /* A shrinker that allocates while freeing gets no help. */
+  if (lock_held_by_current_thread (&shrink_lock))
+    return false;
+
+  lock_acquire (&shrink_lock);
+  shrink_cnt++;
+  for (e = list_begin (&shrinkers); e != list_end (&shrinkers);
+       e = list_next (e))
+    {
+      struct shrinker *s = list_entry (e, struct shrinker, elem);
+      size_t nr;
+
+      if ((s->flags & PAL_USER) != (flags & PAL_USER))
+        continue;
+      nr = s->count ();
+      if (nr > 0)
+        freed += s->scan (nr < SHRINK_BATCH ? nr : SHRINK_BATCH);
+    }
+  shrink_freed_cnt += freed;
+  lock_release (&shrink_lock);
+
+  return freed > 0;
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
@@ -1,6 +1,7 @@
 #ifndef THREADS_PALLOC_H
 #define THREADS_PALLOC_H
 
+#include <list.h>
 #include <stddef.h>
 
 /* How to allocate pages. */
@@ -11,10 +12,29 @@ enum palloc_flags
     PAL_USER = 004              /* User page. */
   };
 
+/* A cache that gives memory back when a pool runs out.
+
+   COUNT returns the number of objects the cache could free right
+   now.  SCAN frees up to NR of them, least recently used first,
+   and returns the number it freed.  Both may be called from
+   inside any allocation, including one made by a thread that
+   holds the cache's own locks, so they must not wait for those
+   locks: use lock_try_acquire() and report nothing freed if it
+   fails. */
+struct shrinker
+  {
+    struct list_elem elem;      /* Element in palloc's list. */
+    enum palloc_flags flags;    /* PAL_USER if it frees user pages. */
+    size_t (*count) (void);     /* Returns # of freeable objects. */
+    size_t (*scan) (size_t nr); /* Frees up to NR, returns # freed. */
+  };
+
 void palloc_init (size_t user_page_limit);
 void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
+void palloc_register_shrinker (struct shrinker *);
+void palloc_print_stats (void);
 
 #endif /* threads/palloc.h */
@@ -1,6 +1,7 @@
 #ifndef THREADS_PTE_H
 #define THREADS_PTE_H
 
+#include <stddef.h>
 #include "threads/vaddr.h"
 
 /* Functions and macros for working with x86 hardware page
@@ -66,6 +67,14 @@ static inline uintptr_t pd_no (const void *va) {
 #define PTE_U 0x4               /* 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20              /* 1=accessed, 0=not acccessed. */
 #define PTE_D 0x40              /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_PS 0x80             /* 1=4 MB page, 0=page table (PDEs only). */
+#define PTE_G 0x100             /* 1=global, survives CR3 loads (PTEs only). */
+
+/* Software-defined flags, kept in the PTE_AVL bits that the CPU
+   ignores. */
+#define PTE_COW 0x200           /* 1=copy on write (read-only until then). */
+#define PTE_SWAP 0x400          /* 1=in swap slot (PTEs with PTE_P clear). */
+#define PTE_KERN 0x800          /* 1=kernel page shared with user space. */
 
 /* Returns a PDE that points to page table PT. */
 static inline uint32_t pde_create (uint32_t *pt) {
@@ -80,6 +89,15 @@ static inline uint32_t *pde_get_pt (uint32_t pde) {
   return ptov (pde & PTE_ADDR);
 }
 
+/* Returns a PDE that maps the 4 MB of memory starting at PAGE
+   directly, without a page table.  The memory is readable and
+   writable, but only by ring 0 code (the kernel).  The CPU must
+   have page size extensions enabled (CR4.PSE). */
+static inline uint32_t pde_create_large (void *page) {
+  ASSERT (((uintptr_t) page & (PTSPAN - 1)) == 0);
+  return vtop (page) | PTE_P | PTE_W | PTE_PS;
+}
+
 /* Returns a PTE that points to PAGE.
    The PTE's page is readable.
    If WRITABLE is true then it will be writable as well.
@@ -103,5 +121,20 @@ static inline void *pte_get_page (uint32_t pte) {
   return ptov (pte & PTE_ADDR);
 }
 
+/* Returns a not-present PTE recording that its page was swapped
+   out to swap slot SLOT.  The slot number goes in the address
+   bits, which the CPU ignores when PTE_P is clear. */
+static inline uint32_t pte_create_swap (size_t slot) {
+  ASSERT (slot < (1u << (32 - PTSHIFT)));
+  return (slot << PTSHIFT) | PTE_SWAP;
+}
+
+/* Returns the swap slot that swapped-out page table entry PTE
+   refers to. */
+static inline size_t pte_get_swap (uint32_t pte) {
+  ASSERT ((pte & (PTE_P | PTE_SWAP)) == PTE_SWAP);
+  return pte >> PTSHIFT;
+}
+
 #endif /* threads/pte.h */
 
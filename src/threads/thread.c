@@ -11,6 +11,7 @@
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #endif
@@ -57,6 +58,12 @@ static long long user_ticks;    /* # of timer ticks in user programs. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
 static unsigned thread_ticks;   /* # of timer ticks since last yield. */
 
+/* System load average: an exponentially weighted moving average
+   of the number of threads running or ready to run, updated once
+   a second, in 17.14 fixed-point. */
+#define LOAD_ONE (1 << 14)      /* 1.0 in load_avg's format. */
+static int load_avg;
+
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
@@ -151,6 +158,13 @@ thread_tick (int64_t cur_tick)
 
   wakeup_threads_by_tick(cur_tick);
 
+  /* load_avg = (59/60) * load_avg + (1/60) * ready_threads. */
+  if (cur_tick % TIMER_FREQ == 0)
+    {
+      int ready = list_size (&ready_list) + (t != idle_thread);
+      load_avg = (59 * load_avg + ready * LOAD_ONE) / 60;
+    }
+
   /* Enforce preemption. */
   if (++thread_ticks >= TIME_SLICE)
     intr_yield_on_return ();
@@ -486,12 +500,19 @@ thread_get_nice (void)
   return 0;
 }
 
-/* Returns 100 times the system load average. */
+/* Returns 100 times the system load average, rounded to the
+   nearest integer. */
 int
 thread_get_load_avg (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  return (load_avg * 100 + LOAD_ONE / 2) / LOAD_ONE;
+}
+
+/* Returns the number of threads ready to run. */
+int
+thread_ready_count (void)
+{
+  return list_size (&ready_list);
 }
 
 /* puts thread to sleep until tick being reached */
@@ -613,6 +634,9 @@ init_thread (struct thread *t, const char *name, int priority)
   list_elem_init (&t->elem);
   list_elem_init (&t->allelem);
   list_elem_init (&t->sleepelem);
+#ifdef USERPROG
+  list_init (&t->children);
+#endif
  
   old_level = intr_disable ();
   list_push_back (&all_list, &t->allelem);
@@ -3,6 +3,7 @@
 
 #include <debug.h>
 #include <list.h>
+#include <rusage.h>
 #include <stdint.h>
 
 /* States in a thread's life cycle. */
@@ -108,11 +109,21 @@ struct thread
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
-    struct process *proc;               /* process control block */
-    struct list child_list;             /* list of child threads of this thread */ 
-    struct list_elem childelem;         /* element of thread.child_list */
-    struct list fd_list;                /* files the thread holds */
+    struct process *proc;               /* record in the process table */
+    struct list children;               /* struct process of child processes */
+    struct fd_table *fd_table;          /* files the thread holds, see userprog/fdtable.c */
     struct file *exec_file;             /* file bein executed by the process */
+    void *syscall_esp;                  /* user esp at the latest syscall entry */
+    void *syscall_buf;                  /* bounce page for read () and write () */
+    struct rusage rusage;               /* memory and faults, see process_add_resident () */
+    struct aio_context *aio;            /* asynchronous I/O rings, see userprog/aio.c */
+    void *vdso_page;                    /* own page of the vDSO, see userprog/vdso.c */
+    struct shm_mapping *shm;            /* attached shared memory, see userprog/shm.c */
+    struct thread_group *group;         /* threads of the process, see process_thread_create () */
+#ifdef VM
+    bool frames_pinned;                 /* frames not evictable, see frame_pin () */
+    struct vm_space *vm;                /* regions etc., see vm/page.c */
+#endif
 #endif
 
     /* Owned by thread.c. */
@@ -159,6 +170,7 @@ int thread_get_nice (void);
 void thread_set_nice (int);
 int thread_get_recent_cpu (void);
 int thread_get_load_avg (void);
+int thread_ready_count (void);
 
 void thread_sleep_until (int64_t tick);
 
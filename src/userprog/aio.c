@@ -0,0 +1,454 @@
+#include "userprog/aio.h"
+#include <debug.h>
+#include <list.h>
+#include "filesys/directory.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "userprog/fdtable.h"
+#include "userprog/syscall.h"
+#include "userprog/uaccess.h"
+
+/* Asynchronous I/O.
+
+   Instead of making one blocking system call per operation, a
+   process can queue operations on a submission ring in its own
+   memory (see <aio.h>) and call aio_enter(), which hands them to
+   a pool of kernel worker threads and returns.  The workers carry
+   them out while the process runs on, and the next aio_enter()
+   posts their results to the completion ring, waiting for them
+   if asked to.  With several workers, several requests can be
+   waiting on the disks at once.
+
+   The workers have no access to the process's memory, so
+   everything that touches it happens inside aio_enter(), in the
+   process's own context: the data for a write and the name of a
+   file to open are copied into a kernel page on submission, and
+   the data from a read is copied out when its completion is
+   posted.  File descriptors are likewise looked up, installed and
+   removed only there.  A worker sees just the struct file, with
+   a reference of its own, so closing the descriptor while a
+   request is in flight is safe. */
+
+/* Number of worker threads. */
+#define AIO_WORKERS 4
+
+/* A process's rings. */
+struct aio_context
+  {
+    struct aio_ring *ring;      /* User address of ring header. */
+    struct aio_sqe *sqes;       /* User address of submission ring. */
+    struct aio_cqe *cqes;       /* User address of completion ring. */
+    unsigned entries;           /* Slots in each ring. */
+    unsigned sq_head;           /* Kernel's copy of RING->sq_head. */
+    unsigned cq_tail;           /* Kernel's copy of RING->cq_tail. */
+    unsigned inflight;          /* Requests taken but not yet posted. */
+
+    struct lock lock;           /* Protects the members below. */
+    struct condition done_cond; /* Signaled when a request is done. */
+    struct list done;           /* Requests done but not yet posted. */
+    unsigned running;           /* Requests queued for the workers. */
+  };
+
+/* One operation taken from a submission ring. */
+struct aio_request
+  {
+    struct list_elem elem;      /* In work queue or context's DONE. */
+    struct aio_context *ctx;    /* Owner. */
+    struct aio_sqe sqe;         /* Copy of the submission. */
+    struct file *file;          /* File operated on or opened. */
+    void *page;                 /* Data, or name of file to open. */
+    int result;                 /* Result, once done. */
+  };
+
+/* Requests waiting for a worker. */
+static struct list queue;
+static struct lock queue_lock;
+static struct condition queue_cond;
+static bool workers_started;
+
+static void start_workers (void);
+static void worker (void *aux);
+static bool prepare (struct aio_request *);
+static void execute (struct aio_request *);
+static void finish (struct aio_request *);
+static void submit (struct aio_context *);
+static unsigned post_completions (struct aio_context *, bool *full);
+static void discard (struct aio_request *);
+static void fault (void) NO_RETURN;
+
+/* Initializes the asynchronous I/O module.  The workers are only
+   started once some process sets up a ring. */
+void
+aio_init (void)
+{
+  list_init (&queue);
+  lock_init (&queue_lock);
+  cond_init (&queue_cond);
+}
+
+/* Sets up asynchronous I/O for the current process on the rings
+   described by the header at user address URING.  The process
+   may use only one pair of rings.  Returns true if successful,
+   false if the header is unsuitable or memory is exhausted. */
+bool
+aio_setup (struct aio_ring *uring)
+{
+  struct thread *cur = thread_current ();
+  struct aio_context *ctx;
+  struct aio_ring ring;
+
+  if (copy_from_user (&ring, uring, sizeof ring) != 0)
+    fault ();
+  if (cur->aio != NULL || ring.entries == 0
+      || ring.entries > AIO_MAX_ENTRIES
+      || (ring.entries & (ring.entries - 1)) != 0)
+    return false;
+
+  ctx = malloc (sizeof *ctx);
+  if (ctx == NULL)
+    return false;
+  ctx->ring = uring;
+  ctx->sqes = ring.sqes;
+  ctx->cqes = ring.cqes;
+  ctx->entries = ring.entries;
+  ctx->sq_head = ring.sq_head;
+  ctx->cq_tail = ring.cq_tail;
+  ctx->inflight = 0;
+  lock_init (&ctx->lock);
+  cond_init (&ctx->done_cond);
+  list_init (&ctx->done);
+  ctx->running = 0;
+
+  start_workers ();
+  cur->aio = ctx;
+  return true;
+}
+
+/* Takes new submissions from the current process's submission
+   ring and starts them, then posts completions to its completion
+   ring.  If MIN_COMPLETE is nonzero, waits until that many have
+   been posted, as long as requests remain in flight and the
+   completion ring has room.  Returns the number of completions
+   posted, or -1 if the process has no rings. */
+int
+aio_enter (unsigned min_complete)
+{
+  struct aio_context *ctx = thread_current ()->aio;
+  unsigned posted = 0;
+
+  if (ctx == NULL)
+    return -1;
+
+  submit (ctx);
+  for (;;)
+    {
+      bool full = false;
+      bool idle;
+
+      posted += post_completions (ctx, &full);
+      if (posted >= min_complete || full)
+        break;
+
+      lock_acquire (&ctx->lock);
+      while (list_empty (&ctx->done) && ctx->running > 0)
+        cond_wait (&ctx->done_cond, &ctx->lock);
+      idle = list_empty (&ctx->done);
+      lock_release (&ctx->lock);
+      if (idle)
+        break;
+    }
+  return posted;
+}
+
+/* Tears down the current process's rings, if any, after waiting
+   for requests in flight to finish.  Results not yet posted are
+   dropped. */
+void
+aio_destroy (void)
+{
+  struct thread *cur = thread_current ();
+  struct aio_context *ctx = cur->aio;
+
+  if (ctx == NULL)
+    return;
+
+  lock_acquire (&ctx->lock);
+  while (ctx->running > 0)
+    cond_wait (&ctx->done_cond, &ctx->lock);
+  lock_release (&ctx->lock);
+
+  while (!list_empty (&ctx->done))
+    discard (list_entry (list_pop_front (&ctx->done),
+                         struct aio_request, elem));
+  cur->aio = NULL;
+  free (ctx);
+}
+
+/* Starts the worker threads, if they are not running yet. */
+static void
+start_workers (void)
+{
+  int i;
+
+  lock_acquire (&queue_lock);
+  if (!workers_started)
+    {
+      for (i = 0; i < AIO_WORKERS; i++)
+        thread_create ("aio", PRI_DEFAULT, worker, NULL);
+      workers_started = true;
+    }
+  lock_release (&queue_lock);
+}
+
+/* Worker thread: carries out queued requests one at a time. */
+static void
+worker (void *aux UNUSED)
+{
+  for (;;)
+    {
+      struct aio_request *req;
+
+      lock_acquire (&queue_lock);
+      while (list_empty (&queue))
+        cond_wait (&queue_cond, &queue_lock);
+      req = list_entry (list_pop_front (&queue), struct aio_request, elem);
+      lock_release (&queue_lock);
+
+      execute (req);
+      finish (req);
+    }
+}
+
+/* Takes new submissions from CTX's submission ring, as many as
+   there is room for in the completion ring, and starts them. */
+static void
+submit (struct aio_context *ctx)
+{
+  unsigned sq_tail;
+
+  if (copy_from_user (&sq_tail, &ctx->ring->sq_tail, sizeof sq_tail) != 0)
+    fault ();
+  while (ctx->sq_head != sq_tail && ctx->inflight < ctx->entries)
+    {
+      struct aio_sqe *usqe = &ctx->sqes[ctx->sq_head & (ctx->entries - 1)];
+      struct aio_request *req = malloc (sizeof *req);
+
+      if (req == NULL)
+        break;
+      req->ctx = ctx;
+      req->file = NULL;
+      req->page = NULL;
+      req->result = -1;
+      if (copy_from_user (&req->sqe, usqe, sizeof req->sqe) != 0)
+        {
+          free (req);
+          fault ();
+        }
+      ctx->sq_head++;
+      ctx->inflight++;
+
+      if (prepare (req))
+        {
+          lock_acquire (&ctx->lock);
+          ctx->running++;
+          lock_release (&ctx->lock);
+
+          lock_acquire (&queue_lock);
+          list_push_back (&queue, &req->elem);
+          cond_signal (&queue_cond, &queue_lock);
+          lock_release (&queue_lock);
+        }
+      else
+        {
+          /* Complete it right away with result -1. */
+          lock_acquire (&ctx->lock);
+          list_push_back (&ctx->done, &req->elem);
+          lock_release (&ctx->lock);
+        }
+    }
+  if (copy_to_user (&ctx->ring->sq_head, &ctx->sq_head,
+                    sizeof ctx->sq_head) != 0)
+    fault ();
+}
+
+/* Does the part of REQ that needs the submitting process's
+   memory or file descriptors.  Returns true if REQ should go on
+   to a worker, false if it fails. */
+static bool
+prepare (struct aio_request *req)
+{
+  struct fd_table *fds = thread_current ()->fd_table;
+  struct aio_sqe *sqe = &req->sqe;
+  int len;
+
+  switch (sqe->op)
+    {
+    case AIO_READ:
+    case AIO_WRITE:
+      /* fd_get() gives us the reference the request keeps. */
+      req->file = fd_get (fds, sqe->fd);
+      if (req->file == NULL || file_is_pipe (req->file)
+          || sqe->len > AIO_MAX_LEN || (off_t) sqe->offset < 0)
+        return false;
+      req->page = palloc_get_page (0);
+      if (req->page == NULL)
+        return false;
+      if (sqe->op == AIO_WRITE
+          && copy_from_user (req->page, sqe->buf, sqe->len) != 0)
+        {
+          discard (req);
+          fault ();
+        }
+      return true;
+
+    case AIO_OPEN:
+      req->page = palloc_get_page (0);
+      if (req->page == NULL)
+        return false;
+      len = strncpy_from_user (req->page, sqe->buf, NAME_MAX + 1);
+      if (len < 0)
+        {
+          discard (req);
+          fault ();
+        }
+      return len <= NAME_MAX;
+
+    case AIO_CLOSE:
+      req->file = fd_remove (fds, sqe->fd);
+      return req->file != NULL;
+
+    default:
+      return false;
+    }
+}
+
+/* Carries out REQ in a worker thread. */
+static void
+execute (struct aio_request *req)
+{
+  struct aio_sqe *sqe = &req->sqe;
+
+  switch (sqe->op)
+    {
+    case AIO_READ:
+      req->result = file_read_at (req->file, req->page, sqe->len,
+                                  sqe->offset);
+      break;
+
+    case AIO_WRITE:
+      req->result = file_write_at (req->file, req->page, sqe->len,
+                                   sqe->offset);
+      break;
+
+    case AIO_OPEN:
+      req->file = filesys_open (req->page);
+      req->result = req->file != NULL ? 0 : -1;
+      return;
+
+    case AIO_CLOSE:
+      req->result = 0;
+      break;
+
+    default:
+      NOT_REACHED ();
+    }
+
+  /* Dropping what may be the last reference can free the file's
+     blocks, so do it here rather than in the process. */
+  file_close (req->file);
+  req->file = NULL;
+}
+
+/* Hands REQ, carried out by a worker, back to its process. */
+static void
+finish (struct aio_request *req)
+{
+  struct aio_context *ctx = req->ctx;
+
+  lock_acquire (&ctx->lock);
+  list_push_back (&ctx->done, &req->elem);
+  ctx->running--;
+  cond_signal (&ctx->done_cond, &ctx->lock);
+  lock_release (&ctx->lock);
+}
+
+/* Posts completions for CTX's finished requests in the order
+   they finished, copying out the data of reads and installing
+   the files opened.  Stops early, setting *FULL to true, if the
+   completion ring fills up.  Returns the number posted. */
+static unsigned
+post_completions (struct aio_context *ctx, bool *full)
+{
+  struct fd_table *fds = thread_current ()->fd_table;
+  unsigned cq_head;
+  unsigned posted = 0;
+
+  if (copy_from_user (&cq_head, &ctx->ring->cq_head, sizeof cq_head) != 0)
+    fault ();
+  for (;;)
+    {
+      struct aio_cqe *ucqe = &ctx->cqes[ctx->cq_tail & (ctx->entries - 1)];
+      struct aio_request *req;
+      struct aio_cqe cqe;
+
+      if (ctx->cq_tail - cq_head >= ctx->entries)
+        {
+          *full = true;
+          break;
+        }
+      lock_acquire (&ctx->lock);
+      req = (list_empty (&ctx->done) ? NULL
+             : list_entry (list_pop_front (&ctx->done),
+                           struct aio_request, elem));
+      lock_release (&ctx->lock);
+      if (req == NULL)
+        break;
+
+      if (req->sqe.op == AIO_READ && req->result > 0
+          && copy_to_user (req->sqe.buf, req->page, req->result) != 0)
+        {
+          discard (req);
+          fault ();
+        }
+      if (req->sqe.op == AIO_OPEN && req->file != NULL)
+        {
+          req->result = fd_install (fds, req->file);
+          if (req->result >= 0)
+            req->file = NULL;
+        }
+      cqe.user_data = req->sqe.user_data;
+      cqe.result = req->result;
+      discard (req);
+      ctx->inflight--;
+
+      if (copy_to_user (ucqe, &cqe, sizeof cqe) != 0)
+        fault ();
+      ctx->cq_tail++;
+      posted++;
+    }
+  if (copy_to_user (&ctx->ring->cq_tail, &ctx->cq_tail,
+                    sizeof ctx->cq_tail) != 0)
+    fault ();
+  return posted;
+}
+
+/* Frees REQ and whatever it still holds. */
+static void
+discard (struct aio_request *req)
+{
+  file_close (req->file);
+  palloc_free_page (req->page);
+  free (req);
+}
+
+/* Kills the current process for passing a bad pointer. */
+static void
+fault (void)
+{
+  sys_exit (-1);
+  NOT_REACHED ();
+}
@@ -0,0 +1,12 @@
+#ifndef USERPROG_AIO_H
+#define USERPROG_AIO_H
+
+#include <aio.h>
+#include <stdbool.h>
+
+void aio_init (void);
+bool aio_setup (struct aio_ring *);
+int aio_enter (unsigned min_complete);
+void aio_destroy (void);
+
+#endif /* userprog/aio.h */
@@ -0,0 +1,335 @@
+#include "userprog/exec-cache.h"
+#include <debug.h>
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Executable image cache.
+
+   Running the same program over and over, as shell scripts do,
+   would otherwise read and check its ELF headers and read its
+   code from disk every time.  Instead, load() records what it
+   learned from the headers of each executable it loads here, and
+   the cache also keeps a copy of the executable's read-only
+   pages, so that later loads of the same program skip parsing
+   and take the pages from memory.
+
+   Images are keyed by inode, which the cache holds open.  Each
+   image remembers the inode's version when it was cached; any
+   write to the file changes the version, and an image whose
+   version no longer matches, or whose file has been removed, is
+   dropped the next time the cache is searched.  Loading denies
+   writes to the file before looking it up, so that the version
+   stays put while an image is being used or filled.
+
+   At most EXEC_CACHE_SIZE images are kept, least recently used
+   first out.  The page copies come from the kernel pool, and a
+   shrinker gives them back when the pool runs out, leaving the
+   parsed headers, which are small, in place. */
+
+/* Maximum number of cached images. */
+#define EXEC_CACHE_SIZE 8
+
+/* Maximum number of pages cached per image. */
+#define EXEC_CACHE_PAGES 16
+
+/* A cached page of an executable. */
+struct cached_page
+  {
+    off_t ofs;                  /* Offset of the page in the file. */
+    size_t read_bytes;          /* Bytes of file data in KPAGE. */
+    void *kpage;                /* Copy of the data. */
+  };
+
+/* A cached executable. */
+struct image
+  {
+    struct list_elem elem;      /* Element in `images'. */
+    struct inode *inode;        /* Executable's inode, held open. */
+    unsigned long version;      /* inode_version() when cached. */
+    struct exec_info info;      /* Parsed ELF headers. */
+    size_t page_cnt;            /* Number of cached pages. */
+    struct cached_page pages[EXEC_CACHE_PAGES];
+  };
+
+/* Cached images, most recently used first. */
+static struct list images;
+
+/* Protects `images' and everything in them. */
+static struct lock cache_lock;
+
+/* Total number of cached pages. */
+static size_t cached_page_cnt;
+
+/* Statistics. */
+static long long hit_cnt;               /* # of loads that hit. */
+static long long miss_cnt;              /* # of loads that missed. */
+static long long stale_cnt;             /* # of images invalidated. */
+static long long page_hit_cnt;          /* # of pages read from cache. */
+
+static struct image *find_image (const struct inode *);
+static void drop_stale (struct list *stale);
+static void free_image (struct image *);
+static size_t cache_count (void);
+static size_t cache_scan (size_t nr);
+
+/* Gives cached pages back under pressure. */
+static struct shrinker cache_shrinker =
+  {
+    .flags = 0,
+    .count = cache_count,
+    .scan = cache_scan,
+  };
+
+/* Initializes the executable image cache. */
+void
+exec_cache_init (void)
+{
+  list_init (&images);
+  lock_init (&cache_lock);
+  palloc_register_shrinker (&cache_shrinker);
+}
+
+/* Looks up executable FILE in the cache.  If it is there,
+   stores its parsed headers in *INFO and returns true.
+   Otherwise, returns false, and the caller should parse the
+   headers itself and pass them to exec_cache_insert().  The
+   caller must have denied writes to FILE. */
+bool
+exec_cache_lookup (struct file *file, struct exec_info *info)
+{
+  struct list stale;
+  struct image *image;
+
+  list_init (&stale);
+  lock_acquire (&cache_lock);
+  drop_stale (&stale);
+  image = find_image (file_get_inode (file));
+  if (image != NULL)
+    {
+      list_remove (&image->elem);
+      list_push_front (&images, &image->elem);
+      *info = image->info;
+      hit_cnt++;
+    }
+  else
+    miss_cnt++;
+  lock_release (&cache_lock);
+
+  while (!list_empty (&stale))
+    free_image (list_entry (list_pop_front (&stale), struct image, elem));
+  return image != NULL;
+}
+
+/* Adds executable FILE, whose parsed headers are in *INFO, to
+   the cache, along with copies of as many of its read-only pages
+   as fit.  Does nothing if memory is short.  The caller must have
+   denied writes to FILE. */
+void
+exec_cache_insert (struct file *file, const struct exec_info *info)
+{
+  struct image *image, *victim = NULL;
+  int i;
+
+  image = malloc (sizeof *image);
+  if (image == NULL)
+    return;
+  image->inode = inode_reopen (file_get_inode (file));
+  image->version = inode_version (image->inode);
+  image->info = *info;
+  image->page_cnt = 0;
+
+  /* Read the pages without the cache locked, since no one else
+     can see this image yet. */
+  for (i = 0; i < info->segment_cnt; i++)
+    {
+      const struct exec_segment *seg = &info->segments[i];
+      uint32_t read_bytes = seg->read_bytes;
+      off_t ofs = seg->ofs;
+
+      if (seg->writable)
+        continue;
+      while (read_bytes > 0 && image->page_cnt < EXEC_CACHE_PAGES)
+        {
+          struct cached_page *p = &image->pages[image->page_cnt];
+
+          p->ofs = ofs;
+          p->read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
+          p->kpage = palloc_get_page (0);
+          if (p->kpage == NULL)
+            break;
+          if (file_read_at (file, p->kpage, p->read_bytes, ofs)
+              != (off_t) p->read_bytes)
+            {
+              palloc_free_page (p->kpage);
+              break;
+            }
+          image->page_cnt++;
+          read_bytes -= p->read_bytes;
+          ofs += PGSIZE;
+        }
+    }
+
+  lock_acquire (&cache_lock);
+  if (find_image (image->inode) != NULL)
+    {
+      /* Someone else loading the same program beat us to it. */
+      victim = image;
+    }
+  else
+    {
+      list_push_front (&images, &image->elem);
+      cached_page_cnt += image->page_cnt;
+      if (list_size (&images) > EXEC_CACHE_SIZE)
+        {
+          victim = list_entry (list_pop_back (&images), struct image, elem);
+          cached_page_cnt -= victim->page_cnt;
+        }
+    }
+  lock_release (&cache_lock);
+
+  if (victim != NULL)
+    free_image (victim);
+}
+
+/* Copies READ_BYTES bytes of INODE starting at offset OFS, which
+   must be the start of a page of a read-only segment, into
+   KPAGE, if the cache has them.  Returns true if successful,
+   false if the caller must read the data from the file. */
+bool
+exec_cache_read (struct inode *inode, off_t ofs, void *kpage,
+                 size_t read_bytes)
+{
+  struct image *image;
+  bool success = false;
+
+  lock_acquire (&cache_lock);
+  image = find_image (inode);
+  if (image != NULL && image->version == inode_version (inode))
+    {
+      size_t i;
+
+      for (i = 0; i < image->page_cnt; i++)
+        {
+          struct cached_page *p = &image->pages[i];
+          if (p->ofs == ofs && p->read_bytes == read_bytes)
+            {
+              memcpy (kpage, p->kpage, read_bytes);
+              page_hit_cnt++;
+              success = true;
+              break;
+            }
+        }
+    }
+  lock_release (&cache_lock);
+
+  return success;
+}
+
+/* Prints executable image cache statistics. */
+void
+exec_cache_print_stats (void)
+{
+  printf ("Exec cache: %lld hits, %lld misses, %lld invalidated, "
+          "%lld pages read from cache\n",
+          hit_cnt, miss_cnt, stale_cnt, page_hit_cnt);
+}
+
+/* Returns the cached image of INODE, or a null pointer if there
+   is none.  The cache must be locked. */
+static struct image *
+find_image (const struct inode *inode)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&images); e != list_end (&images);
+       e = list_next (e))
+    {
+      struct image *image = list_entry (e, struct image, elem);
+      if (image->inode == inode)
+        return image;
+    }
+  return NULL;
+}
+
+/* Moves every image whose file has been written or removed since
+   it was cached from the cache to STALE, for the caller to free
+   once it has unlocked the cache.  The cache must be locked. */
+static void
+drop_stale (struct list *stale)
+{
+  struct list_elem *e, *next;
+
+  for (e = list_begin (&images); e != list_end (&images); e = next)
+    {
+      struct image *image = list_entry (e, struct image, elem);
+
+      next = list_next (e);
+      if (image->version != inode_version (image->inode)
+          || inode_is_removed (image->inode))
+        {
+          list_remove (e);
+          list_push_back (stale, e);
+          cached_page_cnt -= image->page_cnt;
+          stale_cnt++;
+        }
+    }
+}
+
+/* Frees IMAGE, which must no longer be in the cache.  Closing
+   its inode may free a removed file's blocks, so the cache must
+   not be locked. */
+static void
+free_image (struct image *image)
+{
+  size_t i;
+
+  for (i = 0; i < image->page_cnt; i++)
+    palloc_free_page (image->pages[i].kpage);
+  inode_close (image->inode);
+  free (image);
+}
+
+/* Returns the number of cached pages. */
+static size_t
+cache_count (void)
+{
+  return cached_page_cnt;
+}
+
+/* Frees up to NR cached pages, taking them from the least
+   recently used images first, and returns the number freed.
+   The images themselves stay.  Gives up if the cache is locked,
+   since the allocation that called us may be made with it
+   held. */
+static size_t
+cache_scan (size_t nr)
+{
+  struct list_elem *e;
+  size_t cnt = 0;
+
+  if (lock_held_by_current_thread (&cache_lock)
+      || !lock_try_acquire (&cache_lock))
+    return 0;
+  for (e = list_rbegin (&images); e != list_rend (&images) && cnt < nr;
+       e = list_prev (e))
+    {
+      struct image *image = list_entry (e, struct image, elem);
+
+      while (image->page_cnt > 0 && cnt < nr)
+        {
+          palloc_free_page (image->pages[--image->page_cnt].kpage);
+          cached_page_cnt--;
+          cnt++;
+        }
+    }
+  lock_release (&cache_lock);
+
+  return cnt;
+}
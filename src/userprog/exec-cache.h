@@ -0,0 +1,42 @@
+#ifndef USERPROG_EXEC_CACHE_H
+#define USERPROG_EXEC_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "filesys/off_t.h"
+
+struct file;
+struct inode;
+
+/* Maximum number of loadable segments in an executable.  User
+   programs have two or three: code, data, and perhaps BSS. */
+#define EXEC_MAX_SEGMENTS 8
+
+/* A loadable segment of an executable, as load_segment() takes
+   it. */
+struct exec_segment
+  {
+    off_t ofs;                  /* File offset of first page. */
+    uint8_t *upage;             /* User virtual address of first page. */
+    uint32_t read_bytes;        /* Bytes to read from the file. */
+    uint32_t zero_bytes;        /* Bytes to zero following them. */
+    bool writable;              /* Mapped writable? */
+  };
+
+/* What load() learns from an executable's ELF headers. */
+struct exec_info
+  {
+    void (*entry) (void);       /* Entry point. */
+    int segment_cnt;            /* Number of segments. */
+    struct exec_segment segments[EXEC_MAX_SEGMENTS];
+  };
+
+void exec_cache_init (void);
+bool exec_cache_lookup (struct file *, struct exec_info *);
+void exec_cache_insert (struct file *, const struct exec_info *);
+bool exec_cache_read (struct inode *, off_t ofs, void *kpage,
+                      size_t read_bytes);
+void exec_cache_print_stats (void);
+
+#endif /* userprog/exec-cache.h */
@@ -0,0 +1,267 @@
+#include "userprog/fdtable.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+
+/* File descriptor table.
+
+   A process's open files are kept in an array indexed by file
+   descriptor, so that finding the file behind a descriptor takes
+   constant time however many files are open.  A bitmap records
+   which descriptors are in use.  A new file gets the lowest free
+   descriptor, as POSIX requires, found by scanning the bitmap
+   from a hint below which every descriptor is known to be taken.
+   The hint usually points right at a free descriptor, so opening
+   a file does not get slower as more are open either.  The array
+   and bitmap start small and double when full, up to FD_MAX
+   descriptors.
+
+   Descriptors below FD_FIRST, the standard input, output and
+   error, are never handed out that way.  They refer to the
+   console unless a file, usually a pipe, is put there with
+   fd_replace(), and they are the only descriptors a process
+   started by exec() inherits (see fd_table_inherit()).
+
+   All the threads of a process share its table, so each table
+   has a lock, and fd_get() hands out a reference of its own to
+   the file, so that another thread closing the descriptor
+   meanwhile does not free the file from under the caller. */
+
+/* Initial and maximum number of descriptors. */
+#define FD_INIT_CNT 32
+#define FD_MAX 8192
+
+struct fd_table
+  {
+    struct file **files;        /* Open file for each fd, or null. */
+    struct bitmap *used;        /* Bit set for each fd in use. */
+    size_t size;                /* Number of elements in both. */
+    size_t next;                /* No descriptor below this is free. */
+    struct lock lock;           /* Protects the members above. */
+  };
+
+static struct fd_table *create_table (size_t size);
+static bool grow_table (struct fd_table *);
+
+/* Returns a new table with no files open, or a null pointer if
+   memory is exhausted. */
+struct fd_table *
+fd_table_create (void)
+{
+  return create_table (FD_INIT_CNT);
+}
+
+/* Returns a copy of table T in which each descriptor refers to
+   the same open file as in T, for fork().  Returns a null
+   pointer if memory is exhausted. */
+struct fd_table *
+fd_table_dup (struct fd_table *t)
+{
+  struct fd_table *copy;
+  size_t fd;
+
+  lock_acquire (&t->lock);
+  copy = create_table (t->size);
+  if (copy == NULL)
+    {
+      lock_release (&t->lock);
+      return NULL;
+    }
+  for (fd = 0; fd < t->size; fd++)
+    if (t->files[fd] != NULL)
+      {
+        copy->files[fd] = file_dup (t->files[fd]);
+        bitmap_mark (copy->used, fd);
+      }
+  copy->next = t->next;
+  lock_release (&t->lock);
+  return copy;
+}
+
+/* Makes the standard descriptors of table T, which must have
+   none open yet, refer to the same open files as in PARENT, for
+   a process started by exec(). */
+void
+fd_table_inherit (struct fd_table *t, struct fd_table *parent)
+{
+  int fd;
+
+  lock_acquire (&parent->lock);
+  for (fd = 0; fd < FD_FIRST; fd++)
+    {
+      ASSERT (t->files[fd] == NULL);
+      if (parent->files[fd] != NULL)
+        {
+          t->files[fd] = file_dup (parent->files[fd]);
+          bitmap_mark (t->used, fd);
+        }
+    }
+  lock_release (&parent->lock);
+}
+
+/* Closes every file open in table T and frees T. */
+void
+fd_table_destroy (struct fd_table *t)
+{
+  size_t fd;
+
+  if (t == NULL)
+    return;
+  for (fd = 0; fd < t->size; fd++)
+    if (t->files[fd] != NULL)
+      file_close (t->files[fd]);
+  bitmap_destroy (t->used);
+  free (t->files);
+  free (t);
+}
+
+/* Gives FILE the lowest free descriptor in table T and returns
+   it.  Returns -1 if T is full or memory is exhausted. */
+int
+fd_install (struct fd_table *t, struct file *file)
+{
+  size_t fd;
+
+  ASSERT (file != NULL);
+
+  lock_acquire (&t->lock);
+  fd = bitmap_scan (t->used, t->next, 1, false);
+  if (fd == BITMAP_ERROR)
+    {
+      fd = t->size;
+      if (!grow_table (t))
+        {
+          lock_release (&t->lock);
+          return -1;
+        }
+    }
+  bitmap_mark (t->used, fd);
+  t->files[fd] = file;
+  t->next = fd + 1;
+  lock_release (&t->lock);
+  return fd;
+}
+
+/* Makes descriptor FD in table T refer to FILE, growing T if
+   necessary, and stores the file FD referred to before, which
+   the caller must close, in *OLD, or a null pointer if there was
+   none.  Returns false, leaving T alone, if T cannot grow to
+   hold FD. */
+bool
+fd_replace (struct fd_table *t, int fd, struct file *file,
+            struct file **old)
+{
+  ASSERT (file != NULL);
+  ASSERT (fd >= 0);
+
+  lock_acquire (&t->lock);
+  while ((size_t) fd >= t->size)
+    if (!grow_table (t))
+      {
+        lock_release (&t->lock);
+        return false;
+      }
+  *old = t->files[fd];
+  t->files[fd] = file;
+  bitmap_mark (t->used, fd);
+  lock_release (&t->lock);
+  return true;
+}
+
+/* Returns the file open as descriptor FD in table T, with a
+   reference of its own that the caller must drop with
+   file_close(), or a null pointer if there is none.  A standard
+   descriptor with no file refers to the console. */
+struct file *
+fd_get (struct fd_table *t, int fd)
+{
+  struct file *file = NULL;
+
+  lock_acquire (&t->lock);
+  if (fd >= 0 && (size_t) fd < t->size && t->files[fd] != NULL)
+    file = file_dup (t->files[fd]);
+  lock_release (&t->lock);
+  return file;
+}
+
+/* Frees descriptor FD in table T and returns the file it
+   referred to, which the caller must close, or a null pointer
+   if FD was not open. */
+struct file *
+fd_remove (struct fd_table *t, int fd)
+{
+  struct file *file = NULL;
+
+  lock_acquire (&t->lock);
+  if (fd >= 0 && (size_t) fd < t->size && t->files[fd] != NULL)
+    {
+      file = t->files[fd];
+      t->files[fd] = NULL;
+      bitmap_reset (t->used, fd);
+      if (fd >= FD_FIRST && (size_t) fd < t->next)
+        t->next = fd;
+    }
+  lock_release (&t->lock);
+  return file;
+}
+
+/* Returns a new table with room for SIZE descriptors, none of
+   them open, or a null pointer if memory is exhausted. */
+static struct fd_table *
+create_table (size_t size)
+{
+  struct fd_table *t = malloc (sizeof *t);
+
+  if (t == NULL)
+    return NULL;
+  t->files = calloc (size, sizeof *t->files);
+  t->used = bitmap_create (size);
+  if (t->files == NULL || t->used == NULL)
+    {
+      free (t->files);
+      if (t->used != NULL)
+        bitmap_destroy (t->used);
+      free (t);
+      return NULL;
+    }
+  t->size = size;
+  t->next = FD_FIRST;
+  lock_init (&t->lock);
+  return t;
+}
+
+/* Doubles the number of descriptors table T can hold.  Returns
+   false if T is already at FD_MAX or memory is exhausted. */
+static bool
+grow_table (struct fd_table *t)
+{
+  size_t size = t->size * 2;
+  struct file **files;
+  struct bitmap *used;
+  size_t fd;
+
+  if (size > FD_MAX)
+    return false;
+  used = bitmap_create (size);
+  if (used == NULL)
+    return false;
+  files = realloc (t->files, size * sizeof *files);
+  if (files == NULL)
+    {
+      bitmap_destroy (used);
+      return false;
+    }
+  memset (files + t->size, 0, (size - t->size) * sizeof *files);
+  for (fd = 0; fd < t->size; fd++)
+    if (bitmap_test (t->used, fd))
+      bitmap_mark (used, fd);
+  bitmap_destroy (t->used);
+
+  t->files = files;
+  t->used = used;
+  t->size = size;
+  return true;
+}
@@ -0,0 +1,23 @@
+#ifndef USERPROG_FDTABLE_H
+#define USERPROG_FDTABLE_H
+
+#include <stdbool.h>
+
+struct file;
+
+/* Lowest file descriptor handed out.  0, 1 and 2 are the
+   standard input, output and error, which refer to the console
+   unless redirected with fd_replace(). */
+#define FD_FIRST 3
+
+struct fd_table *fd_table_create (void);
+struct fd_table *fd_table_dup (struct fd_table *);
+void fd_table_inherit (struct fd_table *, struct fd_table *parent);
+void fd_table_destroy (struct fd_table *);
+int fd_install (struct fd_table *, struct file *);
+bool fd_replace (struct fd_table *, int fd, struct file *,
+                 struct file **old);
+struct file *fd_get (struct fd_table *, int fd);
+struct file *fd_remove (struct fd_table *, int fd);
+
+#endif /* userprog/fdtable.h */
@@ -0,0 +1,226 @@
+#include "userprog/futex.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <stdint.h>
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+#include "userprog/syscall.h"
+#include "userprog/uaccess.h"
+
+/* Fast user-space mutexes.
+
+   User-level locks and condition variables (see lib/user/pthread.c)
+   keep their state in an ordinary int in user memory and only
+   enter the kernel to sleep or to wake sleepers.  futex_wait()
+   puts the calling thread to sleep if the int still holds the
+   value the caller last saw, checking and queuing atomically with
+   respect to futex_wake(), so that a wake-up between the caller's
+   check and its sleep is not lost.
+
+   Sleepers are kept in wait queues keyed by the int's address.
+   For an int in a shared memory segment (see userprog/shm.c),
+   which never moves, the key is its kernel address, so that
+   threads of different processes can wait on the same futex.
+   Any other int is private to its process, and the key is the
+   process's page directory and the user address, which stay put
+   even if the frame table moves the page. */
+
+/* Number of wait queues. */
+#define FUTEX_BUCKETS 64
+
+/* Identifies a futex. */
+struct futex_key
+  {
+    const void *space;          /* Page directory, or null if shared. */
+    uintptr_t addr;             /* User address, or kernel if shared. */
+  };
+
+/* A thread sleeping in futex_wait(). */
+struct futex_waiter
+  {
+    struct list_elem elem;      /* Element in a wait queue. */
+    struct futex_key key;       /* Futex waited on. */
+    struct thread *leader;      /* Main thread of waiter's process. */
+    struct semaphore sema;      /* Upped to wake the waiter. */
+  };
+
+/* Wait queues, hashed by key. */
+static struct list buckets[FUTEX_BUCKETS];
+
+/* Protects the wait queues. */
+static struct lock futex_lock;
+
+static bool get_key (const int *uaddr, struct futex_key *);
+static bool peek_user (const int *uaddr, int *val);
+static struct list *bucket (const struct futex_key *);
+
+/* Initializes the futex wait queues. */
+void
+futex_init (void)
+{
+  size_t i;
+
+  for (i = 0; i < FUTEX_BUCKETS; i++)
+    list_init (&buckets[i]);
+  lock_init (&futex_lock);
+}
+
+/* If the int at user address UADDR holds VAL, sleeps until
+   another thread calls futex_wake() on it, and returns 0.
+   Returns -1 right away if it holds some other value or UADDR is
+   not suitably aligned.  Also returns, with 0, if the process
+   starts exiting meanwhile (see futex_wake_process()). */
+int
+futex_wait (int *uaddr, int val)
+{
+  struct futex_waiter w;
+  int cur;
+
+  if (!get_key (uaddr, &w.key))
+    return -1;
+
+  /* Paging the int in may sleep on the disk, so fault it in
+     before locking the wait queues, then read it again with them
+     locked, starting over if it has been evicted meanwhile. */
+  for (;;)
+    {
+      if (copy_from_user (&cur, uaddr, sizeof cur) != 0)
+        sys_exit (-1);
+      lock_acquire (&futex_lock);
+      if (peek_user (uaddr, &cur))
+        break;
+      lock_release (&futex_lock);
+    }
+  if (cur != val || process_is_dying ())
+    {
+      lock_release (&futex_lock);
+      return -1;
+    }
+  w.leader = process_leader (thread_current ());
+  sema_init (&w.sema, 0);
+  list_push_back (bucket (&w.key), &w.elem);
+  lock_release (&futex_lock);
+
+  sema_down (&w.sema);
+  return 0;
+}
+
+/* Wakes up to CNT threads sleeping on the int at user address
+   UADDR and returns the number woken. */
+int
+futex_wake (int *uaddr, int cnt)
+{
+  struct futex_key key;
+  struct list *b;
+  struct list_elem *e, *next;
+  int woken = 0;
+
+  if (!get_key (uaddr, &key))
+    return 0;
+
+  lock_acquire (&futex_lock);
+  b = bucket (&key);
+  for (e = list_begin (b); e != list_end (b) && woken < cnt; e = next)
+    {
+      struct futex_waiter *w = list_entry (e, struct futex_waiter, elem);
+
+      next = list_next (e);
+      if (w->key.space == key.space && w->key.addr == key.addr)
+        {
+          list_remove (e);
+          sema_up (&w->sema);
+          woken++;
+        }
+    }
+  lock_release (&futex_lock);
+
+  return woken;
+}
+
+/* Wakes every thread of the process whose main thread is LEADER
+   that is sleeping on any futex, because the process is
+   exiting. */
+void
+futex_wake_process (struct thread *leader)
+{
+  size_t i;
+
+  lock_acquire (&futex_lock);
+  for (i = 0; i < FUTEX_BUCKETS; i++)
+    {
+      struct list_elem *e, *next;
+
+      for (e = list_begin (&buckets[i]); e != list_end (&buckets[i]);
+           e = next)
+        {
+          struct futex_waiter *w
+            = list_entry (e, struct futex_waiter, elem);
+
+          next = list_next (e);
+          if (w->leader == leader)
+            {
+              list_remove (e);
+              sema_up (&w->sema);
+            }
+        }
+    }
+  lock_release (&futex_lock);
+}
+
+/* Stores the key for the int at user address UADDR in *KEY.
+   Returns false if UADDR is not an aligned user address. */
+static bool
+get_key (const int *uaddr, struct futex_key *key)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  void *kaddr;
+
+  if (!is_user_vaddr (uaddr) || (uintptr_t) uaddr % sizeof *uaddr != 0)
+    return false;
+
+  kaddr = pagedir_get_page (pd, uaddr);
+  if (kaddr != NULL && pagedir_is_kernel_page (pd, uaddr))
+    {
+      key->space = NULL;
+      key->addr = (uintptr_t) kaddr;
+    }
+  else
+    {
+      key->space = pd;
+      key->addr = (uintptr_t) uaddr;
+    }
+  return true;
+}
+
+/* Stores the int at user address UADDR, which must be aligned,
+   in *VAL and returns true, or returns false if its page is not
+   present.  Never faults.  Interrupts are off between looking up
+   the page and reading it, so that the frame table cannot evict
+   it in between; it unmaps a page before writing it out. */
+static bool
+peek_user (const int *uaddr, int *val)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  enum intr_level old_level;
+  const int *kaddr;
+
+  old_level = intr_disable ();
+  kaddr = pagedir_get_page (pd, uaddr);
+  if (kaddr != NULL)
+    *val = *kaddr;
+  intr_set_level (old_level);
+
+  return kaddr != NULL;
+}
+
+/* Returns the wait queue for KEY. */
+static struct list *
+bucket (const struct futex_key *key)
+{
+  return &buckets[hash_bytes (key, sizeof *key) % FUTEX_BUCKETS];
+}
@@ -1,13 +1,28 @@
 #include "userprog/pagedir.h"
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <string.h>
+#include "devices/timer.h"
 #include "threads/init.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/swap.h"
+#endif
+
+/* TLB statistics. */
+static long long cr3_load_cnt;      /* # of CR3 loads (full flushes). */
+static long long cr3_skip_cnt;      /* # of CR3 loads avoided. */
+static long long invlpg_cnt;        /* # of single-page flushes. */
 
 static uint32_t *active_pd (void);
+static void load_pagedir (uint32_t *);
+#ifdef VM
 static void invalidate_pagedir (uint32_t *);
+#endif
+static void invalidate_page (uint32_t *, const void *upage);
 
 /* Creates a new page directory that has mappings for kernel
    virtual addresses, but none for user virtual addresses.
@@ -23,7 +38,11 @@ pagedir_create (void)
 }
 
 /* Destroys page directory PD, freeing all the pages it
-   references. */
+   references.  With VM, user pages belong to the frame table and
+   may be shared with other page directories, so only this page
+   directory's reference to each is dropped, and the same goes
+   for the swap slots of swapped-out pages.  The frame table must
+   not evict PD's pages meanwhile (see frame_pin()). */
 void
 pagedir_destroy (uint32_t *pd) 
 {
@@ -40,13 +59,34 @@ pagedir_destroy (uint32_t *pd)
         uint32_t *pte;
         
         for (pte = pt; pte < pt + PGSIZE / sizeof *pte; pte++)
-          if (*pte & PTE_P) 
+          if ((*pte & (PTE_P | PTE_KERN)) == PTE_P) 
+#ifdef VM
+            frame_free (pte_get_page (*pte));
+          else if (*pte & PTE_SWAP)
+            swap_free (pte_get_swap (*pte));
+#else
             palloc_free_page (pte_get_page (*pte));
+#endif
         palloc_free_page (pt);
       }
   palloc_free_page (pd);
 }
 
+/* Returns the number of pages that page directory PD itself
+   occupies: the page directory plus its user page tables. */
+size_t
+pagedir_count_tables (uint32_t *pd)
+{
+  uint32_t *pde;
+  size_t cnt = 1;
+
+  ASSERT (pd != NULL);
+  for (pde = pd; pde < pd + pd_no (PHYS_BASE); pde++)
+    if (*pde & PTE_P)
+      cnt++;
+  return cnt;
+}
+
 /* Returns the address of the page table entry for virtual
    address VADDR in page directory PD.
    If PD does not have a page table for VADDR, behavior depends
@@ -66,6 +106,7 @@ lookup_page (uint32_t *pd, const void *vaddr, bool create)
   /* Check for a page table for VADDR.
      If one is missing, create one if requested. */
   pde = pd + pd_no (vaddr);
+  ASSERT ((*pde & PTE_PS) == 0);
   if (*pde == 0) 
     {
       if (create)
@@ -118,6 +159,48 @@ pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool writable)
     return false;
 }
 
+/* Maps user virtual page UPAGE in PD to page KPAGE, which the
+   kernel owns and may share with other processes (see
+   userprog/vdso.c and userprog/shm.c), read/write if WRITABLE is
+   true and read-only otherwise.  pagedir_destroy() does not free
+   it and pagedir_fork() does not copy the mapping.  Returns true
+   if successful, false if memory allocation failed. */
+bool
+pagedir_set_kernel_page (uint32_t *pd, void *upage, void *kpage,
+                         bool writable)
+{
+  uint32_t *pte;
+
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (is_user_vaddr (upage));
+  ASSERT (pd != init_page_dir);
+
+  pte = lookup_page (pd, upage, true);
+  if (pte == NULL)
+    return false;
+  ASSERT ((*pte & PTE_P) == 0);
+  *pte = pte_create_user (kpage, writable) | PTE_KERN;
+  return true;
+}
+
+/* Returns true if user virtual address UADDR is mapped in PD to
+   a page set up by pagedir_set_kernel_page(), false otherwise. */
+bool
+pagedir_is_kernel_page (uint32_t *pd, const void *uaddr)
+{
+  uint32_t *pte = lookup_page (pd, uaddr, false);
+  return pte != NULL && (*pte & (PTE_P | PTE_KERN)) == (PTE_P | PTE_KERN);
+}
+
+/* Returns true if user virtual page UPAGE is mapped writable in
+   PD, false otherwise. */
+bool
+pagedir_is_writable (uint32_t *pd, const void *upage)
+{
+  uint32_t *pte = lookup_page (pd, upage, false);
+  return pte != NULL && (*pte & (PTE_P | PTE_W)) == (PTE_P | PTE_W);
+}
+
 /* Looks up the physical address that corresponds to user virtual
    address UADDR in PD.  Returns the kernel virtual address
    corresponding to that physical address, or a null pointer if
@@ -152,10 +235,139 @@ pagedir_clear_page (uint32_t *pd, void *upage)
   if (pte != NULL && (*pte & PTE_P) != 0)
     {
       *pte &= ~PTE_P;
-      invalidate_pagedir (pd);
+      invalidate_page (pd, upage);
     }
 }
 
+/* Points the existing mapping of user virtual page UPAGE in PD
+   at the frame identified by kernel virtual address KPAGE,
+   read/write if WRITABLE is true and read-only otherwise, and
+   clears its copy-on-write mark.  The accessed and dirty bits are
+   preserved.  UPAGE must already be mapped. */
+void
+pagedir_replace_page (uint32_t *pd, void *upage, void *kpage, bool writable)
+{
+  uint32_t *pte;
+
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (pg_ofs (kpage) == 0);
+  ASSERT (is_user_vaddr (upage));
+
+  pte = lookup_page (pd, upage, false);
+  ASSERT (pte != NULL && (*pte & PTE_P) != 0);
+  *pte = (pte_create_user (kpage, writable)
+          | (*pte & (PTE_A | PTE_D)));
+  invalidate_page (pd, upage);
+}
+
+/* Returns true if user virtual page UPAGE is mapped in PD and
+   marked copy-on-write, false otherwise. */
+bool
+pagedir_is_cow (uint32_t *pd, const void *upage) 
+{
+  uint32_t *pte = lookup_page (pd, upage, false);
+  return pte != NULL && (*pte & (PTE_P | PTE_COW)) == (PTE_P | PTE_COW);
+}
+
+/* Marks the read-only mapping of user virtual page UPAGE in PD
+   copy-on-write, so that a write to it faults and can be given a
+   private frame instead of being an error. */
+void
+pagedir_set_cow (uint32_t *pd, const void *upage) 
+{
+  uint32_t *pte = lookup_page (pd, upage, false);
+
+  ASSERT (pte != NULL && (*pte & PTE_P) != 0);
+  ASSERT ((*pte & PTE_W) == 0);
+  *pte |= PTE_COW;
+}
+
+#ifdef VM
+/* Replaces the mapping of user virtual page UPAGE in PD by a
+   not-present entry recording that the page's contents are in
+   swap slot SLOT.  UPAGE must be mapped. */
+void
+pagedir_set_swap (uint32_t *pd, void *upage, size_t slot) 
+{
+  uint32_t *pte = lookup_page (pd, upage, false);
+
+  ASSERT (pte != NULL && (*pte & PTE_P) != 0);
+  *pte = pte_create_swap (slot);
+  invalidate_page (pd, upage);
+}
+
+/* If user virtual page UPAGE in PD is swapped out, stores its
+   swap slot into *SLOT and returns true.  Otherwise, returns
+   false. */
+bool
+pagedir_get_swap (uint32_t *pd, const void *upage, size_t *slot) 
+{
+  uint32_t *pte = lookup_page (pd, upage, false);
+
+  if (pte == NULL || (*pte & (PTE_P | PTE_SWAP)) != PTE_SWAP)
+    return false;
+  *slot = pte_get_swap (*pte);
+  return true;
+}
+#endif
+
+#ifdef VM
+/* Fills DST, a page directory freshly returned by
+   pagedir_create(), with the user mappings of SRC, sharing every
+   frame instead of copying it.  Writable pages become read-only
+   and copy-on-write in both page directories, so whichever
+   process writes to such a page first gets its own copy (see
+   frame_unshare()).  Swapped-out pages share their swap slot,
+   and each process reads its own copy back in.  The frame table
+   must not evict SRC's pages meanwhile (see frame_pin()).
+   Returns true if successful, false if a page table for DST
+   could not be allocated, in which case DST holds a subset of
+   the mappings and should be destroyed. */
+bool
+pagedir_fork (uint32_t *dst, uint32_t *src)
+{
+  uint32_t *pde;
+  bool success = true;
+
+  ASSERT (src != init_page_dir);
+  ASSERT (dst != init_page_dir);
+
+  for (pde = src; success && pde < src + pd_no (PHYS_BASE); pde++)
+    if (*pde & PTE_P) 
+      {
+        uint32_t *pt = pde_get_pt (*pde);
+        size_t i;
+
+        for (i = 0; i < PGSIZE / sizeof *pt; i++)
+          if ((pt[i] & (PTE_P | PTE_SWAP)) && !(pt[i] & PTE_KERN))
+            {
+              void *upage = (void *) (((pde - src) << PDSHIFT)
+                                      | (i << PTSHIFT));
+              uint32_t *dst_pte = lookup_page (dst, upage, true);
+
+              if (dst_pte == NULL)
+                {
+                  success = false;
+                  break;
+                }
+              if (!(pt[i] & PTE_P))
+                swap_dup (pte_get_swap (pt[i]));
+              else
+                {
+                  if (pt[i] & PTE_W)
+                    pt[i] = (pt[i] & ~(uint32_t) PTE_W) | PTE_COW;
+                  frame_ref (pte_get_page (pt[i]));
+                }
+              *dst_pte = pt[i];
+            }
+      }
+
+  /* SRC lost write access to its pages. */
+  invalidate_pagedir (src);
+  return success;
+}
+#endif
+
 /* Returns true if the PTE for virtual page VPAGE in PD is dirty,
    that is, if the page has been modified since the PTE was
    installed.
@@ -180,7 +392,7 @@ pagedir_set_dirty (uint32_t *pd, const void *vpage, bool dirty)
       else 
         {
           *pte &= ~(uint32_t) PTE_D;
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
         }
     }
 }
@@ -209,25 +421,38 @@ pagedir_set_accessed (uint32_t *pd, const void *vpage, bool accessed)
       else 
         {
           *pte &= ~(uint32_t) PTE_A; 
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
         }
     }
 }
 
 /* Loads page directory PD into the CPU's page directory base
-   register. */
+   register, unless it is already loaded.  Switching between
+   threads that share a page directory thus keeps the TLB. */
 void
 pagedir_activate (uint32_t *pd) 
 {
   if (pd == NULL)
     pd = init_page_dir;
 
-  /* Store the physical address of the page directory into CR3
-     aka PDBR (page directory base register).  This activates our
-     new page tables immediately.  See [IA32-v2a] "MOV--Move
-     to/from Control Registers" and [IA32-v3a] 3.7.5 "Base
-     Address of the Page Directory". */
-  asm volatile ("movl %0, %%cr3" : : "r" (vtop (pd)) : "memory");
+  if (active_pd () != pd)
+    load_pagedir (pd);
+  else
+    cr3_skip_cnt++;
+}
+
+/* Prints TLB statistics. */
+void
+pagedir_print_stats (void) 
+{
+  int64_t ticks = timer_ticks ();
+
+  if (ticks < 1)
+    ticks = 1;
+  printf ("TLB: %lld full flushes (%lld/s), %lld single-page flushes "
+          "(%lld/s), %lld page directory reloads skipped\n",
+          cr3_load_cnt, cr3_load_cnt * TIMER_FREQ / ticks,
+          invlpg_cnt, invlpg_cnt * TIMER_FREQ / ticks, cr3_skip_cnt);
 }
 
 /* Returns the currently active page directory. */
@@ -243,21 +468,51 @@ active_pd (void)
   return ptov (pd);
 }
 
-/* Seom page table changes can cause the CPU's translation
+/* Stores the physical address of page directory PD into CR3
+   aka PDBR (page directory base register).  This activates our
+   new page tables immediately and flushes all TLB entries except
+   global ones, that is, the kernel's.  See [IA32-v2a] "MOV--Move
+   to/from Control Registers" and [IA32-v3a] 3.7.5 "Base Address
+   of the Page Directory". */
+static void
+load_pagedir (uint32_t *pd) 
+{
+  asm volatile ("movl %0, %%cr3" : : "r" (vtop (pd)) : "memory");
+  cr3_load_cnt++;
+}
+
+#ifdef VM
+/* Some page table changes can cause the CPU's translation
    lookaside buffer (TLB) to become out-of-sync with the page
    table.  When this happens, we have to "invalidate" the TLB by
    re-activating it.
 
    This function invalidates the TLB if PD is the active page
    directory.  (If PD is not active then its entries are not in
-   the TLB, so there is no need to invalidate anything.) */
+   the TLB, so there is no need to invalidate anything.)  It is
+   for changes to many pages at once; invalidate_page() is
+   cheaper for one. */
 static void
 invalidate_pagedir (uint32_t *pd) 
 {
   if (active_pd () == pd) 
     {
-      /* Re-activating PD clears the TLB.  See [IA32-v3a] 3.12
+      /* Reloading CR3 clears the TLB.  See [IA32-v3a] 3.12
          "Translation Lookaside Buffers (TLBs)". */
-      pagedir_activate (pd);
+      load_pagedir (pd);
     } 
 }
+#endif
+
+/* Invalidates the TLB entry for user virtual page UPAGE if PD is
+   the active page directory, leaving other entries alone.  See
+   [IA32-v2a] "INVLPG". */
+static void
+invalidate_page (uint32_t *pd, const void *upage) 
+{
+  if (active_pd () == pd) 
+    {
+      asm volatile ("invlpg (%0)" : : "r" (upage) : "memory");
+      invlpg_cnt++;
+    }
+}
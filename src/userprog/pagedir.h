@@ -2,17 +2,32 @@
 #define USERPROG_PAGEDIR_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 uint32_t *pagedir_create (void);
 void pagedir_destroy (uint32_t *pd);
+size_t pagedir_count_tables (uint32_t *pd);
 bool pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool rw);
+bool pagedir_set_kernel_page (uint32_t *pd, void *upage, void *kpage,
+                              bool writable);
+bool pagedir_is_kernel_page (uint32_t *pd, const void *uaddr);
+bool pagedir_is_writable (uint32_t *pd, const void *upage);
 void *pagedir_get_page (uint32_t *pd, const void *upage);
 void pagedir_clear_page (uint32_t *pd, void *upage);
+void pagedir_replace_page (uint32_t *pd, void *upage, void *kpage, bool rw);
+bool pagedir_is_cow (uint32_t *pd, const void *upage);
+void pagedir_set_cow (uint32_t *pd, const void *upage);
+#ifdef VM
+void pagedir_set_swap (uint32_t *pd, void *upage, size_t slot);
+bool pagedir_get_swap (uint32_t *pd, const void *upage, size_t *slot);
+bool pagedir_fork (uint32_t *dst, uint32_t *src);
+#endif
 bool pagedir_is_dirty (uint32_t *pd, const void *upage);
 void pagedir_set_dirty (uint32_t *pd, const void *upage, bool dirty);
 bool pagedir_is_accessed (uint32_t *pd, const void *upage);
 void pagedir_set_accessed (uint32_t *pd, const void *upage, bool accessed);
 void pagedir_activate (uint32_t *pd);
+void pagedir_print_stats (void);
 
 #endif /* userprog/pagedir.h */
@@ -5,99 +5,117 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "userprog/aio.h"
+#include "userprog/exec-cache.h"
+#include "userprog/fdtable.h"
+#include "userprog/futex.h"
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
+#include "userprog/shm.h"
 #include "userprog/tss.h"
+#include "userprog/uaccess.h"
+#include "userprog/vdso.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/pipe.h"
+#include "devices/input.h"
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
-
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/page.h"
+#endif
+
+/* Print memory and fault counts at exit? */
+bool process_show_rusage;
+
+static struct process *new_process (void);
+static pid_t add_child (struct process *, tid_t, bool success);
+static void end_process (struct process *);
+static void free_process (struct process *);
 static thread_func start_process NO_RETURN;
+#ifdef VM
+static thread_func start_fork NO_RETURN;
+#endif
+static thread_func start_thread NO_RETURN;
+static void exit_thread (void);
+static void wait_for_threads (struct thread *leader);
+static void kill_group (struct thread_group *);
+static void release_children (struct thread *);
+static void wake_waiting_parent (struct thread *leader);
 static bool load (const char *cmdline, void (**eip) (void), void **esp);
 static void push_args (const char * tokens[], int argc, void **esp);
 
-/* Starts a new thread running a user program loaded from
-   FILENAME.  The new thread may be scheduled (and may even exit)
-   before process_execute() returns.  Returns the new process's
-   thread id, or TID_ERROR if the thread cannot be created. */
+/* Arguments passed from process_execute() to start_process(). */
+struct exec_args
+  {
+    char *cmdline;              /* Command line, in a page of its own. */
+    struct process *proc;       /* New process's record. */
+    struct thread *parent;      /* Thread that called exec(). */
+    struct semaphore loaded;    /* Upped once the child has loaded. */
+    bool success;               /* Did it load? */
+  };
+
+/* Starts a new thread running a user program loaded from the
+   first word of CMD, passing it the rest of CMD as arguments.
+   Returns the new process's pid once it has loaded, or PID_ERROR
+   if the thread cannot be created or the program cannot be
+   loaded. */
 pid_t
 process_execute (const char *cmd) 
 {
-  char *cmd_copy = NULL;
-  char *file_name = NULL;
-  char *rest = NULL; //use for strtok_r ()
-  struct process *proc = NULL;
+  struct exec_args args;
+  char name[16];
   tid_t tid;
 
-  /* Make a copy of COMMAND.
+  /* Make a copy of CMD.
      Otherwise there's a race between the caller and load(). */
-  cmd_copy = palloc_get_page (0);
-  if (cmd_copy == NULL) {
-    return TID_ERROR;
-  }
-  strlcpy (cmd_copy, cmd, PGSIZE);
+  args.cmdline = palloc_get_page (0);
+  if (args.cmdline == NULL)
+    return PID_ERROR;
+  strlcpy (args.cmdline, cmd, PGSIZE);
 
-  /* extrac file name from cmd */
-  file_name = palloc_get_page (0);
-  if (file_name == NULL) {
-    palloc_free_page (cmd_copy);
-    return PID_ERROR; 
-  }
-  file_name = strtok_r (cmd_copy, " ", &rest);
-
-  /* Create a new thread to execute FILE_NAME. */
-  /* create process control data */
-  proc = palloc_get_page (0);
-  if (proc == NULL) {
-    palloc_free_page (cmd_copy);
-    palloc_free_page (file_name);
-    return PID_ERROR; 
-  }
-  proc->pid = PID_INIT; //set in start_process 
-  proc->cmdline = cmd_copy;
-  proc->parent_thread = thread_current ();
-  proc->waiting = false;
-  proc->exited = false;
-  proc->orphan = false;
-  proc->exitcode = -1;
-  sema_init(&proc->sema_init, 0);
-  sema_init(&proc->sema_wait, 0);
-
-  /* new thread */
-  tid = thread_create (file_name, PRI_DEFAULT, start_process, proc);
-  if (tid == TID_ERROR) {
-    palloc_free_page (cmd_copy); 
-    palloc_free_page (file_name); 
-    palloc_free_page (proc);
-    return PID_ERROR; 
-  }
-  sema_down (&proc->sema_init); /* wait for initialization in start_process () */
+  /* Name the thread after the program. */
+  strlcpy (name, cmd + strspn (cmd, " "), sizeof name);
+  name[strcspn (name, " ")] = '\0';
 
-  // process created successfully
-  if (proc->pid >= 0) {
-    list_push_back (&(thread_current ()->child_list), &(thread_current ()->childelem));
-  }
+  args.proc = new_process ();
+  if (args.proc == NULL)
+    {
+      palloc_free_page (args.cmdline);
+      return PID_ERROR;
+    }
+  args.parent = thread_current ();
+  sema_init (&args.loaded, 0);
+  args.success = false;
+
+  /* Create a new thread to execute the program.  It owns the
+     command line page from here on. */
+  tid = thread_create (name, PRI_DEFAULT, start_process, &args);
+  if (tid == TID_ERROR)
+    {
+      palloc_free_page (args.cmdline);
+      free (args.proc);
+      return PID_ERROR;
+    }
+  sema_down (&args.loaded);
 
-  //free pages  
-  if (cmd_copy) palloc_free_page (cmd_copy); 
-  if (file_name) palloc_free_page (file_name); 
-  
-  return proc->pid;
+  return add_child (args.proc, tid, args.success);
 }
 
 /* A thread function that loads a user process and starts it
    running. */
 static void
-start_process (void *proc_)
+start_process (void *args_)
 {
-  struct process *proc = proc_;
-  char *cmd = (char *) proc->cmdline;
+  struct exec_args *args = args_;
+  char *cmd = args->cmdline;
   struct thread *cur_t = thread_current ();
   bool success = false; 
 
@@ -112,7 +130,8 @@ start_process (void *proc_)
   char *token;
   char *rest;
   int argc = 0;
-  while ((token = strtok_r (cmd, " ", &rest))) {
+  for (token = strtok_r (cmd, " ", &rest); token != NULL;
+       token = strtok_r (NULL, " ", &rest)) {
     tokens[argc++] = token;
   }
   
@@ -122,7 +141,7 @@ start_process (void *proc_)
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
   if_.cs = SEL_UCSEG;
   if_.eflags = FLAG_IF | FLAG_MBS;
-  success = load (cmd, &if_.eip, &if_.esp);
+  success = argc > 0 && load (tokens[0], &if_.eip, &if_.esp);
 
   if (success) {
     push_args (tokens, argc, &if_.esp);
@@ -132,15 +151,21 @@ start_process (void *proc_)
 
 FINISH_STEP:
   palloc_free_page (cmd);
-  /* map pid to tid, assign proc to thread struct */
-  proc->pid = success ? (pid_t)(cur_t->tid) : PID_ERROR;
-  cur_t->proc = proc;
-  list_init (&cur_t->fd_list);
-  list_init (&cur_t->child_list);
-  list_elem_init (&cur_t->childelem);
+  /* assign proc to thread struct */
+  cur_t->proc = args->proc;
+  if (success) {
+    cur_t->fd_table = fd_table_create ();
+    success = cur_t->fd_table != NULL;
+  }
+  /* standard descriptors are inherited; the parent is blocked
+   * until we signal loaded, so its table can be read safely */
+  if (success && args->parent->fd_table != NULL) {
+    fd_table_inherit (cur_t->fd_table, args->parent->fd_table);
+  }
   
-  /* wake up process_execute () */
-  sema_up (&proc->sema_init);
+  /* wake up process_execute (), after which ARGS is gone */
+  args->success = success;
+  sema_up (&args->loaded);
 
   if (!success) 
     thread_exit ();
@@ -155,62 +180,650 @@ FINISH_STEP:
   NOT_REACHED ();
 }
 
-/* Waits for thread TID to die and returns its exit status.  If
-   it was terminated by the kernel (i.e. killed due to an
-   exception), returns -1.  If TID is invalid or if it was not a
-   child of the calling process, or if process_wait() has already
-   been successfully called for the given TID, returns -1
-   immediately, without waiting.
+#ifdef VM
+/* Arguments passed from process_fork() to start_fork(). */
+struct fork_args
+  {
+    struct process *proc;       /* Child's process record. */
+    struct thread *parent;      /* Thread that called fork(). */
+    uint32_t *pagedir;          /* Child's copy-on-write page directory. */
+    struct intr_frame if_;      /* Parent's user context at fork(). */
+    struct semaphore loaded;    /* Upped once the child is set up. */
+    bool success;               /* Was it? */
+  };
 
-   This function will be implemented in problem 2-2.  For now, it
-   does nothing. */
-int
-process_wait (pid_t child_pid) 
+/* Starts a new process that is a copy of the running one.  IF_
+   is the interrupt frame of the fork() system call; the child
+   resumes user execution from it with 0 as fork()'s return value.
+   The child's address space shares all of the parent's frames
+   copy-on-write instead of loading the executable again, and its
+   file descriptors refer to the same open files as the parent's.
+   Returns the new process's pid, or PID_ERROR if it cannot be
+   created. */
+pid_t
+process_fork (const struct intr_frame *if_)
 {
-  struct thread *cur_t = thread_current();
-  struct list *child_list = &(cur_t->child_list); 
-  struct thread *child_thread = NULL;
-  
-  /* check if it is the child process */
-  for (struct list_elem *e = list_begin (child_list); e != list_end (child_list);
-       e = list_next (e)) {
-    struct thread *t = list_entry (e, struct thread, childelem); 
-    if (child_thread->proc->pid == child_pid) {
-      child_thread = t;
-      break;  
+  struct thread *cur_t = thread_current ();
+  struct fork_args *args;
+  struct process *proc;
+  bool success = false;
+  tid_t tid;
+  pid_t pid;
+
+  /* A process that has started threads cannot fork, since they
+     could change the address space while it is being shared. */
+  if (cur_t->group != NULL)
+    return PID_ERROR;
+
+  proc = new_process ();
+  if (proc == NULL)
+    return PID_ERROR;
+  args = malloc (sizeof *args);
+  if (args == NULL)
+    {
+      free (proc);
+      return PID_ERROR;
     }
-  }
 
-  if (child_thread == NULL) { 
-    printf ("child thread NOT found: pid=%d", child_pid);
-    return -1;
-  }
-  
-  struct process *child_proc = child_thread->proc;
-  if (child_proc == NULL) { 
-    printf ("child process NOT found: pid=%d", child_pid);
+  /* Share the address space copy-on-write.  This is done here
+     rather than in the child so that the TLB flush for our own,
+     now read-only, mappings happens while our page directory is
+     the active one. */
+  args->proc = proc;
+  args->parent = cur_t;
+  args->if_ = *if_;
+  sema_init (&args->loaded, 0);
+  args->success = false;
+  args->pagedir = pagedir_create ();
+  if (args->pagedir != NULL)
+    {
+      frame_pin (true);
+      success = pagedir_fork (args->pagedir, cur_t->pagedir);
+      frame_pin (false);
+    }
+  if (!success)
+    {
+      pagedir_destroy (args->pagedir);
+      free (args);
+      free (proc);
+      return PID_ERROR;
+    }
+
+  tid = thread_create (cur_t->name, PRI_DEFAULT, start_fork, args);
+  if (tid == TID_ERROR)
+    {
+      pagedir_destroy (args->pagedir);
+      free (args);
+      free (proc);
+      return PID_ERROR;
+    }
+  sema_down (&args->loaded); /* wait for initialization in start_fork () */
+
+  pid = add_child (proc, tid, args->success);
+  free (args);
+  return pid;
+}
+
+/* A thread function that finishes setting up a forked process
+   and returns to user mode in it. */
+static void
+start_fork (void *args_)
+{
+  struct fork_args *args = args_;
+  struct process *proc = args->proc;
+  struct thread *parent = args->parent;
+  struct thread *cur_t = thread_current ();
+  struct intr_frame if_ = args->if_;
+  bool success;
+
+  cur_t->pagedir = args->pagedir;
+  process_activate ();
+
+  cur_t->proc = proc;
+
+  /* The parent is blocked until we signal loaded, so its file
+     descriptors, regions and executable can be read safely. */
+  cur_t->fd_table = fd_table_dup (parent->fd_table);
+  cur_t->vdso_page = vdso_map (cur_t->pagedir, cur_t->tid);
+  success = (cur_t->fd_table != NULL && cur_t->vdso_page != NULL
+             && page_space_fork (parent));
+  /* Every page the parent has in memory is now mapped by us too. */
+  cur_t->rusage.resident = parent->rusage.resident;
+  cur_t->rusage.peak_resident = parent->rusage.resident;
+  if (success && parent->exec_file != NULL)
+    {
+      cur_t->exec_file = file_reopen (parent->exec_file);
+      if (cur_t->exec_file != NULL)
+        file_deny_write (cur_t->exec_file);
+      else
+        success = false;
+    }
+
+  /* wake up process_fork () */
+  args->success = success;
+  sema_up (&args->loaded);
+
+  if (!success)
+    thread_exit ();
+
+  /* fork() returns 0 in the child. */
+  if_.eax = 0;
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
+#endif /* VM */
+
+/* Process table.
+
+   Every user process has a small record, struct process, that
+   holds its exit code.  The record outlives the process's
+   threads, as a zombie, until the parent reaps it with wait() or
+   exits itself, so the records live in a table of their own
+   rather than in struct thread.  The table is a hash keyed by
+   pid, so that wait() finds a child in constant time however
+   many children there are, and each process's main thread also
+   lists its children, so that they can be let go when it exits.
+
+   process_lock protects the table, the children lists and the
+   records' `parent', `exited' and `waited' members, and goes
+   with their `exited_cond'.  A record is freed by whichever of
+   the child exiting and the parent letting go of it (by reaping
+   it, exiting, or finding that it failed to load) happens
+   second. */
+
+/* All processes that have not been freed, by pid. */
+static struct hash process_table;
+
+/* Protects the process table, see above. */
+static struct lock process_lock;
+
+static hash_hash_func process_hash;
+static hash_less_func process_less;
+
+/* Initializes the process table. */
+void
+process_init (void)
+{
+  hash_init (&process_table, process_hash, process_less, NULL);
+  lock_init (&process_lock);
+}
+
+/* Returns a new record for a child of the running process, not
+   yet in the process table, or a null pointer if memory is
+   exhausted. */
+static struct process *
+new_process (void)
+{
+  struct process *proc = malloc (sizeof *proc);
+
+  if (proc != NULL)
+    {
+      proc->pid = PID_ERROR;
+      proc->parent = process_leader (thread_current ())->tid;
+      proc->exited = false;
+      proc->waited = false;
+      proc->exitcode = -1;
+      cond_init (&proc->exited_cond);
+    }
+  return proc;
+}
+
+/* Enters PROC, whose main thread TID has been started by the
+   running process, into the process table, and makes it a child
+   of the running process if it started successfully (SUCCESS).
+   Returns its pid, or PID_ERROR if it failed to start. */
+static pid_t
+add_child (struct process *proc, tid_t tid, bool success)
+{
+  struct thread *parent = process_leader (thread_current ());
+
+  lock_acquire (&process_lock);
+  proc->pid = tid;
+  hash_insert (&process_table, &proc->hash_elem);
+  if (success)
+    list_push_back (&parent->children, &proc->child_elem);
+  else
+    {
+      /* It exits right away, with nobody to reap it. */
+      proc->parent = PID_ERROR;
+      if (proc->exited)
+        free_process (proc);
+    }
+  lock_release (&process_lock);
+
+  return success ? tid : PID_ERROR;
+}
+
+/* Records that PROC has exited, waking its parent if it is
+   waiting, and frees PROC if the parent has let go of it. */
+static void
+end_process (struct process *proc)
+{
+  lock_acquire (&process_lock);
+  proc->exited = true;
+  cond_signal (&proc->exited_cond, &process_lock);
+  if (proc->parent == PID_ERROR)
+    free_process (proc);
+  lock_release (&process_lock);
+}
+
+/* Wakes the threads of LEADER's process that are waiting in
+   process_wait(), because the process is exiting. */
+static void
+wake_waiting_parent (struct thread *leader)
+{
+  struct list_elem *e;
+
+  lock_acquire (&process_lock);
+  for (e = list_begin (&leader->children); e != list_end (&leader->children);
+       e = list_next (e))
+    {
+      struct process *proc = list_entry (e, struct process, child_elem);
+      cond_broadcast (&proc->exited_cond, &process_lock);
+    }
+  lock_release (&process_lock);
+}
+
+/* Lets go of the child processes of T_PARENT, a main thread that
+   is exiting, freeing those that have already exited. */
+static void
+release_children (struct thread *t_parent)
+{
+  lock_acquire (&process_lock);
+  while (!list_empty (&t_parent->children))
+    {
+      struct process *proc = list_entry (list_pop_front (&t_parent->children),
+                                         struct process, child_elem);
+
+      proc->parent = PID_ERROR;
+      if (proc->exited)
+        free_process (proc);
+    }
+  lock_release (&process_lock);
+}
+
+/* Removes PROC from the process table and frees it.  The caller
+   must hold process_lock. */
+static void
+free_process (struct process *proc)
+{
+  ASSERT (lock_held_by_current_thread (&process_lock));
+
+  hash_delete (&process_table, &proc->hash_elem);
+  free (proc);
+}
+
+/* Returns a hash value for the process record containing E. */
+static unsigned
+process_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_int (hash_entry (e, struct process, hash_elem)->pid);
+}
+
+/* Returns true if the process record containing A has a lower
+   pid than the one containing B. */
+static bool
+process_less (const struct hash_elem *a, const struct hash_elem *b,
+              void *aux UNUSED)
+{
+  return (hash_entry (a, struct process, hash_elem)->pid
+          < hash_entry (b, struct process, hash_elem)->pid);
+}
+
+/* Threads of a process.
+
+   A process starts with one thread, its main thread, which owns
+   the page directory, file descriptor table and everything else
+   that makes up the process.  process_thread_create() starts
+   more, each a kernel thread of its own that shares those with
+   the main thread and returns to user mode at a given function
+   with a stack that the program provides.  The first one created
+   gives the process a thread group, which lists the other
+   threads so that they can be joined and so that the main thread
+   can wait for them when the process exits.
+
+   exit() from any thread ends the whole process.  The exit code
+   is the first one given, and the group starts dying: every
+   other thread exits at its next system call or on its next way
+   back to user mode after an interrupt, and threads sleeping on
+   a futex, a pipe, the keyboard, process_wait() or
+   process_thread_join() are woken to do so.  (A thread blocked
+   elsewhere in the kernel, say on the disk, exits once that
+   finishes.)  The main thread, whenever it gets to
+   process_exit(), first waits for the others to be gone, so that
+   it can safely free what they share. */
+
+/* A process's other threads. */
+struct thread_group
+  {
+    struct thread *leader;      /* Main thread. */
+    struct lock lock;           /* Protects the members below. */
+    struct condition changed;   /* A thread exited, or dying was set. */
+    struct list members;        /* struct group_member, one per thread. */
+    int running;                /* Number of threads that have not exited. */
+    bool dying;                 /* Is the process exiting? */
+  };
+
+/* A thread other than the main thread, until it is joined. */
+struct group_member
+  {
+    struct list_elem elem;      /* Element in thread_group's `members'. */
+    tid_t tid;                  /* Thread's identifier. */
+    bool exited;                /* Has it exited? */
+  };
+
+/* Arguments passed from process_thread_create() to
+   start_thread(). */
+struct thread_args
+  {
+    struct thread_group *group; /* Group to join. */
+    struct intr_frame if_;      /* User context to start in. */
+  };
+
+/* Returns the main thread of T's process, which is T itself
+   unless T was started by process_thread_create(). */
+struct thread *
+process_leader (struct thread *t)
+{
+  return t->group != NULL ? t->group->leader : t;
+}
+
+/* Returns true if the running thread's process is exiting, in
+   which case the thread should exit as soon as it can. */
+bool
+process_is_dying (void)
+{
+  struct thread_group *g = thread_current ()->group;
+  return g != NULL && g->dying;
+}
+
+/* Records STATUS as the running process's exit code, unless
+   another thread got there first, and tells the process's other
+   threads to exit.  The caller should then call thread_exit(). */
+void
+process_set_exit (int status)
+{
+  struct thread *leader = process_leader (thread_current ());
+  struct thread_group *g = leader->group;
+
+  /* user program should have proc not freed at this point */
+  ASSERT (leader->proc != NULL);
+  if (g == NULL)
+    {
+      leader->proc->exitcode = status;
+      return;
+    }
+  lock_acquire (&g->lock);
+  if (!g->dying)
+    {
+      leader->proc->exitcode = status;
+      kill_group (g);
+    }
+  lock_release (&g->lock);
+}
+
+/* Starts a new thread in the running process, which returns to
+   user mode by calling START (ARG) on the user stack whose top
+   is STACK.  START must not return.  Returns the new thread's
+   identifier, or TID_ERROR if STACK is not valid user memory,
+   if the process is exiting, or if memory is exhausted. */
+tid_t
+process_thread_create (void (*start) (void *), void *arg, void *stack)
+{
+  struct thread *cur_t = thread_current ();
+  struct thread *leader = process_leader (cur_t);
+  struct thread_group *g = leader->group;
+  struct group_member *m;
+  struct thread_args *args;
+  uint32_t frame[2];
+  uint8_t *esp = (uint8_t *) stack - sizeof frame;
+  tid_t tid;
+
+  /* Push ARG and a null return address, as a call would. */
+  frame[0] = 0;
+  frame[1] = (uint32_t) arg;
+  if (!is_user_vaddr (start) || !is_user_vaddr (stack)
+      || copy_to_user (esp, frame, sizeof frame) != 0)
+    return TID_ERROR;
+
+  if (g == NULL)
+    {
+      g = malloc (sizeof *g);
+      if (g == NULL)
+        return TID_ERROR;
+      g->leader = leader;
+      lock_init (&g->lock);
+      cond_init (&g->changed);
+      list_init (&g->members);
+      g->running = 0;
+      g->dying = false;
+      leader->group = g;
+    }
+
+  m = malloc (sizeof *m);
+  args = malloc (sizeof *args);
+  if (m == NULL || args == NULL)
+    {
+      free (m);
+      free (args);
+      return TID_ERROR;
+    }
+  args->group = g;
+  memset (&args->if_, 0, sizeof args->if_);
+  args->if_.gs = args->if_.fs = args->if_.es = args->if_.ds = SEL_UDSEG;
+  args->if_.ss = SEL_UDSEG;
+  args->if_.cs = SEL_UCSEG;
+  args->if_.eflags = FLAG_IF | FLAG_MBS;
+  args->if_.eip = (void (*) (void)) start;
+  args->if_.esp = esp;
+
+  /* The group lock keeps the new thread from exiting before its
+     member is in the list. */
+  lock_acquire (&g->lock);
+  tid = g->dying ? TID_ERROR : thread_create (leader->name, PRI_DEFAULT,
+                                              start_thread, args);
+  if (tid != TID_ERROR)
+    {
+      m->tid = tid;
+      m->exited = false;
+      list_push_back (&g->members, &m->elem);
+      g->running++;
+    }
+  lock_release (&g->lock);
+
+  if (tid == TID_ERROR)
+    {
+      free (m);
+      free (args);
+    }
+  return tid;
+}
+
+/* Waits for thread TID, which must have been started by
+   process_thread_create() in the running process and not joined
+   yet, to exit.  Returns 0 if successful, -1 if TID is not such
+   a thread or the process starts exiting meanwhile. */
+int
+process_thread_join (tid_t tid)
+{
+  struct thread_group *g = process_leader (thread_current ())->group;
+  struct group_member *m = NULL;
+  struct list_elem *e;
+
+  if (g == NULL || tid == thread_current ()->tid)
     return -1;
-  }
-  if (child_proc->waiting) {
-    printf ("process_wait has been called on child process: pid=%d", child_pid);
+
+  lock_acquire (&g->lock);
+  for (e = list_begin (&g->members); e != list_end (&g->members);
+       e = list_next (e))
+    if (list_entry (e, struct group_member, elem)->tid == tid)
+      {
+        m = list_entry (e, struct group_member, elem);
+        break;
+      }
+  while (m != NULL && !m->exited && !g->dying)
+    cond_wait (&g->changed, &g->lock);
+  if (m != NULL && m->exited)
+    list_remove (&m->elem);
+  else
+    m = NULL;
+  lock_release (&g->lock);
+
+  if (m == NULL)
     return -1;
-  } else {
-    child_proc->waiting = true;
-  }
-  
-  //wait for terminate
-  if (!child_proc->exited) {
-    sema_down (&child_proc->sema_wait); 
-  }
-  ASSERT (child_proc->exited);
+  free (m);
+  return 0;
+}
+
+/* A thread function that joins a thread group and returns to
+   user mode in it. */
+static void
+start_thread (void *args_)
+{
+  struct thread_args *args = args_;
+  struct thread *leader = args->group->leader;
+  struct thread *cur_t = thread_current ();
+  struct intr_frame if_ = args->if_;
+
+  cur_t->group = args->group;
+  cur_t->pagedir = leader->pagedir;
+  cur_t->fd_table = leader->fd_table;
+#ifdef VM
+  cur_t->vm = leader->vm;
+#endif
+  free (args);
+  process_activate ();
+
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
+/* Called by process_exit() in a thread started by
+   process_thread_create(), to free what the thread has of its own
+   and leave the group. */
+static void
+exit_thread (void)
+{
+  struct thread *cur_t = thread_current ();
+  struct thread_group *g = cur_t->group;
+  struct list_elem *e;
+
+  aio_destroy ();
+  palloc_free_page (cur_t->syscall_buf);
+  cur_t->syscall_buf = NULL;
+
+  /* Stop using what the main thread owns, which it may free as
+     soon as we leave the group. */
+  cur_t->fd_table = NULL;
+#ifdef VM
+  cur_t->vm = NULL;
+#endif
+  cur_t->pagedir = NULL;
+  pagedir_activate (NULL);
+
+  lock_acquire (&g->lock);
+  for (e = list_begin (&g->members); e != list_end (&g->members);
+       e = list_next (e))
+    {
+      struct group_member *m = list_entry (e, struct group_member, elem);
+      if (m->tid == cur_t->tid)
+        m->exited = true;
+    }
+  g->running--;
+  cond_broadcast (&g->changed, &g->lock);
+  lock_release (&g->lock);
+}
+
+/* Makes the other threads of LEADER's process exit, if they have
+   not yet, waits for them to be gone, and frees LEADER's thread
+   group.  LEADER must be the running thread. */
+static void
+wait_for_threads (struct thread *leader)
+{
+  struct thread_group *g = leader->group;
+
+  if (g == NULL)
+    return;
+
+  lock_acquire (&g->lock);
+  if (!g->dying)
+    kill_group (g);
+  while (g->running > 0)
+    cond_wait (&g->changed, &g->lock);
+  lock_release (&g->lock);
+
+  while (!list_empty (&g->members))
+    free (list_entry (list_pop_front (&g->members),
+                      struct group_member, elem));
+  leader->group = NULL;
+  free (g);
+}
+
+/* Starts group G dying, waking its threads that sleep where they
+   can be woken.  G's lock must be held. */
+static void
+kill_group (struct thread_group *g)
+{
+  ASSERT (lock_held_by_current_thread (&g->lock));
+
+  g->dying = true;
+  cond_broadcast (&g->changed, &g->lock);
+  futex_wake_process (g->leader);
+  pipe_wake_process (g->leader);
+  input_wake (g->leader);
+  wake_waiting_parent (g->leader);
+}
 
-  ASSERT (in_list(&child_thread->childelem));
-  list_remove (&child_thread->childelem); 
+/* Waits for child process CHILD_PID to die and returns its exit
+   status.  If it was terminated by the kernel (i.e. killed due
+   to an exception), returns -1.  If CHILD_PID is invalid or if
+   it was not a child of the calling process, or if
+   process_wait() has already been called for it, returns -1
+   immediately, without waiting.  Any thread of the parent
+   process may wait for the child.  Also returns -1 if the
+   parent starts exiting meanwhile. */
+int
+process_wait (pid_t child_pid) 
+{
+  struct thread *parent = process_leader (thread_current ());
+  struct process key, *proc = NULL;
+  struct hash_elem *e;
+  int exitcode;
+
+  key.pid = child_pid;
+  lock_acquire (&process_lock);
+  e = hash_find (&process_table, &key.hash_elem);
+  if (e != NULL)
+    {
+      proc = hash_entry (e, struct process, hash_elem);
+      if (proc->parent != parent->tid || proc->waited)
+        proc = NULL;
+      else
+        proc->waited = true;
+    }
+  if (proc == NULL)
+    {
+      lock_release (&process_lock);
+      return -1;
+    }
 
-  int exitcode = child_proc->exitcode;
-  palloc_free_page (child_proc);
- 
-  return exitcode; 
+  /* Only we reap PROC, so it stays put while we sleep. */
+  while (!proc->exited && !process_is_dying ())
+    cond_wait (&proc->exited_cond, &process_lock);
+  if (!proc->exited)
+    {
+      /* release_children () lets go of it instead */
+      lock_release (&process_lock);
+      return -1;
+    }
+
+  list_remove (&proc->child_elem);
+  exitcode = proc->exitcode;
+  free_process (proc);
+  lock_release (&process_lock);
+
+  return exitcode;
 }
 
 /* Free the current process's resources. */
@@ -221,50 +834,56 @@ process_exit (void)
   struct thread *cur_t = thread_current ();
   uint32_t *pd;
 
+  /* a thread other than the main thread owns little */
+  if (cur_t->group != NULL && cur_t->group->leader != cur_t) {
+    exit_thread ();
+    return;
+  }
+  /* the others share everything below, so they go first */
+  wait_for_threads (cur_t);
+
   /* free resources */
+  /* asynchronous I/O, whose requests may still be running */
+  aio_destroy ();
+
   /* file descriptor */
-  struct list *fd_list = &cur_t->fd_list;
-  while (!list_empty (fd_list)) {
-    struct list_elem *e = list_pop_front (fd_list);
-    struct file_desc *desc = list_entry (e, struct file_desc, elem);
-    file_close (desc->file);
-    palloc_free_page (desc);
-  }
+  fd_table_destroy (cur_t->fd_table);
+  cur_t->fd_table = NULL;
+
+  /* shared memory, whose pages pagedir_destroy () leaves alone */
+  shm_exit ();
 
   /* child process */
-  /* for process which called process_wait on process_execute */
-  /* they wont be in this list */
-  struct list *child_list = &cur_t->child_list;
-  while (!list_empty (child_list)) {
-    struct list_elem *e = list_pop_front (child_list);
-    struct thread *t = list_entry (e, struct thread, childelem);
-    if (t->proc->exited) {
-      palloc_free_page (t->proc); /* take care of case where parent does not call process_wait */
-    } else {
-      t->proc->orphan = true;
-      t->proc->parent_thread = NULL;
-    }
-  }
+  release_children (cur_t);
   
+  /* bounce page of read () and write () */
+  palloc_free_page (cur_t->syscall_buf);
+  cur_t->syscall_buf = NULL;
+
   /* release file */
   if (cur_t->exec_file != NULL) {
     file_allow_write (cur_t->exec_file);
     file_close (cur_t->exec_file);
     cur_t->exec_file = NULL;
   }
+#ifdef VM
+  page_space_destroy ();
+#endif
 
-  printf ("%s: exit(%d)\n", cur_t->name, cur_t->proc->exitcode); 
-  /* unblock parent thread which is waiting */
-  cur_t->proc->exited = true;
-  /* need save it cos parent thread unblocked could desctroy child threads */
-  bool is_orphan = cur_t->proc->orphan; 
-  sema_up (&cur_t->proc->sema_wait);
-
-  if (is_orphan) {
-    /* take care of case where parent does not call process_wait */
-    palloc_free_page (&cur_t->proc);
-  }
-
+  if (cur_t->proc != NULL)
+    printf ("%s: exit(%d)\n", cur_t->name, cur_t->proc->exitcode); 
+  if (cur_t->proc != NULL && process_show_rusage)
+    {
+      struct rusage ru;
+
+      process_get_rusage (cur_t, &ru);
+      printf ("%s: %u pages resident, %u peak, %u page tables, "
+              "%u minor faults, %u major faults, "
+              "%u pages swapped out, %u in\n",
+              cur_t->name, ru.resident, ru.peak_resident, ru.page_tables,
+              ru.minor_faults, ru.major_faults,
+              ru.swapped_out, ru.swapped_in);
+    }
   /* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
   pd = cur_t->pagedir;
@@ -277,10 +896,52 @@ process_exit (void)
          directory before destroying the process's page
          directory, or our active page directory will be one
          that's been freed (and cleared). */
+#ifdef VM
+      /* Keep the frame table from evicting pages while we free
+         them. */
+      frame_pin (true);
+#endif
       cur_t->pagedir = NULL;
       pagedir_activate (NULL);
       pagedir_destroy (pd);
     }
+
+  /* our page of the vDSO, which pagedir_destroy () leaves alone */
+  palloc_free_page (cur_t->vdso_page);
+  cur_t->vdso_page = NULL;
+
+  /* unblock the parent if it is waiting, now that everything is
+   * freed; the record stays until the parent reaps it */
+  if (cur_t->proc != NULL) {
+    end_process (cur_t->proc);
+    cur_t->proc = NULL;
+  }
+}
+
+/* Adds DELTA to the number of user pages that process T has in
+   memory, updating its peak.  The frame table may evict T's
+   pages while T itself maps new ones, so this is atomic. */
+void
+process_add_resident (struct thread *t, int delta)
+{
+  enum intr_level old_level = intr_disable ();
+
+  t->rusage.resident += delta;
+  if (t->rusage.resident > t->rusage.peak_resident)
+    t->rusage.peak_resident = t->rusage.resident;
+  intr_set_level (old_level);
+}
+
+/* Stores process T's memory and fault counts in *RU. */
+void
+process_get_rusage (struct thread *t, struct rusage *ru)
+{
+  enum intr_level old_level = intr_disable ();
+
+  *ru = t->rusage;
+  intr_set_level (old_level);
+  ru->page_tables = (t->pagedir != NULL
+                     ? pagedir_count_tables (t->pagedir) : 0);
 }
 
 /* Sets up the CPU for running user code in the current
@@ -291,8 +952,13 @@ process_activate (void)
 {
   struct thread *t = thread_current ();
 
-  /* Activate thread's page tables. */
-  pagedir_activate (t->pagedir);
+  /* Activate thread's page tables.  A kernel thread never touches
+     user memory, so it may as well run on whatever page directory
+     is loaded; every one maps the kernel.  process_exit() switches
+     away from a page directory before destroying it, so the one
+     loaded is always valid. */
+  if (t->pagedir != NULL)
+    pagedir_activate (t->pagedir);
 
   /* Set thread's kernel stack for use in processing
      interrupts. */
@@ -363,10 +1029,9 @@ struct Elf32_Phdr
 #define PF_R 4          /* Readable. */
 
 static bool setup_stack (void **esp);
+static bool read_headers (struct file *, struct exec_info *);
 static bool validate_segment (const struct Elf32_Phdr *, struct file *);
-static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
-                          uint32_t read_bytes, uint32_t zero_bytes,
-                          bool writable);
+static bool load_segment (struct file *, const struct exec_segment *);
 
 /* Loads an ELF executable from FILE_NAME into the current thread.
    Stores the executable's entry point into *EIP
@@ -376,9 +1041,8 @@ bool
 load (const char *file_name, void (**eip) (void), void **esp) 
 {
   struct thread *t = thread_current ();
-  struct Elf32_Ehdr ehdr;
+  struct exec_info info;
   struct file *file = NULL;
-  off_t file_ofs;
   bool success = false;
   int i;
 
@@ -387,27 +1051,91 @@ load (const char *file_name, void (**eip) (void), void **esp)
   if (t->pagedir == NULL) 
     goto done;
   process_activate ();
+  t->vdso_page = vdso_map (t->pagedir, t->tid);
+  if (t->vdso_page == NULL)
+    goto done;
+#ifdef VM
+  if (!page_space_create ())
+    goto done;
+#endif
 
-  /* Open executable file. */
+  /* Open executable file.  Writes to it are denied from the
+     start, so that it cannot change under us while it is loaded
+     or while its image in the exec cache is in use. */
   file = filesys_open (file_name);
   if (file == NULL) 
     {
       printf ("load: %s: open failed\n", file_name);
       goto done; 
     }
+  file_deny_write (file);
+
+  /* Read and verify the ELF headers, unless the exec cache
+     already has them. */
+  if (!exec_cache_lookup (file, &info))
+    {
+      if (!read_headers (file, &info))
+        {
+          printf ("load: %s: error loading executable\n", file_name);
+          goto done; 
+        }
+      exec_cache_insert (file, &info);
+    }
+
+  /* Load segments. */
+  for (i = 0; i < info.segment_cnt; i++)
+    if (!load_segment (file, &info.segments[i]))
+      goto done;
+
+  /* Set up stack. */
+  if (!setup_stack (esp))
+    goto done;
+
+  /* Start address. */
+  *eip = info.entry;
+
+  thread_current ()->exec_file = file;
+
+  success = true;
+
+ done:
+  /* We arrive here whether the load is successful or not.
+     On success the file stays open as exec_file until
+     process_exit(). */
+  if (!success)
+    file_close (file);
+  return success;
+}
+
+/* load() helpers. */
+
+static bool install_page (void *upage, void *kpage, bool writable);
+static void *user_page_alloc (enum palloc_flags);
+static void user_page_free (void *kpage);
+
+/* Reads and verifies the executable header and program headers
+   of FILE, and stores the entry point and loadable segments they
+   describe in *INFO.  Returns true if successful, false if FILE
+   is not an executable we can load, including one with more than
+   EXEC_MAX_SEGMENTS loadable segments. */
+static bool
+read_headers (struct file *file, struct exec_info *info)
+{
+  struct Elf32_Ehdr ehdr;
+  off_t file_ofs;
+  int i;
 
   /* Read and verify executable header. */
-  if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
+  if (file_read_at (file, &ehdr, sizeof ehdr, 0) != sizeof ehdr
       || memcmp (ehdr.e_ident, "\177ELF\1\1\1", 7)
       || ehdr.e_type != 2
       || ehdr.e_machine != 3
       || ehdr.e_version != 1
       || ehdr.e_phentsize != sizeof (struct Elf32_Phdr)
       || ehdr.e_phnum > 1024) 
-    {
-      printf ("load: %s: error loading executable\n", file_name);
-      goto done; 
-    }
+    return false;
+  info->entry = (void (*) (void)) ehdr.e_entry;
+  info->segment_cnt = 0;
 
   /* Read program headers. */
   file_ofs = ehdr.e_phoff;
@@ -416,11 +1144,9 @@ load (const char *file_name, void (**eip) (void), void **esp)
       struct Elf32_Phdr phdr;
 
       if (file_ofs < 0 || file_ofs > file_length (file))
-        goto done;
-      file_seek (file, file_ofs);
-
-      if (file_read (file, &phdr, sizeof phdr) != sizeof phdr)
-        goto done;
+        return false;
+      if (file_read_at (file, &phdr, sizeof phdr, file_ofs) != sizeof phdr)
+        return false;
       file_ofs += sizeof phdr;
       switch (phdr.p_type) 
         {
@@ -434,62 +1160,42 @@ load (const char *file_name, void (**eip) (void), void **esp)
         case PT_DYNAMIC:
         case PT_INTERP:
         case PT_SHLIB:
-          goto done;
+          return false;
         case PT_LOAD:
-          if (validate_segment (&phdr, file)) 
+          if (validate_segment (&phdr, file)
+              && info->segment_cnt < EXEC_MAX_SEGMENTS) 
             {
-              bool writable = (phdr.p_flags & PF_W) != 0;
-              uint32_t file_page = phdr.p_offset & ~PGMASK;
-              uint32_t mem_page = phdr.p_vaddr & ~PGMASK;
+              struct exec_segment *seg = &info->segments[info->segment_cnt++];
               uint32_t page_offset = phdr.p_vaddr & PGMASK;
-              uint32_t read_bytes, zero_bytes;
+
+              seg->ofs = phdr.p_offset & ~PGMASK;
+              seg->upage = (uint8_t *) (phdr.p_vaddr & ~PGMASK);
+              seg->writable = (phdr.p_flags & PF_W) != 0;
               if (phdr.p_filesz > 0)
                 {
                   /* Normal segment.
                      Read initial part from disk and zero the rest. */
-                  read_bytes = page_offset + phdr.p_filesz;
-                  zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)
-                                - read_bytes);
+                  seg->read_bytes = page_offset + phdr.p_filesz;
+                  seg->zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz,
+                                               PGSIZE)
+                                     - seg->read_bytes);
                 }
               else 
                 {
                   /* Entirely zero.
                      Don't read anything from disk. */
-                  read_bytes = 0;
-                  zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
+                  seg->read_bytes = 0;
+                  seg->zero_bytes = ROUND_UP (page_offset + phdr.p_memsz,
+                                              PGSIZE);
                 }
-              if (!load_segment (file, file_page, (void *) mem_page,
-                                 read_bytes, zero_bytes, writable))
-                goto done;
             }
           else
-            goto done;
+            return false;
           break;
         }
     }
-
-  /* Set up stack. */
-  if (!setup_stack (esp))
-    goto done;
-
-  /* Start address. */
-  *eip = (void (*) (void)) ehdr.e_entry;
-
-  /* Deny writes to file being executed */
-  file_deny_write (file);
-  thread_current ()->exec_file = file;
-
-  success = true;
-
- done:
-  /* We arrive here whether the load is successful or not. */
-  file_close (file);
-  return success;
+  return true;
 }
-
-/* load() helpers. */
-
-static bool install_page (void *upage, void *kpage, bool writable);
 
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
@@ -536,29 +1242,43 @@ validate_segment (const struct Elf32_Phdr *phdr, struct file *file)
   return true;
 }
 
-/* Loads a segment starting at offset OFS in FILE at address
-   UPAGE.  In total, READ_BYTES + ZERO_BYTES bytes of virtual
-   memory are initialized, as follows:
+/* Loads segment SEG of FILE.  In total, SEG->READ_BYTES +
+   SEG->ZERO_BYTES bytes of virtual memory are initialized at
+   SEG->UPAGE, as follows:
 
-        - READ_BYTES bytes at UPAGE must be read from FILE
-          starting at offset OFS.
+        - SEG->READ_BYTES bytes at SEG->UPAGE must be read from
+          FILE starting at offset SEG->OFS.
 
-        - ZERO_BYTES bytes at UPAGE + READ_BYTES must be zeroed.
+        - SEG->ZERO_BYTES bytes at SEG->UPAGE + SEG->READ_BYTES
+          must be zeroed.
 
    The pages initialized by this function must be writable by the
-   user process if WRITABLE is true, read-only otherwise.
+   user process if SEG->WRITABLE is true, read-only otherwise.
+   Pages of read-only segments are copied from the exec cache
+   when it has them.
+
+   With VM, the segment is only recorded here, and its pages are
+   read in by the page fault handler as they are accessed.
 
    Return true if successful, false if a memory allocation error
    or disk read error occurs. */
 static bool
-load_segment (struct file *file, off_t ofs, uint8_t *upage,
-              uint32_t read_bytes, uint32_t zero_bytes, bool writable) 
+load_segment (struct file *file, const struct exec_segment *seg) 
 {
-  ASSERT ((read_bytes + zero_bytes) % PGSIZE == 0);
-  ASSERT (pg_ofs (upage) == 0);
-  ASSERT (ofs % PGSIZE == 0);
+  ASSERT ((seg->read_bytes + seg->zero_bytes) % PGSIZE == 0);
+  ASSERT (pg_ofs (seg->upage) == 0);
+  ASSERT (seg->ofs % PGSIZE == 0);
+
+#ifdef VM
+  /* Pages are read in when they are first accessed. */
+  return page_add_region (file, seg->ofs, seg->upage, seg->read_bytes,
+                          seg->zero_bytes, seg->writable);
+#else
+  uint32_t read_bytes = seg->read_bytes;
+  uint32_t zero_bytes = seg->zero_bytes;
+  uint8_t *upage = seg->upage;
+  off_t ofs = seg->ofs;
 
-  file_seek (file, ofs);
   while (read_bytes > 0 || zero_bytes > 0) 
     {
       /* Calculate how to fill this page.
@@ -566,33 +1286,42 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
          and zero the final PAGE_ZERO_BYTES bytes. */
       size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
       size_t page_zero_bytes = PGSIZE - page_read_bytes;
+      uint8_t *kpage;
+      bool cached;
 
       /* Get a page of memory. */
-      uint8_t *kpage = palloc_get_page (PAL_USER);
+      kpage = user_page_alloc (0);
       if (kpage == NULL)
         return false;
 
       /* Load this page. */
-      if (file_read (file, kpage, page_read_bytes) != (int) page_read_bytes)
+      cached = (!seg->writable && page_read_bytes > 0
+                && exec_cache_read (file_get_inode (file), ofs, kpage,
+                                    page_read_bytes));
+      if (!cached
+          && file_read_at (file, kpage, page_read_bytes, ofs)
+             != (int) page_read_bytes)
         {
-          palloc_free_page (kpage);
+          user_page_free (kpage);
           return false; 
         }
       memset (kpage + page_read_bytes, 0, page_zero_bytes);
 
       /* Add the page to the process's address space. */
-      if (!install_page (upage, kpage, writable)) 
+      if (!install_page (upage, kpage, seg->writable)) 
         {
-          palloc_free_page (kpage);
+          user_page_free (kpage);
           return false; 
         }
 
       /* Advance. */
       read_bytes -= page_read_bytes;
       zero_bytes -= page_zero_bytes;
+      ofs += PGSIZE;
       upage += PGSIZE;
     }
   return true;
+#endif
 }
 
 /* Create a minimal stack by mapping a zeroed page at the top of
@@ -603,18 +1332,48 @@ setup_stack (void **esp)
   uint8_t *kpage;
   bool success = false;
 
-  kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+  kpage = user_page_alloc (PAL_ZERO);
   if (kpage != NULL) 
     {
-      success = install_page (((uint8_t *) PHYS_BASE) - PGSIZE, kpage, true);
+      uint8_t *upage = ((uint8_t *) PHYS_BASE) - PGSIZE;
+
+      success = install_page (upage, kpage, true);
       if (success)
-        *esp = PHYS_BASE;
+        {
+#ifdef VM
+          frame_own (kpage, upage);
+#endif
+          *esp = PHYS_BASE;
+        }
       else
-        palloc_free_page (kpage);
+        user_page_free (kpage);
     }
   return success;
 }
 
+/* Obtains a page of user memory, zeroed if FLAGS contains
+   PAL_ZERO.  With VM the page is tracked by the frame table. */
+static void *
+user_page_alloc (enum palloc_flags flags)
+{
+#ifdef VM
+  return frame_alloc (flags);
+#else
+  return palloc_get_page (PAL_USER | flags);
+#endif
+}
+
+/* Frees KPAGE, obtained from user_page_alloc(). */
+static void
+user_page_free (void *kpage)
+{
+#ifdef VM
+  frame_free (kpage);
+#else
+  palloc_free_page (kpage);
+#endif
+}
+
 /* Adds a mapping from user virtual address UPAGE to kernel
    virtual address KPAGE to the page table.
    If WRITABLE is true, the user process may modify the page;
@@ -631,8 +1390,11 @@ install_page (void *upage, void *kpage, bool writable)
 
   /* Verify that there's not already a page at that virtual
      address, then map our page there. */
-  return (pagedir_get_page (t->pagedir, upage) == NULL
-          && pagedir_set_page (t->pagedir, upage, kpage, writable));
+  if (pagedir_get_page (t->pagedir, upage) != NULL
+      || !pagedir_set_page (t->pagedir, upage, kpage, writable))
+    return false;
+  process_add_resident (t, 1);
+  return true;
 }
 
 static void 
@@ -1,39 +1,48 @@
 #ifndef USERPROG_PROCESS_H
 #define USERPROG_PROCESS_H
 
+#include <hash.h>
+#include <list.h>
 #include "threads/thread.h"
 #include "threads/synch.h"
 
 typedef int pid_t;
 
 #define PID_ERROR ((pid_t) -1)
-#define PID_INIT ((pid_t) -2)
 
-/* pcb struct */
+/* process record, see "Process table" in process.c */
 struct process {
-  pid_t pid;                      /* process id */
-  const char* cmdline;            /* cmdline of process bein executed */
-
-  struct thread *parent_thread;   /* parent thread */    
-  bool waiting;                                   
-  bool exited;
-  bool orphan;                    /* parent thread has terminated before */
-  int32_t exitcode;               /* exitcode passed through exit ()*/
-  
-  struct semaphore sema_init;     /* sema between start_process () and process_execute ()*/
-  struct semaphore sema_wait;     /* sema for wait () */
+  struct hash_elem hash_elem;     /* element in the process table */
+  struct list_elem child_elem;    /* element of parent's children list */
+  pid_t pid;                      /* process id, the main thread's tid */
+  pid_t parent;                   /* parent's pid, PID_ERROR once it lets go */
+  bool exited;                    /* has the process exited? */
+  bool waited;                    /* has the parent called wait () on it? */
+  int32_t exitcode;               /* exitcode passed through exit () */
+  struct condition exited_cond;   /* signaled when the process exits */
 };
 
-struct file_desc {
-  struct list_elem elem;
-  int id;
-  struct file* file;
-  struct dir* dir;
-};
+struct intr_frame;
+struct rusage;
+
+/* Print memory and fault counts when a process exits?
+   Controlled by kernel command-line option "-rusage". */
+extern bool process_show_rusage;
 
-tid_t process_execute (const char *file_name);
+void process_init (void);
+pid_t process_execute (const char *cmd);
+#ifdef VM
+pid_t process_fork (const struct intr_frame *);
+#endif
 int process_wait (pid_t);
 void process_exit (void);
 void process_activate (void);
+void process_add_resident (struct thread *, int delta);
+struct thread *process_leader (struct thread *);
+tid_t process_thread_create (void (*start) (void *), void *arg, void *stack);
+int process_thread_join (tid_t);
+void process_set_exit (int status);
+bool process_is_dying (void);
+void process_get_rusage (struct thread *, struct rusage *);
 
 #endif /* userprog/process.h */
@@ -0,0 +1,365 @@
+#include "userprog/shm.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
+
+/* Shared memory segments.
+
+   A segment is a run of zeroed pages from the user pool that any
+   number of processes can map into their address spaces, so that
+   they exchange data at memory speed instead of through a file.
+   shm_create() allocates one and names it by a small integer,
+   which the creator passes to the processes it starts, and
+   shm_attach() maps it, read/write, into the calling process at
+   an address of the kernel's choosing within a window set aside
+   for the purpose.  The pages are mapped with PTE_KERN, like the
+   vDSO's, so that the frame table never evicts them and
+   pagedir_destroy() and pagedir_fork() leave them alone: a
+   segment's pages belong to the segment, not to any process, and
+   a child made by fork() does not inherit its parent's
+   attachments.
+
+   A segment lives as long as the process that created it or any
+   process attached to it: it is freed once its creator has exited
+   and the last process attached to it has detached or exited.
+
+   The threads of a process share its attachments, which are kept
+   by its main thread, and shm_lock also keeps two of them from
+   changing the attachments at once. */
+
+/* The window of user virtual addresses where segments are
+   attached: well above where executables are loaded and far
+   below the stack. */
+#define SHM_BASE ((uint8_t *) 0x10000000)
+#define SHM_END ((uint8_t *) 0x20000000)
+
+/* Maximum size of a segment, in pages. */
+#define SHM_MAX_PAGES 1024
+
+/* A shared memory segment. */
+struct shm_segment
+  {
+    struct list_elem elem;      /* Element in `segments'. */
+    int id;                     /* Identifier. */
+    size_t page_cnt;            /* Number of pages. */
+    void **pages;               /* Kernel addresses of the pages. */
+    int attach_cnt;             /* Number of attachments. */
+    tid_t owner;                /* Creator, or TID_ERROR once it exits. */
+  };
+
+/* A segment attached to a process.  Each process keeps its own
+   in a list sorted by address, starting at its thread's `shm'
+   member. */
+struct shm_mapping
+  {
+    struct shm_mapping *next;   /* Next mapping at a higher address. */
+    struct shm_segment *seg;    /* Segment mapped. */
+    uint8_t *start;             /* User address of first page. */
+  };
+
+/* All segments. */
+static struct list segments;
+
+/* Protects `segments', the segments in it, and the processes'
+   lists of mappings. */
+static struct lock shm_lock;
+
+/* Identifier for the next segment. */
+static int next_id;
+
+static struct shm_segment *find_segment (int id);
+static uint8_t *find_space (size_t page_cnt);
+static bool range_is_free (uint32_t *pd, const uint8_t *start,
+                           size_t page_cnt);
+static void unmap (struct shm_mapping *);
+static void put_segment (struct shm_segment *);
+static void free_segment (struct shm_segment *);
+
+/* Initializes shared memory segments. */
+void
+shm_init (void)
+{
+  list_init (&segments);
+  lock_init (&shm_lock);
+}
+
+/* Creates a segment of SIZE bytes, rounded up to whole pages,
+   and returns its identifier.  The running process owns it until
+   it exits.  Returns -1 if SIZE is 0 or too big or if memory is
+   exhausted. */
+int
+shm_create (size_t size)
+{
+  struct shm_segment *seg;
+  size_t i;
+
+  if (size == 0 || size > SHM_MAX_PAGES * PGSIZE)
+    return -1;
+
+  seg = malloc (sizeof *seg);
+  if (seg == NULL)
+    return -1;
+  seg->page_cnt = DIV_ROUND_UP (size, PGSIZE);
+  seg->pages = calloc (seg->page_cnt, sizeof *seg->pages);
+  seg->attach_cnt = 0;
+  seg->owner = process_leader (thread_current ())->tid;
+  if (seg->pages == NULL)
+    {
+      free (seg);
+      return -1;
+    }
+  for (i = 0; i < seg->page_cnt; i++)
+    {
+      seg->pages[i] = palloc_get_page (PAL_USER | PAL_ZERO);
+      if (seg->pages[i] == NULL)
+        {
+          free_segment (seg);
+          return -1;
+        }
+    }
+
+  lock_acquire (&shm_lock);
+  seg->id = next_id++;
+  list_push_back (&segments, &seg->elem);
+  lock_release (&shm_lock);
+
+  return seg->id;
+}
+
+/* Maps segment ID into the running process and returns the user
+   address of its first byte.  Returns a null pointer if there is
+   no such segment, if there is no room for it in the process's
+   window, or if memory is exhausted.  A process may attach the
+   same segment more than once, at different addresses. */
+void *
+shm_attach (int id)
+{
+  struct thread *leader = process_leader (thread_current ());
+  struct shm_mapping *m, **prev;
+  struct shm_segment *seg;
+  size_t i;
+
+  m = malloc (sizeof *m);
+  if (m == NULL)
+    return NULL;
+
+  lock_acquire (&shm_lock);
+  seg = find_segment (id);
+  if (seg == NULL)
+    goto error;
+  m->seg = seg;
+  m->start = find_space (seg->page_cnt);
+  if (m->start == NULL)
+    goto error;
+  for (i = 0; i < seg->page_cnt; i++)
+    if (!pagedir_set_kernel_page (leader->pagedir, m->start + i * PGSIZE,
+                                  seg->pages[i], true))
+      {
+        while (i-- > 0)
+          pagedir_clear_page (leader->pagedir, m->start + i * PGSIZE);
+        goto error;
+      }
+
+  seg->attach_cnt++;
+  for (prev = &leader->shm; *prev != NULL && (*prev)->start < m->start;
+       prev = &(*prev)->next)
+    continue;
+  m->next = *prev;
+  *prev = m;
+  lock_release (&shm_lock);
+  return m->start;
+
+ error:
+  lock_release (&shm_lock);
+  free (m);
+  return NULL;
+}
+
+/* Detaches the segment attached at user address ADDR from the
+   running process.  Returns false if no segment is attached
+   there. */
+bool
+shm_detach (void *addr)
+{
+  struct shm_mapping *m = NULL, **prev;
+
+  lock_acquire (&shm_lock);
+  for (prev = &process_leader (thread_current ())->shm; *prev != NULL;
+       prev = &(*prev)->next)
+    if ((*prev)->start == addr)
+      {
+        m = *prev;
+        *prev = m->next;
+        unmap (m);
+        break;
+      }
+  lock_release (&shm_lock);
+
+  if (m == NULL)
+    return false;
+  put_segment (m->seg);
+  free (m);
+  return true;
+}
+
+/* Detaches every segment from the running process and gives up
+   the segments it created.  Called by process_exit() in the
+   process's main thread, after its other threads are gone. */
+void
+shm_exit (void)
+{
+  struct thread *cur = thread_current ();
+  struct list_elem *e, *next;
+  struct list orphans;
+
+  while (cur->shm != NULL)
+    {
+      struct shm_mapping *m = cur->shm;
+
+      cur->shm = m->next;
+      if (cur->pagedir != NULL)
+        unmap (m);
+      put_segment (m->seg);
+      free (m);
+    }
+
+  list_init (&orphans);
+  lock_acquire (&shm_lock);
+  for (e = list_begin (&segments); e != list_end (&segments); e = next)
+    {
+      struct shm_segment *seg = list_entry (e, struct shm_segment, elem);
+
+      next = list_next (e);
+      if (seg->owner == cur->tid)
+        {
+          seg->owner = TID_ERROR;
+          if (seg->attach_cnt == 0)
+            {
+              list_remove (e);
+              list_push_back (&orphans, e);
+            }
+        }
+    }
+  lock_release (&shm_lock);
+
+  while (!list_empty (&orphans))
+    free_segment (list_entry (list_pop_front (&orphans),
+                              struct shm_segment, elem));
+}
+
+/* Returns the segment with identifier ID, or a null pointer if
+   there is none.  The caller must hold shm_lock. */
+static struct shm_segment *
+find_segment (int id)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&segments); e != list_end (&segments);
+       e = list_next (e))
+    {
+      struct shm_segment *seg = list_entry (e, struct shm_segment, elem);
+      if (seg->id == id)
+        return seg;
+    }
+  return NULL;
+}
+
+/* Returns the lowest address in the running process's window
+   with PAGE_CNT free pages, or a null pointer if there is none.
+   The caller must hold shm_lock. */
+static uint8_t *
+find_space (size_t page_cnt)
+{
+  struct thread *cur = process_leader (thread_current ());
+  size_t size = page_cnt * PGSIZE;
+  uint8_t *start = SHM_BASE;
+  struct shm_mapping *m;
+
+  for (m = cur->shm; m != NULL; m = m->next)
+    {
+      if (m->start - start >= (ptrdiff_t) size
+          && range_is_free (cur->pagedir, start, page_cnt))
+        return start;
+      start = m->start + m->seg->page_cnt * PGSIZE;
+    }
+  if (SHM_END - start >= (ptrdiff_t) size
+      && range_is_free (cur->pagedir, start, page_cnt))
+    return start;
+  return NULL;
+}
+
+/* Returns true if none of the PAGE_CNT pages starting at START
+   are in use in PD: mapped, swapped out, or part of a region that
+   has yet to be faulted in. */
+static bool
+range_is_free (uint32_t *pd, const uint8_t *start, size_t page_cnt)
+{
+  size_t i;
+
+  for (i = 0; i < page_cnt; i++)
+    {
+      const uint8_t *upage = start + i * PGSIZE;
+#ifdef VM
+      size_t slot;
+
+      if (pagedir_get_swap (pd, upage, &slot) || page_in_region (upage))
+        return false;
+#endif
+      if (pagedir_get_page (pd, upage) != NULL)
+        return false;
+    }
+  return true;
+}
+
+/* Removes mapping M from the running process's page directory. */
+static void
+unmap (struct shm_mapping *m)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  size_t i;
+
+  for (i = 0; i < m->seg->page_cnt; i++)
+    pagedir_clear_page (pd, m->start + i * PGSIZE);
+}
+
+/* Drops an attachment to SEG, and frees SEG if that was the last
+   one and its creator has exited. */
+static void
+put_segment (struct shm_segment *seg)
+{
+  bool dead;
+
+  lock_acquire (&shm_lock);
+  seg->attach_cnt--;
+  dead = seg->attach_cnt == 0 && seg->owner == TID_ERROR;
+  if (dead)
+    list_remove (&seg->elem);
+  lock_release (&shm_lock);
+
+  if (dead)
+    free_segment (seg);
+}
+
+/* Frees SEG and its pages.  SEG must not be in `segments'. */
+static void
+free_segment (struct shm_segment *seg)
+{
+  size_t i;
+
+  for (i = 0; i < seg->page_cnt; i++)
+    if (seg->pages[i] != NULL)
+      palloc_free_page (seg->pages[i]);
+  free (seg->pages);
+  free (seg);
+}
@@ -0,0 +1,13 @@
+#ifndef USERPROG_SHM_H
+#define USERPROG_SHM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+void shm_init (void);
+int shm_create (size_t size);
+void *shm_attach (int id);
+bool shm_detach (void *addr);
+void shm_exit (void);
+
+#endif /* userprog/shm.h */
@@ -1,30 +1,50 @@
 #include "userprog/syscall.h"
 #include "userprog/process.h"
+#include <batch.h>
+#include <limits.h>
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
+#include <uio.h>
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
+#include "userprog/aio.h"
+#include "userprog/fdtable.h"
+#include "userprog/futex.h"
+#include "userprog/gdt.h"
+#include "userprog/shm.h"
+#include "userprog/tss.h"
+#include "userprog/uaccess.h"
+#include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "devices/input.h"
 #include "devices/shutdown.h"
 
-/* mem access helper functions */
-static void check_user (const uint8_t *);
-static int get_user (const uint8_t *);
-static bool put_user (uint8_t *udst, uint8_t byte);
-static int memread_user (void *src, void *dst, size_t bytes); 
+/* user memory access helper functions */
+static void copy_in (void *dst, const void *usrc, size_t size);
+static void copy_out (void *udst, const void *src, size_t size);
+static bool copy_in_name (char *dst, const char *uname);
+static bool copy_in_iovec (struct iovec *dst, const struct iovec *uiov,
+                           int iovcnt);
+static char *copy_in_string (const char *ustr);
+static uint8_t *syscall_buffer (void);
 static void fail_invalid_access (void);
 
 /* syscall helper functions */
 static void syscall_handler (struct intr_frame *);
+void sysenter_entry (void);
+static uint32_t syscall_dispatch (int syscall_num, const uint32_t *args,
+                                  struct intr_frame *f);
+static bool syscall_failed (int syscall_num, uint32_t result);
 static void sys_halt (void);
 /*void sys_exit (int); */ /* extern funtion */
 static pid_t sys_exec (const char *cmdline);
 static int sys_wait (pid_t pid);
-static struct file_desc *sys_find_fd (int fd);
+static pid_t sys_fork (struct intr_frame *f);
 static struct file *sys_find_file (int fd);
 static bool sys_create(const char* filename, unsigned initial_size);
 static bool sys_remove(const char* filename);
@@ -32,60 +52,147 @@ static int sys_open(const char* filename);
 static int sys_filesize(int fd);
 static int sys_read(int fd, void *buffer, unsigned size);
 static int sys_write(int fd, const void *buffer, unsigned size);
+static int sys_rw (int fd, const struct iovec *iov, int iovcnt, off_t pos,
+                   bool write);
+static int sys_readv (int fd, const struct iovec *uiov, int iovcnt);
+static int sys_writev (int fd, const struct iovec *uiov, int iovcnt);
+static int sys_pread (int fd, void *buffer, unsigned size, unsigned offset);
+static int sys_pwrite (int fd, const void *buffer, unsigned size,
+                       unsigned offset);
+static int sys_rw_pipe (struct file *file, const struct iovec *iov,
+                        int iovcnt, uint8_t *buf, bool write,
+                        bool *faulted);
+static int sys_copy_file_range (int in_fd, int out_fd, unsigned size);
+static bool sys_pipe (int *ufds);
+static int sys_dup2 (int old_fd, int new_fd);
+static void sys_thread_exit (void) NO_RETURN;
 static void sys_seek(int fd, unsigned position);
 static unsigned sys_tell(int fd);
 static void sys_close(int fd);
+static bool sys_getrusage (struct rusage *usage);
+static int sys_batch (struct syscall_rec *urecs, unsigned cnt, unsigned flags,
+                      struct intr_frame *f);
+
+/* Most arguments any system call takes. */
+#define SYSCALL_MAX_ARGS 4
+
+/* Number of 32-bit arguments each system call takes, so that the
+ * handler can fetch them all with one copy_from_user (). */
+static const uint8_t syscall_argc[] = {
+  [SYS_HALT] = 0,     [SYS_EXIT] = 1,     [SYS_EXEC] = 1,
+  [SYS_WAIT] = 1,     [SYS_CREATE] = 2,   [SYS_REMOVE] = 1,
+  [SYS_OPEN] = 1,     [SYS_FILESIZE] = 1, [SYS_READ] = 3,
+  [SYS_WRITE] = 3,    [SYS_SEEK] = 2,     [SYS_TELL] = 1,
+  [SYS_CLOSE] = 1,    [SYS_FORK] = 0,     [SYS_GETRUSAGE] = 1,
+  [SYS_READV] = 3,    [SYS_WRITEV] = 3,   [SYS_PREAD] = 4,
+  [SYS_PWRITE] = 4,   [SYS_COPY_FILE_RANGE] = 3,
+  [SYS_AIO_SETUP] = 1, [SYS_AIO_ENTER] = 1, [SYS_BATCH] = 3,
+  [SYS_PIPE] = 1,     [SYS_DUP2] = 2,     [SYS_SHM_CREATE] = 1,
+  [SYS_SHM_ATTACH] = 1, [SYS_SHM_DETACH] = 1, [SYS_THREAD_CREATE] = 3,
+  [SYS_THREAD_EXIT] = 0, [SYS_THREAD_JOIN] = 1, [SYS_FUTEX_WAIT] = 2,
+  [SYS_FUTEX_WAKE] = 2,
+};
+#define SYSCALL_CNT (sizeof syscall_argc / sizeof *syscall_argc)
+
+/* System calls that return a bool, and so fail by returning
+ * false rather than -1. */
+static const bool syscall_returns_bool[SYSCALL_CNT] = {
+  [SYS_CREATE] = true, [SYS_REMOVE] = true, [SYS_GETRUSAGE] = true,
+  [SYS_AIO_SETUP] = true, [SYS_PIPE] = true, [SYS_SHM_DETACH] = true,
+};
+
+/* Records batch () copies in at a time. */
+#define BATCH_CHUNK 8
+
+/* user memory access helper functions */
+/* Copies SIZE bytes from user USRC to kernel DST, killing the
+ * process if USRC is not valid user memory. */
+static void
+copy_in (void *dst, const void *usrc, size_t size) {/*{{{*/
+  if (copy_from_user (dst, usrc, size) != 0) {
+    fail_invalid_access ();
+  }
+}/*}}}*/
 
-struct lock filesys_lock; /* file system has no internal synch for now */
-  
-/* memeory access helper functions */
-/* Reads a byte at user virtual address UADDR.
- * UADDR must be below PHYS_BASE.
- * Returns the byte value if successful, -1 if a segfault
- * occurred. */
-
+/* Copies SIZE bytes from kernel SRC to user UDST, killing the
+ * process if UDST is not valid user memory. */
 static void
-check_user (const uint8_t *uaddr) {/*{{{*/
-  if ((void *)uaddr < PHYS_BASE) {
+copy_out (void *udst, const void *src, size_t size) {/*{{{*/
+  if (copy_to_user (udst, src, size) != 0) {
     fail_invalid_access ();
   }
 }/*}}}*/
 
-static int
-get_user (const uint8_t *uaddr) {/*{{{*/
-  int result;
-  asm ("movl $1f, %0; movzbl %1, %0; 1:"
-       : "=&a" (result) : "m" (*uaddr));
-  return result;
-}/*}}}*/
- 
-/* Writes BYTE to user address UDST.
- * UDST must be below PHYS_BASE.
- * Returns true if successful, false if a segfault occurred. */
+/* Copies file name UNAME into DST, which has room for
+ * NAME_MAX + 1 bytes.  Returns false if the name is too long to
+ * be a file name, killing the process if it is not valid user
+ * memory. */
 static bool
-put_user (uint8_t *udst, uint8_t byte) {/*{{{*/
-  int error_code;
-  asm ("movl $1f, %0; movb %b2, %1; 1:"
-       : "=&a" (error_code), "=m" (*udst) : "q" (byte));
-  return error_code != -1;
+copy_in_name (char *dst, const char *uname) {/*{{{*/
+  int len = strncpy_from_user (dst, uname, NAME_MAX + 1);
+  if (len < 0) {
+    fail_invalid_access ();
+  }
+  return len <= NAME_MAX;
 }/*}}}*/
 
-static int 
-memread_user (void *src, void *dst, size_t bytes) {/*{{{*/
-  int32_t val;
-  for (size_t i = 0; i < bytes; i++) {
-    check_user (src + i);
-    val = get_user (src + i);  
-    *( (char *)(dst + i) ) = val & 0xff;
+/* Copies the IOVCNT buffer descriptors at user UIOV into DST,
+ * which has room for IOV_MAX of them.  Returns false if IOVCNT is
+ * out of range or the buffers add up to more bytes than one call
+ * can report, killing the process if UIOV is not valid user
+ * memory. */
+static bool
+copy_in_iovec (struct iovec *dst, const struct iovec *uiov, int iovcnt) {/*{{{*/
+  size_t total = 0;
+
+  if (iovcnt < 0 || iovcnt > IOV_MAX) {
+    return false;
   }
-  return bytes;
+  copy_in (dst, uiov, iovcnt * sizeof *dst);
+  for (int i = 0; i < iovcnt; i++) {
+    if (dst[i].iov_len > (size_t) INT_MAX - total) {
+      return false;
+    }
+    total += dst[i].iov_len;
+  }
+  return true;
+}/*}}}*/
+
+/* Copies the user string USTR into a newly allocated page, which
+ * the caller must free.  Strings longer than a page are cut
+ * short.  Returns a null pointer if memory is exhausted, killing
+ * the process if USTR is not valid user memory. */
+static char *
+copy_in_string (const char *ustr) {/*{{{*/
+  char *kstr = palloc_get_page (0);
+  if (!kstr) {
+    return NULL;
+  }
+  int len = strncpy_from_user (kstr, ustr, PGSIZE);
+  if (len < 0) {
+    palloc_free_page (kstr);
+    fail_invalid_access ();
+  }
+  if (len == PGSIZE) {
+    kstr[PGSIZE - 1] = '\0';
+  }
+  return kstr;
+}/*}}}*/
+
+/* Returns the process's page for moving data between files and
+ * user memory, allocating it on first use, or a null pointer if
+ * memory is exhausted.  Freed in process_exit (). */
+static uint8_t *
+syscall_buffer (void) {/*{{{*/
+  struct thread *cur_t = thread_current ();
+  if (!cur_t->syscall_buf) {
+    cur_t->syscall_buf = palloc_get_page (0);
+  }
+  return cur_t->syscall_buf;
 }/*}}}*/
 
 static void 
 fail_invalid_access (void) {/*{{{*/
-  if (lock_held_by_current_thread (&filesys_lock)) {
-    lock_release (&filesys_lock);
-  }
   sys_exit (-1);
   NOT_REACHED ();
 }/*}}}*/
@@ -100,24 +207,23 @@ void
 sys_exit (int status) {/*{{{*/
   /* cleaning up are through process_exit () in thread_exit ()*/
   /* including close files, handle child processes, semaphore up */
-  struct thread *cur_t = thread_current ();      
-  /* user program should have proc not freed at this point */
-  ASSERT (cur_t->proc != NULL);
-  (cur_t->proc)->exitcode = status;
+  /* the whole process exits, whichever of its threads we are */
+  process_set_exit (status);
   
   thread_exit ();  
 }/*}}}*/
 
 static pid_t 
 sys_exec (const char *cmdline) {/*{{{*/
-  /*cmdline passed in is an address in user memory
-   *need to check */
-  check_user ((const uint8_t *) cmdline);
+  /*cmdline passed in is an address in user memory */
+  char *kcmdline = copy_in_string (cmdline);
+  if (!kcmdline) {
+    return PID_ERROR;
+  }
 
-  lock_acquire (&filesys_lock); /* load uses file system */
-  pid_t pid = process_execute (cmdline);  
-  lock_release (&filesys_lock);
+  pid_t pid = process_execute (kcmdline);  
 
+  palloc_free_page (kcmdline);
   return pid;
 }/*}}}*/
 
@@ -126,197 +232,533 @@ sys_wait (pid_t pid) {/*{{{*/
  return process_wait (pid);
 }/*}}}*/
 
+static pid_t 
+sys_fork (struct intr_frame *f) {/*{{{*/
+#ifdef VM
+  pid_t pid = process_fork (f);
+
+  return pid;
+#else
+  /* fork() needs the frame table's copy-on-write sharing. */
+  (void) f;
+  return PID_ERROR;
+#endif
+}/*}}}*/
+
 static bool 
 sys_create(const char* filename, unsigned initial_size) {/*{{{*/
-  check_user ((const uint8_t *) filename);
+  char name[NAME_MAX + 1];
+  if (!copy_in_name (name, filename)) {
+    return false;
+  }
 
-  lock_acquire (&filesys_lock);
-  bool success = filesys_create (filename, initial_size);
-  lock_release (&filesys_lock);
+  bool success = filesys_create (name, initial_size);
 
   return success;
 }/*}}}*/
 
 static bool 
 sys_remove(const char* filename) {/*{{{*/
-  check_user ((const uint8_t *) filename);
+  char name[NAME_MAX + 1];
+  if (!copy_in_name (name, filename)) {
+    return false;
+  }
 
-  lock_acquire (&filesys_lock);
-  bool success = filesys_remove (filename);
-  lock_release (&filesys_lock);
+  bool success = filesys_remove (name);
 
   return success;
 }/*}}}*/
 
 static int 
 sys_open(const char* filename) {/*{{{*/
-  check_user ((const uint8_t *) filename);
-
-  struct file *fp = NULL;
-  struct file_desc *fd = palloc_get_page (0);
-
-  if (!fd) {
+  char name[NAME_MAX + 1];
+  if (!copy_in_name (name, filename)) {
     return -1;
   }
 
-  lock_acquire (&filesys_lock);
-  fp = filesys_open (filename);
+  struct file *fp = filesys_open (name);
   if (!fp) {
-    palloc_free_page (fd);
-    lock_release (&filesys_lock);
     return -1;
   }
 
-  fd->file = fp;
-  fd->dir = NULL; /*TODO: file system improvement */
-
-  struct list *fd_list = &(thread_current ()->fd_list);
-  if (list_empty (fd_list)) {
-    fd->id = 3; /* 0, 1, 2 are reserved */
-  } else {
-    fd->id = (list_entry (list_back (fd_list), struct file_desc, elem)->id) + 1;
+  /* lowest free fd, 0, 1, 2 are reserved */
+  int fd = fd_install (thread_current ()->fd_table, fp);
+  if (fd < 0) {
+    file_close (fp);
   }
-  list_push_back (fd_list, &fd->elem);
-
-  lock_release (&filesys_lock);
-  return fd->id;  
-}/*}}}*/
 
-static struct file_desc *
-sys_find_fd (int fd) {/*{{{*/
-  struct list *fd_list = &(thread_current ()->fd_list);
-  for (struct list_elem *e = list_begin (fd_list);
-       e != list_end (fd_list); e = list_next (e)) {
-    struct file_desc *descriptor = list_entry (e, struct file_desc, elem);
-    if (fd != descriptor->id) continue;
-    return descriptor;  
-  }
-  return NULL;
+  return fd;  
 }/*}}}*/
 
+/* returns the file open as FD with a reference of its own, which
+ * the caller must drop with file_close (), since another thread
+ * may close FD meanwhile */
 static struct file *
 sys_find_file (int fd) {/*{{{*/
-  struct file_desc *descriptor = sys_find_fd (fd);
-  if (!descriptor) {
-    return descriptor->file;
-  }
-  return NULL;
+  return fd_get (thread_current ()->fd_table, fd);
 }/*}}}*/
 
 static int 
 sys_filesize(int fd) {/*{{{*/
   struct file *file = sys_find_file (fd);
+  int size = -1;
   
-  if (!file) {
-    return -1;
+  if (file && !file_is_pipe (file)) {
+    size = file_length (file);
   }
-  lock_acquire (&filesys_lock); 
-  int size = file_length (file);
-  lock_release (&filesys_lock); 
-
+  file_close (file);
   return size;
 }/*}}}*/
 
-static int 
-sys_read(int fd, void *buffer, unsigned size) {/*{{{*/
-  check_user ((const uint8_t *) buffer);
-  check_user ((const uint8_t *) buffer + size - 1);
-
-  lock_acquire (&filesys_lock);
-  if (fd == 0) {
-    for (unsigned i = 0; i < size; i++) {
-      if (!put_user (buffer + i, input_getc ())) {
-        lock_release (&filesys_lock);
-        sys_exit (-1); //fault
+/* Moves data between file FD and the user buffers IOV[0] through
+ * IOV[IOVCNT - 1] in order, going through the process's bounce
+ * page one page at a time so the file system never touches user
+ * memory.  Starts at file offset POS, or at the file's position
+ * if POS is -1, in which case the position stays locked for the
+ * whole call so that the buffers get one contiguous range of the
+ * file.  Stops early at end of file.  Standard input and output
+ * are the console unless redirected.  Returns the number of bytes
+ * moved or -1 on error. */
+static int
+sys_rw (int fd, const struct iovec *iov, int iovcnt, off_t pos,
+        bool write) {/*{{{*/
+  uint8_t *buf = syscall_buffer ();
+  struct file *file = NULL;
+  bool at_pos = pos < 0;
+  bool faulted = false;
+  unsigned done = 0;
+
+  if (!buf) {
+    return -1;
+  }
+  file = sys_find_file (fd);
+  if (file) {
+    if (file_is_pipe (file)) {
+      int ret = at_pos ? sys_rw_pipe (file, iov, iovcnt, buf, write,
+                                      &faulted) : -1;
+      file_close (file);
+      if (faulted) {
+        fail_invalid_access ();
+      }
+      return ret;
+    }
+    if (at_pos) {
+      pos = file_lock_pos (file);
+    }
+  } else if (fd != (write ? 1 : 0)) {
+    return -1;
+  } else if (!at_pos) {
+    return -1; /* the console has no offsets */
+  }
+
+  for (int i = 0; i < iovcnt && !faulted; i++) {
+    uint8_t *ubuf = iov[i].iov_base;
+    size_t size = iov[i].iov_len;
+    size_t ofs = 0;
+
+    while (ofs < size) {
+      unsigned chunk = size - ofs < PGSIZE ? size - ofs : PGSIZE;
+      unsigned n = chunk;
+      /* a fault must not kill the process with the position
+       * locked, since exiting closes the file */
+      if (write) {
+        if (copy_from_user (buf, ubuf + ofs, chunk) != 0) {
+          faulted = true;
+          break;
+        }
+        if (!file) {
+          putbuf ((const char *) buf, chunk);
+        } else {
+          n = file_write_at (file, buf, chunk, pos);
+        }
+      } else {
+        if (!file) {
+          /* stop short if the process starts exiting */
+          for (n = 0; n < chunk; n++) {
+            int key = input_getc_unless (process_is_dying,
+                                         process_leader (thread_current ()));
+            if (key < 0) {
+              break;
+            }
+            buf[n] = key;
+          }
+        } else {
+          n = file_read_at (file, buf, chunk, pos);
+        }
+        if (copy_to_user (ubuf + ofs, buf, n) != 0) {
+          faulted = true;
+          break;
+        }
+      }
+      ofs += n;
+      done += n;
+      pos += n;
+      if (n < chunk) {
+        goto out; /* end of file, which cannot grow */
       }
     }
-    return size;
   }
-  struct file *file = sys_find_file (fd);
-  int size_read = -1; 
-  if (file) {
-    size_read = file_read (file, buffer, size);
+
+out:
+  if (file && at_pos) {
+    file_unlock_pos (file, pos);
+  }
+  file_close (file);
+  if (faulted) {
+    fail_invalid_access ();
   }
-  lock_release (&filesys_lock);
-  return size_read;
+  return done;
+}/*}}}*/
+
+/* sys_rw () for a pipe, going through bounce page BUF.  A pipe
+ * has no position to lock, and reading or writing one may
+ * block.  A read returns as soon as it has read anything, so that
+ * it never waits for more data than the writer has sent.  A write
+ * fails with -1 if the read end is closed before anything has been
+ * written.  A bad user buffer sets *FAULTED and stops, leaving
+ * the caller to drop its reference to FILE before it kills us. */
+static int
+sys_rw_pipe (struct file *file, const struct iovec *iov, int iovcnt,
+             uint8_t *buf, bool write, bool *faulted) {/*{{{*/
+  int done = 0;
+
+  for (int i = 0; i < iovcnt; i++) {
+    uint8_t *ubuf = iov[i].iov_base;
+    size_t size = iov[i].iov_len;
+    size_t ofs = 0;
+
+    while (ofs < size) {
+      unsigned chunk = size - ofs < PGSIZE ? size - ofs : PGSIZE;
+      off_t n;
+      if (write) {
+        if (copy_from_user (buf, ubuf + ofs, chunk) != 0) {
+          *faulted = true;
+          return -1;
+        }
+        n = file_write (file, buf, chunk);
+      } else {
+        n = file_read (file, buf, chunk);
+        if (n > 0 && copy_to_user (ubuf + ofs, buf, n) != 0) {
+          *faulted = true;
+          return -1;
+        }
+      }
+      if (n < 0) {
+        return done > 0 ? done : -1;
+      }
+      ofs += n;
+      done += n;
+      if (!write || (unsigned) n < chunk) {
+        return done;
+      }
+    }
+  }
+  return done;
+}/*}}}*/
+
+static int 
+sys_read(int fd, void *buffer, unsigned size) {/*{{{*/
+  struct iovec iov = { buffer, size };
+  return sys_rw (fd, &iov, 1, -1, false);
 }/*}}}*/
 
 static int 
 sys_write(int fd, const void *buffer, unsigned size) {/*{{{*/
-  check_user ((const uint8_t *) buffer);
-  check_user ((const uint8_t *) buffer + size - 1);
+  struct iovec iov = { (void *) buffer, size };
+  return sys_rw (fd, &iov, 1, -1, true);
+}/*}}}*/
 
-  lock_acquire (&filesys_lock);
-  if (fd == 1) {
-    putbuf (buffer, size);  
-    return size;
+static int
+sys_readv (int fd, const struct iovec *uiov, int iovcnt) {/*{{{*/
+  struct iovec iov[IOV_MAX];
+  if (!copy_in_iovec (iov, uiov, iovcnt)) {
+    return -1;
   }
-  struct file *file = sys_find_file (fd);
-  int size_write = -1; 
-  if (file) {
-    size_write = file_write (file, buffer, size);
+  return sys_rw (fd, iov, iovcnt, -1, false);
+}/*}}}*/
+
+static int
+sys_writev (int fd, const struct iovec *uiov, int iovcnt) {/*{{{*/
+  struct iovec iov[IOV_MAX];
+  if (!copy_in_iovec (iov, uiov, iovcnt)) {
+    return -1;
+  }
+  return sys_rw (fd, iov, iovcnt, -1, true);
+}/*}}}*/
+
+/* pread () and pwrite () leave the file position alone */
+static int
+sys_pread (int fd, void *buffer, unsigned size, unsigned offset) {/*{{{*/
+  struct iovec iov = { buffer, size };
+  if ((off_t) offset < 0) {
+    return -1;
+  }
+  return sys_rw (fd, &iov, 1, offset, false);
+}/*}}}*/
+
+static int
+sys_pwrite (int fd, const void *buffer, unsigned size,
+            unsigned offset) {/*{{{*/
+  struct iovec iov = { (void *) buffer, size };
+  if ((off_t) offset < 0) {
+    return -1;
+  }
+  return sys_rw (fd, &iov, 1, offset, true);
+}/*}}}*/
+
+/* copies between two open files, or from a file to the console,
+ * through the bounce page without going through user memory;
+ * pipes have no positions to copy between, and a file cannot be
+ * copied onto an overlapping range of itself (see file_copy ()) */
+static int
+sys_copy_file_range (int in_fd, int out_fd, unsigned size) {/*{{{*/
+  uint8_t *buf = syscall_buffer ();
+  struct file *in = sys_find_file (in_fd);
+  struct file *out = sys_find_file (out_fd);
+  int done = -1;
+
+  if (size > INT_MAX) {
+    size = INT_MAX;
+  }
+  if (!buf || !in || file_is_pipe (in)) {
+    /* fail */
+  } else if (out) {
+    if (out != in && !file_is_pipe (out)) {
+      done = file_copy (out, in, size, buf, PGSIZE);
+    }
+  } else if (out_fd == 1) {
+    off_t pos = file_lock_pos (in);
+    done = 0;
+    while ((unsigned) done < size) {
+      unsigned chunk = size - done < PGSIZE ? size - done : PGSIZE;
+      unsigned n = file_read_at (in, buf, chunk, pos);
+      putbuf ((const char *) buf, n);
+      pos += n;
+      done += n;
+      if (n < chunk) break; /* end of file */
+    }
+    file_unlock_pos (in, pos);
   }
-  lock_release (&filesys_lock);
-  return size_write;
+  file_close (in);
+  file_close (out);
+  return done;
 }/*}}}*/
 
 static void 
 sys_seek(int fd, unsigned position) {/*{{{*/
-  lock_acquire (&filesys_lock);  
   struct file *file = sys_find_file (fd); 
 
   if (file) {
     file_seek (file, position);
+    file_close (file);
   }
   /* else error handling ? */
-  lock_release (&filesys_lock);  
 }/*}}}*/
 
 static unsigned 
 sys_tell(int fd) {/*{{{*/
-  lock_acquire (&filesys_lock);  
   struct file *file = sys_find_file (fd); 
   unsigned pos = 0;
 
   if (file) {
     pos = file_tell (file);
+    file_close (file);
   }
   /* else error handling ? */
-  lock_release (&filesys_lock);  
   return pos;
 }/*}}}*/
 
 static void 
 sys_close(int fd) {/*{{{*/
-  lock_acquire (&filesys_lock);  
-  struct file_desc *desc = sys_find_fd (fd); 
+  struct file *file = fd_remove (thread_current ()->fd_table, fd); 
   
-  if (desc && desc->file) {
-    file_close (desc->file);
+  if (file) {
+    file_close (file);
     /*TODO: handle directory */
-    list_remove (&desc->elem);
-    palloc_free_page (desc);
   }
-  lock_release (&filesys_lock);
+}/*}}}*/
+
+/* creates a pipe and stores the descriptors of its read and
+ * write ends in UFDS[0] and UFDS[1] */
+static bool
+sys_pipe (int *ufds) {/*{{{*/
+  struct fd_table *fds = thread_current ()->fd_table;
+  struct file *read_end, *write_end;
+  int kfds[2];
+
+  if (!file_open_pipe (&read_end, &write_end)) {
+    return false;
+  }
+  kfds[0] = fd_install (fds, read_end);
+  kfds[1] = kfds[0] >= 0 ? fd_install (fds, write_end) : -1;
+  if (kfds[1] < 0) {
+    if (kfds[0] >= 0) {
+      fd_remove (fds, kfds[0]);
+    }
+    file_close (read_end);
+    file_close (write_end);
+    return false;
+  }
+  /* a fault kills us, which closes both ends */
+  copy_out (ufds, kfds, sizeof kfds);
+  return true;
+}/*}}}*/
+
+/* makes NEW_FD refer to the same open file as OLD_FD, closing
+ * whatever NEW_FD referred to; this is how a parent hands a pipe
+ * to a child as its standard input or output before exec (),
+ * and closing 0 or 1 afterwards gives it back the console */
+static int
+sys_dup2 (int old_fd, int new_fd) {/*{{{*/
+  struct fd_table *fds = thread_current ()->fd_table;
+  struct file *file = sys_find_file (old_fd);
+  struct file *old;
+
+  if (!file || new_fd < 0) {
+    file_close (file);
+    return -1;
+  }
+  if (old_fd == new_fd) {
+    file_close (file);
+    return new_fd;
+  }
+  /* our reference to FILE becomes NEW_FD's */
+  if (!fd_replace (fds, new_fd, file, &old)) {
+    file_close (file);
+    return -1;
+  }
+  file_close (old);
+  return new_fd;
+}/*}}}*/
+
+/* ends the calling thread; in the main thread, which owns the
+ * process, this is exit (0) */
+static void
+sys_thread_exit (void) {/*{{{*/
+  struct thread *cur = thread_current ();
+
+  if (process_leader (cur) == cur)
+    sys_exit (0);
+  thread_exit ();
+}/*}}}*/
+
+static bool
+sys_getrusage (struct rusage *usage) {/*{{{*/
+  struct rusage ru;
+  process_get_rusage (process_leader (thread_current ()), &ru);
+  copy_out (usage, &ru, sizeof ru);
+  return true;
+}/*}}}*/
+
+/* Makes the CNT system calls described by the records at URECS
+ * in order, in a single trap, and stores each one's result in its
+ * record.  With BATCH_STOP_ON_ERROR in FLAGS, stops after the
+ * first call that fails.  Returns the number of calls made.
+ * fork () and batch () itself cannot be batched and fail. */
+static int
+sys_batch (struct syscall_rec *urecs, unsigned cnt, unsigned flags,
+           struct intr_frame *f) {/*{{{*/
+  struct syscall_rec recs[BATCH_CHUNK];
+  unsigned done = 0;
+  bool stop = false;
+
+  while (done < cnt && !stop) {
+    unsigned n = cnt - done < BATCH_CHUNK ? cnt - done : BATCH_CHUNK;
+    unsigned i;
+
+    copy_in (recs, urecs + done, n * sizeof *recs);
+    for (i = 0; i < n && !stop; i++) {
+      struct syscall_rec *rec = &recs[i];
+      /* another thread has ended the process: run no more records,
+       * as the trap path would not run another system call */
+      if (process_is_dying ()) {
+        thread_exit ();
+      }
+      if (rec->number < 0 || (size_t) rec->number >= SYSCALL_CNT
+          || rec->number == SYS_FORK || rec->number == SYS_BATCH) {
+        rec->result = -1;
+      } else {
+        rec->result = syscall_dispatch (rec->number, rec->args, f);
+      }
+      stop = (flags & BATCH_STOP_ON_ERROR)
+             && syscall_failed (rec->number, rec->result);
+    }
+    copy_out (urecs + done, recs, i * sizeof *recs);
+    done += i;
+  }
+  return done;
+}/*}}}*/
+
+/* Returns true if RESULT from system call SYSCALL_NUM means that
+ * the call failed. */
+static bool
+syscall_failed (int syscall_num, uint32_t result) {/*{{{*/
+  if (syscall_num >= 0 && (size_t) syscall_num < SYSCALL_CNT
+      && syscall_returns_bool[syscall_num]) {
+    return result == 0;
+  }
+  /* shm_attach () returns an address, null on failure */
+  if (syscall_num == SYS_SHM_ATTACH) {
+    return result == 0;
+  }
+  return (int) result == -1;
 }/*}}}*/
 
 void
 syscall_init (void) 
 {/*{{{*/
-  lock_init (&filesys_lock);
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
+  aio_init ();
+  futex_init ();
+
+  /* fast path, see userprog/sysenter.S; user programs check for
+   * SYSENTER the same way and fall back to int 0x30 */
+  if (cpu_has_sysenter ()) {
+    cpu_write_msr (MSR_SYSENTER_CS, SEL_KCSEG);
+    cpu_write_msr (MSR_SYSENTER_ESP, (uint32_t) tss_esp0 ());
+    cpu_write_msr (MSR_SYSENTER_EIP, (uint32_t) sysenter_entry);
+  }
 }/*}}}*/
 
 static void
-syscall_handler (struct intr_frame *f UNUSED) 
+syscall_handler (struct intr_frame *f) 
 {
-  printf ("system call!\n");
   int syscall_num;
+  uint32_t args[SYSCALL_MAX_ARGS];
   ASSERT (sizeof(syscall_num) == 4);
 
-  // The system call number is in the 32-bit word at the caller's stack pointer.
-  memread_user(f->esp, &syscall_num, sizeof(syscall_num));
+  /* page faults taken on the user's behalf need the user esp,
+   * e.g. to grow the stack into a buffer passed to read () */
+  thread_current ()->syscall_esp = f->esp;
+
+  /* another thread has ended the process: stop before blocking */
+  if (process_is_dying ()) {
+    thread_exit ();
+  }
+
+  // The system call number is in the 32-bit word at the caller's stack pointer,
+  // followed by its arguments.
+  copy_in (&syscall_num, f->esp, sizeof(syscall_num));
+  if (syscall_num < 0 || (size_t) syscall_num >= SYSCALL_CNT) {
+    printf ("[ERROR]: unimplemented system call: syscall_num=%0d\n", syscall_num);
+    sys_exit (-1);
+  }
+  copy_in (args, (uint32_t *) f->esp + 1, syscall_argc[syscall_num] * sizeof *args);
+
+  f->eax = syscall_dispatch (syscall_num, args, f);
 
+  /* or it did while we were in here */
+  if (process_is_dying ()) {
+    thread_exit ();
+  }
+}
+
+/* Carries out system call SYSCALL_NUM with arguments ARGS and
+ * returns its result.  F is the frame the process trapped with. */
+static uint32_t
+syscall_dispatch (int syscall_num, const uint32_t *args,
+                  struct intr_frame *f)
+{
   switch (syscall_num) {
   case SYS_HALT:                   /* Halt the operating system. */
   {
@@ -326,113 +768,178 @@ syscall_handler (struct intr_frame *f UNUSED)
   }
   case SYS_EXIT:                   /* Terminate this process. */
   {
-    int status;
-    memread_user (f->esp + 4, &status, sizeof(status));
-    sys_exit (status);
+    sys_exit ((int) args[0]);
     NOT_REACHED ();
     break;
   }
   case SYS_EXEC:                   /* Start another process. */
   {
-    char *cmdline;
-    memread_user (f->esp + 4, &cmdline, sizeof(cmdline));
-    pid_t ret = sys_exec ((const char *)cmdline);
-    f->eax = (uint32_t) ret;
-    break;
+    pid_t ret = sys_exec ((const char *) args[0]);
+    return (uint32_t) ret;
   }
   case SYS_WAIT:                   /* Wait for a child process to die. */
   {
-    pid_t pid;
-    memread_user (f->esp + 4, &pid, sizeof(pid));
-    int ret = sys_wait (pid);
-    f->eax = (uint32_t) ret;
-    break;
+    int ret = sys_wait ((pid_t) args[0]);
+    return (uint32_t) ret;
   }
   case SYS_CREATE:                 /* Create a file. */
   {
-    char *fn;
-    unsigned size;
-    memread_user (f->esp + 4, &fn, sizeof(fn));
-    memread_user (f->esp + 8, &size, sizeof(size));
-    bool ret = sys_create (fn, size);
-    f->eax = (uint32_t) ret;
-    break;
+    bool ret = sys_create ((const char *) args[0], (unsigned) args[1]);
+    return (uint32_t) ret;
   }
   case SYS_REMOVE:                 /* Delete a file. */
   {
-    char *fn;
-    memread_user (f->esp + 4, &fn, sizeof(fn));
-    bool ret = sys_remove (fn);
-    f->eax = (uint32_t) ret;
-    break;
+    bool ret = sys_remove ((const char *) args[0]);
+    return (uint32_t) ret;
   }
   case SYS_OPEN:                   /* Open a file. */
   {
-    char *fn;
-    memread_user (f->esp + 4, &fn, sizeof(fn));
-    int ret = sys_open (fn);
-    f->eax = (uint32_t) ret;
-    break;
+    int ret = sys_open ((const char *) args[0]);
+    return (uint32_t) ret;
   }
   case SYS_FILESIZE:               /* Obtain a file's size. */
   {
-    int fd;
-    memread_user (f->esp + 4, &fd, sizeof(fd));
-    int ret = sys_filesize (fd);
-    f->eax = (uint32_t) ret;
-    break;
+    int ret = sys_filesize ((int) args[0]);
+    return (uint32_t) ret;
   }
   case SYS_READ:                   /* Read from a file. */
   {
-    int fd;
-    void *buffer;
-    unsigned size;
-    memread_user (f->esp + 4, &fd, sizeof(fd));
-    memread_user (f->esp + 8, &buffer, sizeof(buffer));
-    memread_user (f->esp + 12, &size, sizeof(size));
-    int ret = sys_read (fd, buffer, size);
-    f->eax = (uint32_t) ret;
-    break;
+    int ret = sys_read ((int) args[0], (void *) args[1], (unsigned) args[2]);
+    return (uint32_t) ret;
   }
   case SYS_WRITE:                  /* Write to a file. */
   {
-    int fd;
-    void *buffer;
-    unsigned size;
-    memread_user (f->esp + 4, &fd, sizeof(fd));
-    memread_user (f->esp + 8, &buffer, sizeof(buffer));
-    memread_user (f->esp + 12, &size, sizeof(size));
-    int ret = sys_write (fd, buffer, size);
-    f->eax = (uint32_t) ret;
-    break;
+    int ret = sys_write ((int) args[0], (const void *) args[1],
+                         (unsigned) args[2]);
+    return (uint32_t) ret;
   }
   case SYS_SEEK:                   /* Change position in a file. */
   {
-    int fd;
-    unsigned pos;
-    memread_user (f->esp + 4, &fd, sizeof(fd));
-    memread_user (f->esp + 8, &pos, sizeof(pos));
-    sys_seek (fd, pos);
+    sys_seek ((int) args[0], (unsigned) args[1]);
     break;
   }
   case SYS_TELL:                   /* Report current position in a file. */
   {
-    int fd;
-    memread_user (f->esp + 4, &fd, sizeof(fd));
-    unsigned ret = sys_tell (fd);
-    f->eax = (uint32_t) ret;
-    break;
+    unsigned ret = sys_tell ((int) args[0]);
+    return (uint32_t) ret;
   }
   case SYS_CLOSE:                  /* Close a file. */
   {
-    int fd;
-    memread_user (f->esp + 4, &fd, sizeof(fd));
-    sys_close (fd);
+    sys_close ((int) args[0]);
     break;
   }
+  case SYS_FORK:                   /* Duplicate this process. */
+  {
+    pid_t ret = sys_fork (f);
+    return (uint32_t) ret;
+  }
+  case SYS_GETRUSAGE:              /* Report memory use and page faults. */
+  {
+    bool ret = sys_getrusage ((struct rusage *) args[0]);
+    return (uint32_t) ret;
+  }
+  case SYS_READV:                  /* Read from a file into several buffers. */
+  {
+    int ret = sys_readv ((int) args[0], (const struct iovec *) args[1],
+                         (int) args[2]);
+    return (uint32_t) ret;
+  }
+  case SYS_WRITEV:                 /* Write to a file from several buffers. */
+  {
+    int ret = sys_writev ((int) args[0], (const struct iovec *) args[1],
+                          (int) args[2]);
+    return (uint32_t) ret;
+  }
+  case SYS_PREAD:                  /* Read from a file at a given offset. */
+  {
+    int ret = sys_pread ((int) args[0], (void *) args[1], (unsigned) args[2],
+                         (unsigned) args[3]);
+    return (uint32_t) ret;
+  }
+  case SYS_PWRITE:                 /* Write to a file at a given offset. */
+  {
+    int ret = sys_pwrite ((int) args[0], (const void *) args[1],
+                          (unsigned) args[2], (unsigned) args[3]);
+    return (uint32_t) ret;
+  }
+  case SYS_COPY_FILE_RANGE:        /* Copy data from one file to another. */
+  {
+    int ret = sys_copy_file_range ((int) args[0], (int) args[1],
+                                   (unsigned) args[2]);
+    return (uint32_t) ret;
+  }
+  case SYS_AIO_SETUP:              /* Set up asynchronous I/O rings. */
+  {
+    bool ret = aio_setup ((struct aio_ring *) args[0]);
+    return (uint32_t) ret;
+  }
+  case SYS_AIO_ENTER:              /* Submit and complete asynchronous I/O. */
+  {
+    int ret = aio_enter ((unsigned) args[0]);
+    return (uint32_t) ret;
+  }
+  case SYS_BATCH:                  /* Make several system calls at once. */
+  {
+    int ret = sys_batch ((struct syscall_rec *) args[0], (unsigned) args[1],
+                         (unsigned) args[2], f);
+    return (uint32_t) ret;
+  }
+  case SYS_PIPE:                   /* Create a pipe. */
+  {
+    bool ret = sys_pipe ((int *) args[0]);
+    return (uint32_t) ret;
+  }
+  case SYS_DUP2:                   /* Duplicate a file descriptor. */
+  {
+    int ret = sys_dup2 ((int) args[0], (int) args[1]);
+    return (uint32_t) ret;
+  }
+  case SYS_SHM_CREATE:             /* Create a shared memory segment. */
+  {
+    int ret = shm_create ((size_t) args[0]);
+    return (uint32_t) ret;
+  }
+  case SYS_SHM_ATTACH:             /* Map a shared memory segment. */
+  {
+    void *ret = shm_attach ((int) args[0]);
+    return (uint32_t) ret;
+  }
+  case SYS_SHM_DETACH:             /* Unmap a shared memory segment. */
+  {
+    bool ret = shm_detach ((void *) args[0]);
+    return (uint32_t) ret;
+  }
+  case SYS_THREAD_CREATE:          /* Start a thread in this process. */
+  {
+    tid_t ret = process_thread_create ((void (*) (void *)) args[0],
+                                       (void *) args[1], (void *) args[2]);
+    return (uint32_t) ret;
+  }
+  case SYS_THREAD_EXIT:            /* Terminate this thread. */
+  {
+    sys_thread_exit ();
+    NOT_REACHED ();
+    break;
+  }
+  case SYS_THREAD_JOIN:            /* Wait for a thread to exit. */
+  {
+    int ret = process_thread_join ((tid_t) args[0]);
+    return (uint32_t) ret;
+  }
+  case SYS_FUTEX_WAIT:             /* Sleep on a futex. */
+  {
+    int ret = futex_wait ((int *) args[0], (int) args[1]);
+    return (uint32_t) ret;
+  }
+  case SYS_FUTEX_WAKE:             /* Wake threads sleeping on a futex. */
+  {
+    int ret = futex_wake ((int *) args[0], (int) args[1]);
+    return (uint32_t) ret;
+  }
   default:
     printf ("[ERROR]: unimplemented system call: syscall_num=%0d\n", syscall_num);
     sys_exit (-1);
     break;
   }
+  return 0;
 }
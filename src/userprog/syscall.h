@@ -1,8 +1,10 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include <debug.h>
+
 void syscall_init (void);
 
-void sys_exit (int); /* needed by other handlers, e.g. page fault */
+void sys_exit (int) NO_RETURN; /* needed by other handlers, e.g. page fault */
 
 #endif /* userprog/syscall.h */
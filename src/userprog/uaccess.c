@@ -0,0 +1,145 @@
+#include "userprog/uaccess.h"
+#include <debug.h>
+#include <stdint.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/vaddr.h"
+
+/* Copying to and from user memory.
+
+   The kernel may not trust a user pointer: it may be null, point
+   into the kernel, or point at pages that are not mapped.  Rather
+   than checking each page before touching it, the routines here
+   check only that the range lies below PHYS_BASE and then copy
+   the whole range with a single string instruction.  A page
+   fault on a user page is first handled as usual, which may page
+   it in.  If that fails, page_fault() calls uaccess_fixup(),
+   which looks the faulting instruction up in the exception
+   table, a list of (instruction, fixup) address pairs that the
+   copy routines place in the __ex_table section, and resumes at
+   the fixup code.  The fixup works out how many bytes were not
+   copied, so the caller sees a short copy instead of a kernel
+   panic. */
+
+/* An exception table entry. */
+struct ex_entry
+  {
+    uintptr_t insn;             /* Instruction that may fault. */
+    uintptr_t fixup;            /* Where to resume if it does. */
+  };
+
+/* Bounds of the exception table, from the linker script. */
+extern const struct ex_entry _start_ex_table[], _end_ex_table[];
+
+/* Emits an exception table entry for the instruction at label
+   INSN, resuming at label FIXUP. */
+#define EX_ENTRY(INSN, FIXUP)                           \
+        ".pushsection __ex_table, \"a\"\n"              \
+        ".long " INSN ", " FIXUP "\n"                   \
+        ".popsection\n"
+
+static size_t raw_copy (void *dst, const void *src, size_t size);
+
+/* Returns true if the SIZE bytes starting at UADDR all lie in
+   user virtual memory. */
+static inline bool
+is_user_range (const void *uaddr, size_t size)
+{
+  uintptr_t start = (uintptr_t) uaddr;
+  return start + size >= start && start + size <= (uintptr_t) PHYS_BASE;
+}
+
+/* Copies SIZE bytes from user address USRC to kernel address
+   DST.  Returns the number of bytes that could not be copied,
+   which is 0 on success. */
+size_t
+copy_from_user (void *dst, const void *usrc, size_t size)
+{
+  if (!is_user_range (usrc, size))
+    return size;
+  return raw_copy (dst, usrc, size);
+}
+
+/* Copies SIZE bytes from kernel address SRC to user address
+   UDST.  Returns the number of bytes that could not be copied,
+   which is 0 on success. */
+size_t
+copy_to_user (void *udst, const void *src, size_t size)
+{
+  if (!is_user_range (udst, size))
+    return size;
+  return raw_copy (udst, src, size);
+}
+
+/* Copies the null-terminated string at user address USRC into
+   DST, which has room for SIZE bytes including the null
+   terminator.  Copies a page at a time, stopping at the first
+   page that contains the terminator.  Returns the length of the
+   string, not counting the null terminator, or -1 if part of it
+   could not be read.  If the string does not fit, returns SIZE,
+   and DST is not null-terminated. */
+int
+strncpy_from_user (char *dst, const char *usrc, size_t size)
+{
+  size_t ofs = 0;
+
+  while (ofs < size)
+    {
+      const char *src = usrc + ofs;
+      size_t chunk = PGSIZE - pg_ofs (src);
+      char *end;
+
+      if (chunk > size - ofs)
+        chunk = size - ofs;
+      if (copy_from_user (dst + ofs, src, chunk) != 0)
+        return -1;
+      end = memchr (dst + ofs, '\0', chunk);
+      if (end != NULL)
+        return end - dst;
+      ofs += chunk;
+    }
+  return size;
+}
+
+/* Called for a page fault in the kernel that could not be
+   resolved.  If the faulting instruction is in the exception
+   table, arranges for F to resume at its fixup code and returns
+   true.  Otherwise returns false. */
+bool
+uaccess_fixup (struct intr_frame *f)
+{
+  const struct ex_entry *e;
+
+  for (e = _start_ex_table; e < _end_ex_table; e++)
+    if (e->insn == (uintptr_t) f->eip)
+      {
+        f->eip = (void (*) (void)) e->fixup;
+        return true;
+      }
+  return false;
+}
+
+/* Copies SIZE bytes from SRC to DST, a word at a time and then
+   the leftover bytes.  Returns the number of bytes not copied
+   because of a fault. */
+static size_t
+raw_copy (void *dst, const void *src, size_t size)
+{
+  size_t left = size;
+  size_t bytes;
+
+  asm volatile ("movl %%ecx, %%eax\n"
+                "andl $3, %%eax\n"
+                "shrl $2, %%ecx\n"
+                "1: rep movsl\n"
+                "movl %%eax, %%ecx\n"
+                "2: rep movsb\n"
+                "jmp 4f\n"
+                "3: leal (%%eax,%%ecx,4), %%ecx\n"
+                "4:\n"
+                EX_ENTRY ("1b", "3b")
+                EX_ENTRY ("2b", "4b")
+                : "+c" (left), "+D" (dst), "+S" (src), "=&a" (bytes)
+                : : "memory");
+  return left;
+}
@@ -0,0 +1,89 @@
+#include "userprog/vdso.h"
+#include <debug.h>
+#include <vdso.h>
+#include "devices/timer.h"
+#include "threads/cpu.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "userprog/pagedir.h"
+
+/* Kernel-shared pages.
+
+   Every process gets two read-only pages at fixed addresses (see
+   <vdso.h>), so that it can read the time and its own process
+   identifier without trapping into the kernel.  The first page
+   is a single physical page shared by all processes and updated
+   on every timer tick.  Besides the tick count it holds the
+   time-stamp counter value at that tick and the counter's rate,
+   from which a process can tell the time to better than a tick,
+   and some scheduler figures refreshed once a second.  The second
+   page belongs to the process alone.  Both are mapped with
+   PTE_KERN, so that pagedir_destroy() and pagedir_fork() leave
+   them alone. */
+
+static struct vdso_time *vdso_time;
+
+/* Time-stamp counter at the start of the current second, for
+   measuring the counter's rate. */
+static uint64_t second_tsc;
+
+/* Allocates the shared page. */
+void
+vdso_init (void)
+{
+  vdso_time = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+  vdso_time->timer_freq = TIMER_FREQ;
+}
+
+/* Updates the shared page for timer tick TICKS.  Called by the
+   timer interrupt handler. */
+void
+vdso_tick (int64_t ticks)
+{
+  struct vdso_time *vt = vdso_time;
+  uint64_t tsc = cpu_read_tsc ();
+
+  if (vt == NULL)
+    return;
+
+  vt->seq++;
+  barrier ();
+  vt->ticks = ticks;
+  vt->tsc = tsc;
+  if (ticks % TIMER_FREQ == 0)
+    {
+      if (second_tsc != 0)
+        vt->tsc_per_tick = (tsc - second_tsc) / TIMER_FREQ;
+      second_tsc = tsc;
+      vt->ready_threads = thread_ready_count ();
+      vt->load_avg = thread_get_load_avg ();
+    }
+  barrier ();
+  vt->seq++;
+}
+
+/* Maps the shared page and a new page of process information
+   for process PID into page directory PD.  Returns the new
+   page, which the caller must free once PD is destroyed, or a
+   null pointer if memory is exhausted. */
+void *
+vdso_map (uint32_t *pd, int pid)
+{
+  struct vdso_proc *vp;
+
+  ASSERT (vdso_time != NULL);
+
+  vp = palloc_get_page (PAL_ZERO);
+  if (vp == NULL)
+    return NULL;
+  vp->pid = pid;
+  if (!pagedir_set_kernel_page (pd, (void *) VDSO_TIME_ADDR, vdso_time,
+                                false)
+      || !pagedir_set_kernel_page (pd, (void *) VDSO_PROC_ADDR, vp, false))
+    {
+      palloc_free_page (vp);
+      return NULL;
+    }
+  return vp;
+}
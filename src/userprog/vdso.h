@@ -0,0 +1,10 @@
+#ifndef USERPROG_VDSO_H
+#define USERPROG_VDSO_H
+
+#include <stdint.h>
+
+void vdso_init (void);
+void vdso_tick (int64_t ticks);
+void *vdso_map (uint32_t *pd, int pid);
+
+#endif /* userprog/vdso.h */
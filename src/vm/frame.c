@@ -0,0 +1,651 @@
+#include "vm/frame.h"
+#include <debug.h>
+#include <hash.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/exec-cache.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+#include "vm/swap.h"
+
+/* Frame table.  Tracks every page of the user pool that is
+   mapped into some process's page directory.
+
+   A frame may be mapped by more than one page directory at a
+   time.  Read-only pages of executables are the common case:
+   when several processes run the same program, the pages read
+   from the same (inode, offset) are loaded once and shared by
+   all of them.  Each frame therefore carries a reference count,
+   and it is only returned to the user pool when the last page
+   directory that maps it lets go.  fork() relies on the same
+   counts: parent and child map every page read-only, and the
+   first write to a page with other references copies it (see
+   frame_unshare()).
+
+   One frame, the zero frame, is always full of zeros.  Pages
+   that start out zeroed, such as BSS, are mapped to it
+   read-only until they are first written, so that large static
+   tables a program never touches cost no memory.  The zero
+   frame holds a reference of its own and is never freed.
+
+   When the user pool runs out, a frame is evicted to swap to
+   make room, chosen by the clock algorithm.  Only frames with a
+   known single owner can be evicted: private pages that exactly
+   one process has mapped writable, at a page recorded by
+   frame_own().  Shared frames are left alone, since there is no
+   record of which page directories map them.  With the frame
+   table locked, the owner's page table entry is switched to
+   refer to the swap slot and the frame is taken off the clock,
+   onto the list of frames in transit.  The frame's contents are
+   then written out with the frame table unlocked, so that other
+   processes' faults go ahead meanwhile.  The owner faulting on
+   the page before the write finishes waits for it on the frame's
+   io_done condition in frame_swap_in(), and frame_pin() waits
+   the same way for all of the process's frames in transit.
+
+   Reading a page back in from swap, and reading a shareable page
+   from its file, are also done with the frame table unlocked,
+   into a frame that nobody else can get at yet. */
+
+/* A physical frame backing one or more user pages. */
+struct frame
+  {
+    void *kpage;                /* Kernel virtual address of frame. */
+    int ref_cnt;                /* Number of mappings of this frame. */
+    struct hash_elem elem;      /* Element in `frames'. */
+
+    /* Sharing key, used only for read-only executable pages.
+       INODE is a null pointer for private frames. */
+    struct inode *inode;        /* Inode the page was read from. */
+    off_t ofs;                  /* Offset of the page in INODE. */
+    size_t read_bytes;          /* Bytes read, rest is zeroed. */
+    struct hash_elem share_elem;/* Element in `shared_frames'. */
+    bool loading;               /* Still being read in? */
+    struct condition io_done;   /* Broadcast when I/O on it is done. */
+
+    /* Eviction.  OWNER is a null pointer unless the frame is
+       private to one process. */
+    struct thread *owner;       /* Main thread of process mapping it. */
+    void *upage;                /* Where OWNER maps it. */
+    struct list_elem clock_elem;/* Element in `clock_list' or
+                                   `evicting'. */
+  };
+
+/* All frames in use, keyed by kernel virtual address. */
+static struct hash frames;
+
+/* Shareable frames, keyed by (inode, offset, read_bytes). */
+static struct hash shared_frames;
+
+/* Protects both tables and the reference counts. */
+static struct lock frame_lock;
+
+/* The shared frame of zeros. */
+static struct frame *zero_frame;
+
+/* All frames, in the order the clock hand visits them, and the
+   hand, which is a null pointer when the clock is empty. */
+static struct list clock_list;
+static struct list_elem *clock_hand;
+
+/* Frames being written out to swap. */
+static struct list evicting;
+
+/* Statistics. */
+static long long share_hit_cnt;    /* # of shared pages found cached. */
+static long long share_miss_cnt;   /* # of shared pages loaded afresh. */
+static long long cow_copy_cnt;     /* # of pages copied on write. */
+static long long zero_fill_cnt;    /* # of zero page mappings written. */
+static long long evict_cnt;        /* # of frames evicted to swap. */
+
+static hash_hash_func frame_hash, share_hash;
+static hash_less_func frame_less, share_less;
+static struct frame *lookup_frame (void *kpage);
+static struct frame *alloc_frame (enum palloc_flags);
+static void put_frame (struct frame *);
+static void clock_remove (struct frame *);
+static bool evict_frame (void);
+static struct frame *next_victim (void);
+static void wait_for_eviction (struct thread *leader, const void *upage);
+
+/* Initializes the frame table. */
+void
+frame_init (void)
+{
+  lock_init (&frame_lock);
+  hash_init (&frames, frame_hash, frame_less, NULL);
+  hash_init (&shared_frames, share_hash, share_less, NULL);
+  list_init (&clock_list);
+  list_init (&evicting);
+
+  lock_acquire (&frame_lock);
+  zero_frame = alloc_frame (PAL_ZERO);
+  lock_release (&frame_lock);
+  if (zero_frame == NULL)
+    PANIC ("no memory for zero frame");
+}
+
+/* Obtains a private frame from the user pool and returns its
+   kernel virtual address, or a null pointer if the user pool is
+   exhausted.  FLAGS are passed along to palloc_get_page(), with
+   PAL_USER implied.  The frame starts out with a single
+   reference, which frame_free() drops. */
+void *
+frame_alloc (enum palloc_flags flags)
+{
+  struct frame *f;
+
+  lock_acquire (&frame_lock);
+  f = alloc_frame (flags);
+  lock_release (&frame_lock);
+
+  return f != NULL ? f->kpage : NULL;
+}
+
+/* Returns a frame holding READ_BYTES bytes of FILE starting at
+   offset OFS, followed by zeros up to the end of the page.  If
+   another process already has the same page of the same inode
+   loaded, that frame is shared and its reference count is
+   incremented; otherwise the page is copied from the exec cache,
+   or read from disk if the cache does not have it.
+   The frame must never be mapped writable, because all of its
+   users see the same physical memory.
+   Returns a null pointer if memory allocation or the disk read
+   fails. */
+void *
+frame_get_shared (struct file *file, off_t ofs, size_t read_bytes)
+{
+  struct frame key, *f, *new = NULL;
+  struct hash_elem *e;
+  bool success;
+
+  ASSERT (read_bytes <= PGSIZE);
+  ASSERT (ofs % PGSIZE == 0);
+
+  key.inode = file_get_inode (file);
+  key.ofs = ofs;
+  key.read_bytes = read_bytes;
+
+  lock_acquire (&frame_lock);
+  for (;;)
+    {
+      e = hash_find (&shared_frames, &key.share_elem);
+      if (e != NULL)
+        {
+          f = hash_entry (e, struct frame, share_elem);
+          if (f->loading)
+            {
+              /* Another process is reading the page in.  Wait for
+                 it, then look again, since its read may fail. */
+              cond_wait (&f->io_done, &frame_lock);
+              continue;
+            }
+          f->ref_cnt++;
+          share_hit_cnt++;
+          if (new != NULL)
+            put_frame (new);
+          lock_release (&frame_lock);
+          return f->kpage;
+        }
+      if (new != NULL)
+        break;
+
+      /* alloc_frame() may unlock the frame table to evict a
+         frame, so look again afterward. */
+      new = alloc_frame (0);
+      if (new == NULL)
+        {
+          lock_release (&frame_lock);
+          return NULL;
+        }
+    }
+
+  /* Enter the frame as loading, so that concurrent loaders of
+     the same page wait for us instead of reading their own copy,
+     and read it with the frame table unlocked. */
+  f = new;
+  f->inode = inode_reopen (key.inode);
+  f->ofs = ofs;
+  f->read_bytes = read_bytes;
+  f->loading = true;
+  hash_insert (&shared_frames, &f->share_elem);
+  lock_release (&frame_lock);
+
+  success = (exec_cache_read (key.inode, ofs, f->kpage, read_bytes)
+             || (file_read_at (file, f->kpage, read_bytes, ofs)
+                 == (off_t) read_bytes));
+  if (success)
+    memset ((uint8_t *) f->kpage + read_bytes, 0, PGSIZE - read_bytes);
+
+  lock_acquire (&frame_lock);
+  f->loading = false;
+  cond_broadcast (&f->io_done, &frame_lock);
+  if (success)
+    share_miss_cnt++;
+  else
+    {
+      put_frame (f);
+      f = NULL;
+    }
+  lock_release (&frame_lock);
+
+  return f != NULL ? f->kpage : NULL;
+}
+
+/* Returns the zero frame with a new reference added.  The frame
+   must never be mapped writable; see frame_unshare(). */
+void *
+frame_get_zero (void)
+{
+  lock_acquire (&frame_lock);
+  zero_frame->ref_cnt++;
+  lock_release (&frame_lock);
+
+  return zero_frame->kpage;
+}
+
+/* Adds a reference to the frame at KPAGE, for a page directory
+   that maps it in addition to the existing ones. */
+void
+frame_ref (void *kpage)
+{
+  struct frame *f;
+
+  lock_acquire (&frame_lock);
+  f = lookup_frame (kpage);
+  ASSERT (f != NULL);
+  f->ref_cnt++;
+  f->owner = NULL;
+  lock_release (&frame_lock);
+}
+
+/* Records that the frame at KPAGE, which must have exactly one
+   reference and not be shareable, is mapped writable by the
+   running process at user virtual page UPAGE, which makes it a
+   candidate for eviction. */
+void
+frame_own (void *kpage, void *upage)
+{
+  struct frame *f;
+
+  lock_acquire (&frame_lock);
+  f = lookup_frame (kpage);
+  ASSERT (f != NULL);
+  ASSERT (f->ref_cnt == 1 && f->inode == NULL && f != zero_frame);
+  f->owner = process_leader (thread_current ());
+  f->upage = upage;
+  lock_release (&frame_lock);
+}
+
+/* Prevents the frames of the running process from being evicted
+   if PINNED is true, or allows it again if PINNED is false.
+   Waits for any eviction of the process's frames already under
+   way to finish, so that once pinned, the process can examine
+   and change its page tables without racing against the frame
+   table. */
+void
+frame_pin (bool pinned)
+{
+  struct thread *leader = process_leader (thread_current ());
+
+  lock_acquire (&frame_lock);
+  leader->frames_pinned = pinned;
+  if (pinned)
+    wait_for_eviction (leader, NULL);
+  lock_release (&frame_lock);
+}
+
+/* Reads user virtual page UPAGE of the running process back in
+   from swap, if it is swapped out.  If the page is being evicted
+   right now, waits for that to finish first.  Returns true if
+   UPAGE is mapped on return, false if memory is exhausted.  The
+   caller must keep the process's other threads from faulting
+   UPAGE in meanwhile (see page_handle_fault()). */
+bool
+frame_swap_in (void *upage)
+{
+  struct thread *leader = process_leader (thread_current ());
+  uint32_t *pd = thread_current ()->pagedir;
+  struct frame *f;
+  size_t slot;
+  bool success;
+
+  lock_acquire (&frame_lock);
+  wait_for_eviction (leader, upage);
+  if (!pagedir_get_swap (pd, upage, &slot))
+    {
+      lock_release (&frame_lock);
+      return true;
+    }
+  f = alloc_frame (0);
+  lock_release (&frame_lock);
+  if (f == NULL)
+    return false;
+
+  /* F has no owner yet, so it cannot be evicted while we read. */
+  swap_read (slot, f->kpage);
+
+  lock_acquire (&frame_lock);
+  success = pagedir_set_page (pd, upage, f->kpage, true);
+  ASSERT (success);
+  f->owner = leader;
+  f->upage = upage;
+  leader->rusage.swapped_in++;
+  process_add_resident (leader, 1);
+  lock_release (&frame_lock);
+
+  return true;
+}
+
+/* Gives the caller a private, writable copy of the frame at
+   KPAGE, dropping the caller's reference to KPAGE.  If the
+   caller holds the only reference to a private frame, that frame
+   is simply handed back; otherwise the contents are copied into
+   a newly allocated frame.  Returns the kernel virtual address
+   of the private frame, or a null pointer (with the reference to
+   KPAGE still held) if memory is exhausted. */
+void *
+frame_unshare (void *kpage)
+{
+  struct frame *f, *copy;
+
+  lock_acquire (&frame_lock);
+  f = lookup_frame (kpage);
+  ASSERT (f != NULL);
+  if (f->ref_cnt == 1 && f->inode == NULL)
+    copy = f;
+  else if (f == zero_frame)
+    {
+      /* No need to copy a page of zeros. */
+      copy = alloc_frame (PAL_ZERO);
+      if (copy != NULL)
+        {
+          put_frame (f);
+          zero_fill_cnt++;
+        }
+    }
+  else
+    {
+      copy = alloc_frame (0);
+      if (copy != NULL)
+        {
+          memcpy (copy->kpage, f->kpage, PGSIZE);
+          put_frame (f);
+          cow_copy_cnt++;
+        }
+    }
+  lock_release (&frame_lock);
+
+  return copy != NULL ? copy->kpage : NULL;
+}
+
+/* Drops a reference to the frame at KPAGE, which must have been
+   obtained from frame_alloc() or frame_get_shared().  The frame
+   is returned to the user pool when its last reference goes
+   away. */
+void
+frame_free (void *kpage)
+{
+  struct frame *f;
+
+  lock_acquire (&frame_lock);
+  f = lookup_frame (kpage);
+  ASSERT (f != NULL);
+  put_frame (f);
+  lock_release (&frame_lock);
+}
+
+/* Prints frame table statistics. */
+void
+frame_print_stats (void)
+{
+  printf ("Frames: %zu in use, %lld shared page hits, %lld misses, "
+          "%lld copied on write\n",
+          hash_size (&frames), share_hit_cnt, share_miss_cnt, cow_copy_cnt);
+  printf ("Zero page: %d mappings, %lld filled on write\n",
+          zero_frame->ref_cnt - 1, zero_fill_cnt);
+  printf ("Eviction: %lld frames evicted to swap\n", evict_cnt);
+}
+
+/* Returns the frame for KPAGE, or a null pointer if KPAGE is not
+   in the frame table.  The frame table must be locked. */
+static struct frame *
+lookup_frame (void *kpage)
+{
+  struct frame key;
+  struct hash_elem *e;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  key.kpage = kpage;
+  e = hash_find (&frames, &key.elem);
+  return e != NULL ? hash_entry (e, struct frame, elem) : NULL;
+}
+
+/* Allocates a private frame with one reference and adds it to
+   the frame table, which must be locked.  Returns a null
+   pointer if memory is exhausted.  If the user pool is
+   exhausted, unlocks the frame table for a while to evict a
+   frame, so the caller must not rely on anything it found in
+   the tables before calling. */
+static struct frame *
+alloc_frame (enum palloc_flags flags)
+{
+  struct frame *f;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  f = malloc (sizeof *f);
+  if (f == NULL)
+    return NULL;
+  while ((f->kpage = palloc_get_page (PAL_USER | flags)) == NULL)
+    if (!evict_frame ())
+      {
+        free (f);
+        return NULL;
+      }
+  f->ref_cnt = 1;
+  f->inode = NULL;
+  f->loading = false;
+  cond_init (&f->io_done);
+  f->owner = NULL;
+  hash_insert (&frames, &f->elem);
+  if (clock_hand != NULL)
+    list_insert (clock_hand, &f->clock_elem);
+  else
+    {
+      list_push_back (&clock_list, &f->clock_elem);
+      clock_hand = &f->clock_elem;
+    }
+  return f;
+}
+
+/* Drops a reference to F, freeing it when no references remain.
+   The frame table must be locked. */
+static void
+put_frame (struct frame *f)
+{
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+  ASSERT (f->ref_cnt > 0);
+
+  if (--f->ref_cnt > 0)
+    return;
+
+  hash_delete (&frames, &f->elem);
+  clock_remove (f);
+  if (f->inode != NULL)
+    {
+      hash_delete (&shared_frames, &f->share_elem);
+      inode_close (f->inode);
+    }
+  palloc_free_page (f->kpage);
+  free (f);
+}
+
+/* Takes F off the clock, moving the hand past it if need be.
+   The frame table must be locked. */
+static void
+clock_remove (struct frame *f)
+{
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  if (clock_hand == &f->clock_elem)
+    {
+      clock_hand = list_next (clock_hand);
+      if (clock_hand == list_end (&clock_list))
+        clock_hand = list_begin (&clock_list);
+    }
+  list_remove (&f->clock_elem);
+  if (list_empty (&clock_list))
+    clock_hand = NULL;
+}
+
+/* Evicts a frame to swap and frees it.  Returns false if no
+   frame can be evicted or swap is full.  The frame table must be
+   locked, and is unlocked while the frame is written out. */
+static bool
+evict_frame (void)
+{
+  struct frame *victim;
+  struct thread *owner;
+  size_t slot;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  victim = next_victim ();
+  if (victim == NULL)
+    return false;
+  slot = swap_reserve ();
+  if (slot == SWAP_ERROR)
+    return false;
+
+  /* Unmap the page before saving it, so that its owner cannot
+     change it while it is written out, and put it in transit,
+     where nobody else can pick it. */
+  owner = victim->owner;
+  ASSERT (victim->ref_cnt == 1);
+  ASSERT (pagedir_get_page (owner->pagedir, victim->upage) == victim->kpage);
+  pagedir_set_swap (owner->pagedir, victim->upage, slot);
+  owner->rusage.swapped_out++;
+  process_add_resident (owner, -1);
+  clock_remove (victim);
+  list_push_back (&evicting, &victim->clock_elem);
+
+  lock_release (&frame_lock);
+  swap_write (slot, victim->kpage);
+  lock_acquire (&frame_lock);
+
+  list_remove (&victim->clock_elem);
+  cond_broadcast (&victim->io_done, &frame_lock);
+  hash_delete (&frames, &victim->elem);
+  palloc_free_page (victim->kpage);
+  free (victim);
+  evict_cnt++;
+  return true;
+}
+
+/* Waits until no frame of LEADER's process is in transit to
+   swap, or if UPAGE is nonnull, until the frame at UPAGE is not.
+   The frame table must be locked. */
+static void
+wait_for_eviction (struct thread *leader, const void *upage)
+{
+  struct list_elem *e;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  e = list_begin (&evicting);
+  while (e != list_end (&evicting))
+    {
+      struct frame *f = list_entry (e, struct frame, clock_elem);
+
+      if (f->owner == leader && (upage == NULL || f->upage == upage))
+        {
+          /* F is freed once the write is done, so start over. */
+          cond_wait (&f->io_done, &frame_lock);
+          e = list_begin (&evicting);
+        }
+      else
+        e = list_next (e);
+    }
+}
+
+/* Runs the clock algorithm to choose a frame to evict: the hand
+   sweeps over the frames, clearing accessed bits, and stops at
+   the first evictable frame that has not been accessed since the
+   last sweep.  Returns a null pointer if no frame is evictable.
+   The frame table must be locked. */
+static struct frame *
+next_victim (void)
+{
+  size_t n;
+
+  /* Two sweeps are enough to come back to a frame whose accessed
+     bit the first one cleared. */
+  for (n = 2 * list_size (&clock_list); n > 0; n--)
+    {
+      struct frame *f = list_entry (clock_hand, struct frame, clock_elem);
+
+      clock_hand = list_next (clock_hand);
+      if (clock_hand == list_end (&clock_list))
+        clock_hand = list_begin (&clock_list);
+
+      if (f->owner != NULL && !f->owner->frames_pinned)
+        {
+          uint32_t *pd = f->owner->pagedir;
+          if (!pagedir_is_accessed (pd, f->upage))
+            return f;
+          pagedir_set_accessed (pd, f->upage, false);
+        }
+    }
+  return NULL;
+}
+
+/* Returns a hash value for frame E, keyed by its address. */
+static unsigned
+frame_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct frame *f = hash_entry (e, struct frame, elem);
+  return hash_bytes (&f->kpage, sizeof f->kpage);
+}
+
+/* Returns true if frame A precedes frame B. */
+static bool
+frame_less (const struct hash_elem *a_, const struct hash_elem *b_,
+            void *aux UNUSED)
+{
+  const struct frame *a = hash_entry (a_, struct frame, elem);
+  const struct frame *b = hash_entry (b_, struct frame, elem);
+  return a->kpage < b->kpage;
+}
+
+/* Returns a hash value for shareable frame E. */
+static unsigned
+share_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct frame *f = hash_entry (e, struct frame, share_elem);
+  return (hash_bytes (&f->inode, sizeof f->inode)
+          ^ hash_int (f->ofs) ^ hash_int (f->read_bytes));
+}
+
+/* Returns true if shareable frame A precedes shareable frame
+   B. */
+static bool
+share_less (const struct hash_elem *a_, const struct hash_elem *b_,
+            void *aux UNUSED)
+{
+  const struct frame *a = hash_entry (a_, struct frame, share_elem);
+  const struct frame *b = hash_entry (b_, struct frame, share_elem);
+  if (a->inode != b->inode)
+    return a->inode < b->inode;
+  else if (a->ofs != b->ofs)
+    return a->ofs < b->ofs;
+  else
+    return a->read_bytes < b->read_bytes;
+}
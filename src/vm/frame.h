@@ -0,0 +1,23 @@
+#ifndef VM_FRAME_H
+#define VM_FRAME_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "filesys/off_t.h"
+#include "threads/palloc.h"
+
+struct file;
+
+void frame_init (void);
+void *frame_alloc (enum palloc_flags);
+void *frame_get_shared (struct file *, off_t ofs, size_t read_bytes);
+void *frame_get_zero (void);
+void frame_ref (void *kpage);
+void frame_own (void *kpage, void *upage);
+void frame_pin (bool pinned);
+bool frame_swap_in (void *upage);
+void *frame_unshare (void *kpage);
+void frame_free (void *kpage);
+void frame_print_stats (void);
+
+#endif /* vm/frame.h */
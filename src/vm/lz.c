@@ -0,0 +1,167 @@
+#include "vm/lz.h"
+#include <stdint.h>
+#include <string.h>
+
+/* A small LZ77 compressor, fast enough to run on every page the
+   swap code compresses and simple enough to trust.
+
+   Compressed data is a sequence of groups, each made of a
+   control byte followed by up to 8 items, one per bit of the
+   control byte from least significant to most significant.  A
+   clear bit means that the item is a literal byte, copied to the
+   output as is.  A set bit means that the item is a 2-byte
+   match: the top 12 bits give the distance back into the output
+   to copy from, 1 to 4095, and the bottom 4 bits give the
+   length, minus LZ_MIN_MATCH.  A length field of 15 is followed
+   by a third byte that is added to the length, for long runs.
+   A match may overlap the bytes it produces, so a run of a
+   repeated byte costs one literal followed by matches at
+   distance 1.
+
+   Matches are found through a hash table indexed by the next 3
+   bytes, which remembers only the most recent position for each
+   hash, so the compressor is greedy and does no search. */
+
+#define LZ_MIN_MATCH 3                          /* Shortest match. */
+#define LZ_LONG_MATCH (LZ_MIN_MATCH + 15)       /* Needs a third byte. */
+#define LZ_MAX_MATCH (LZ_LONG_MATCH + 255)      /* Longest match. */
+#define LZ_MAX_DIST 4095                        /* Farthest match. */
+#define LZ_HASH_BITS 10                         /* Hash table size. */
+
+static unsigned hash3 (const uint8_t *);
+
+/* Compresses the SRC_LEN bytes at SRC into the DST_CAP bytes at
+   DST.  Returns the size of the compressed data, or 0 if it
+   would not fit in DST_CAP bytes.
+   Not reentrant: callers must serialize. */
+size_t
+lz_compress (const void *src_, size_t src_len, void *dst_, size_t dst_cap)
+{
+  /* Most recent position plus 1 for each hash, or 0. */
+  static size_t table[1 << LZ_HASH_BITS];
+
+  const uint8_t *src = src_;
+  uint8_t *dst = dst_;
+  uint8_t *ctrl = NULL;
+  size_t s = 0, d = 0;
+  int bit = 8;
+
+  memset (table, 0, sizeof table);
+  while (s < src_len)
+    {
+      size_t len = 0, dist = 0;
+
+      /* Start a new group if the last one is full. */
+      if (bit == 8)
+        {
+          if (d >= dst_cap)
+            return 0;
+          ctrl = &dst[d++];
+          *ctrl = 0;
+          bit = 0;
+        }
+
+      /* Look for a match. */
+      if (src_len - s >= LZ_MIN_MATCH)
+        {
+          unsigned h = hash3 (src + s);
+          size_t cand = table[h];
+
+          table[h] = s + 1;
+          if (cand != 0 && s - (cand - 1) <= LZ_MAX_DIST)
+            {
+              size_t max = src_len - s;
+
+              cand--;
+              if (max > LZ_MAX_MATCH)
+                max = LZ_MAX_MATCH;
+              while (len < max && src[cand + len] == src[s + len])
+                len++;
+              dist = s - cand;
+            }
+        }
+
+      if (len >= LZ_MIN_MATCH)
+        {
+          bool is_long = len >= LZ_LONG_MATCH;
+
+          if (dst_cap - d < (is_long ? 3 : 2))
+            return 0;
+          *ctrl |= 1 << bit;
+          dst[d++] = dist >> 4;
+          if (is_long)
+            {
+              dst[d++] = ((dist & 0xf) << 4) | 15;
+              dst[d++] = len - LZ_LONG_MATCH;
+            }
+          else
+            dst[d++] = ((dist & 0xf) << 4) | (len - LZ_MIN_MATCH);
+          s += len;
+        }
+      else
+        {
+          if (d >= dst_cap)
+            return 0;
+          dst[d++] = src[s++];
+        }
+      bit++;
+    }
+  return d;
+}
+
+/* Decompresses the SRC_LEN bytes at SRC, produced by
+   lz_compress(), into exactly DST_LEN bytes at DST.  Returns
+   true if successful, false if SRC is corrupt. */
+bool
+lz_decompress (const void *src_, size_t src_len, void *dst_, size_t dst_len)
+{
+  const uint8_t *src = src_;
+  uint8_t *dst = dst_;
+  size_t s = 0, d = 0;
+
+  while (d < dst_len)
+    {
+      uint8_t ctrl;
+      int bit;
+
+      if (s >= src_len)
+        return false;
+      ctrl = src[s++];
+      for (bit = 0; bit < 8 && d < dst_len; bit++)
+        if (ctrl & (1 << bit))
+          {
+            size_t dist, len;
+
+            if (src_len - s < 2)
+              return false;
+            dist = (src[s] << 4) | (src[s + 1] >> 4);
+            len = (src[s + 1] & 0xf) + LZ_MIN_MATCH;
+            s += 2;
+            if (len == LZ_LONG_MATCH)
+              {
+                if (s >= src_len)
+                  return false;
+                len += src[s++];
+              }
+            if (dist == 0 || dist > d || len > dst_len - d)
+              return false;
+            for (; len > 0; len--, d++)
+              dst[d] = dst[d - dist];
+          }
+        else
+          {
+            if (s >= src_len)
+              return false;
+            dst[d++] = src[s++];
+          }
+    }
+  return true;
+}
+
+/* Returns a hash of the 3 bytes at P. */
+static unsigned
+hash3 (const uint8_t *p)
+{
+  uint32_t x = p[0] | (p[1] << 8) | ((uint32_t) p[2] << 16);
+  return (x * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
@@ -0,0 +1,567 @@
+#include "vm/page.h"
+#include <debug.h>
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "userprog/pagedir.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/process.h"
+#include "vm/frame.h"
+
+/* Demand paging.
+
+   Executable segments are not read when a program is loaded.
+   Instead, load_segment() records each one as a region, and its
+   pages are read in by the page fault handler as the program
+   touches them.  Pages that the kernel evicted to swap are read
+   back the same way.
+
+   Faulting in one page at a time makes a sequential scan take
+   one fault per page, so both kinds of fault also map the pages
+   that follow the faulting one, if they are not already mapped:
+   the rest of the region for file pages, and swapped-out
+   neighbours for swap.  How many pages to map per fault is
+   adapted to how well it has worked: at each fault, the pages
+   read ahead at the previous fault of the same kind are checked
+   for their accessed bits.  If at least half were used, the
+   window doubles, otherwise it halves.
+
+   The threads of a process share its virtual memory state, and
+   each one can fault, so faults are handled one at a time per
+   process, and their counts go to the process's main thread. */
+
+/* Bounds on read-ahead windows, in pages, including the faulting
+   page. */
+#define READAHEAD_MIN 1
+#define READAHEAD_INIT 4
+#define READAHEAD_MAX 32
+
+/* Adaptive read-ahead state for one stream of faults. */
+struct readahead
+  {
+    size_t window;              /* Pages to map per fault. */
+    uint8_t *start;             /* First page read ahead last time. */
+    size_t cnt;                 /* Number of pages read ahead then. */
+  };
+
+/* A run of pages backed by an executable file. */
+struct region
+  {
+    struct list_elem elem;      /* Element in vm_space's `regions'. */
+    uint8_t *start;             /* First user virtual page. */
+    size_t page_cnt;            /* Number of pages. */
+    struct file *file;          /* File to read from. */
+    off_t ofs;                  /* Offset in FILE of first page. */
+    uint32_t read_bytes;        /* Bytes to read, the rest is zeros. */
+    bool writable;              /* Writable, or read-only? */
+    struct readahead ra;        /* Read-ahead for faults on region. */
+  };
+
+/* The virtual memory state of a process. */
+struct vm_space
+  {
+    struct lock lock;           /* Serializes faults. */
+    struct list regions;        /* List of struct region. */
+    struct readahead swap_ra;   /* Read-ahead for swap faults. */
+  };
+
+/* Default stack limit of 8 MB. */
+size_t page_stack_limit = 2048;
+
+/* Statistics. */
+static long long file_fault_cnt;   /* # of faults on region pages. */
+static long long swap_fault_cnt;   /* # of faults on swapped pages. */
+static long long file_ahead_cnt;   /* # of region pages read ahead. */
+static long long file_ahead_hits;  /* # of those used by next fault. */
+static long long swap_ahead_cnt;   /* # of swapped pages read ahead. */
+static long long swap_ahead_hits;  /* # of those used by next fault. */
+
+static bool resolve_fault (uint32_t *pd, struct vm_space *, void *fault_addr,
+                           bool not_present, bool write, void *esp);
+static struct region *find_region (struct vm_space *, const void *upage);
+static size_t region_read_bytes (const struct region *, const uint8_t *upage);
+static bool load_region_page (uint32_t *pd, struct region *, uint8_t *upage);
+static bool fault_in_region (uint32_t *pd, struct region *, uint8_t *upage);
+static bool fault_in_swap (uint32_t *pd, struct vm_space *, uint8_t *upage);
+static bool is_unmapped (uint32_t *pd, const void *upage);
+static void readahead_init (struct readahead *);
+static long long readahead_update (struct readahead *, uint32_t *pd,
+                                   const void *upage);
+static bool break_cow (uint32_t *pd, void *upage);
+static bool is_stack_access (const void *fault_addr, const void *esp);
+static bool grow_stack (uint32_t *pd, void *upage, bool write);
+
+/* Gives the running process an empty virtual memory state.
+   Returns false if memory allocation fails. */
+bool
+page_space_create (void)
+{
+  struct thread *t = thread_current ();
+  struct vm_space *vm;
+
+  ASSERT (t->vm == NULL);
+
+  vm = malloc (sizeof *vm);
+  if (vm == NULL)
+    return false;
+  lock_init (&vm->lock);
+  list_init (&vm->regions);
+  readahead_init (&vm->swap_ra);
+  t->vm = vm;
+  return true;
+}
+
+/* Gives the running process a copy of PARENT's virtual memory
+   state, for fork().  PARENT must not change its own meanwhile.
+   Returns false if memory allocation fails. */
+bool
+page_space_fork (const struct thread *parent)
+{
+  struct list_elem *e;
+
+  if (!page_space_create ())
+    return false;
+  if (parent->vm == NULL)
+    return true;
+
+  for (e = list_begin (&parent->vm->regions);
+       e != list_end (&parent->vm->regions); e = list_next (e))
+    {
+      struct region *r = list_entry (e, struct region, elem);
+      struct region *copy = malloc (sizeof *copy);
+
+      if (copy == NULL)
+        return false;
+      *copy = *r;
+      copy->file = file_reopen (r->file);
+      if (copy->file == NULL)
+        {
+          free (copy);
+          return false;
+        }
+      readahead_init (&copy->ra);
+      list_push_back (&thread_current ()->vm->regions, &copy->elem);
+    }
+  return true;
+}
+
+/* Frees the running process's virtual memory state. */
+void
+page_space_destroy (void)
+{
+  struct thread *t = thread_current ();
+
+  if (t->vm == NULL)
+    return;
+
+  while (!list_empty (&t->vm->regions))
+    {
+      struct list_elem *e = list_pop_front (&t->vm->regions);
+      struct region *r = list_entry (e, struct region, elem);
+
+      file_close (r->file);
+      free (r);
+    }
+  free (t->vm);
+  t->vm = NULL;
+}
+
+/* Adds a region to the running process, so that READ_BYTES +
+   ZERO_BYTES bytes of virtual memory starting at UPAGE are
+   filled in on demand from FILE starting at offset OFS, as
+   described for load_segment() in userprog/process.c.
+   Returns false if the region overlaps an existing one or memory
+   allocation fails. */
+bool
+page_add_region (struct file *file, off_t ofs, uint8_t *upage,
+                 uint32_t read_bytes, uint32_t zero_bytes, bool writable)
+{
+  struct vm_space *vm = thread_current ()->vm;
+  size_t page_cnt = (read_bytes + zero_bytes) / PGSIZE;
+  struct region *r;
+  size_t i;
+
+  ASSERT ((read_bytes + zero_bytes) % PGSIZE == 0);
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (ofs % PGSIZE == 0);
+
+  for (i = 0; i < page_cnt; i++)
+    if (find_region (vm, upage + i * PGSIZE) != NULL)
+      return false;
+
+  r = malloc (sizeof *r);
+  if (r == NULL)
+    return false;
+  r->file = file_reopen (file);
+  if (r->file == NULL)
+    {
+      free (r);
+      return false;
+    }
+  r->start = upage;
+  r->page_cnt = page_cnt;
+  r->ofs = ofs;
+  r->read_bytes = read_bytes;
+  r->writable = writable;
+  readahead_init (&r->ra);
+  list_push_back (&vm->regions, &r->elem);
+  return true;
+}
+
+/* Tries to resolve a page fault at FAULT_ADDR in the running
+   process.  NOT_PRESENT and WRITE describe the fault, as decoded
+   by page_fault() in userprog/exception.c.  The fault may have
+   come from user code or from the kernel accessing user memory
+   on the process's behalf; either way ESP is the user stack
+   pointer, which for a fault inside a system call is the one
+   saved at system call entry.
+   Returns true if the faulting access can be retried, false if
+   it is a genuine error. */
+bool
+page_handle_fault (void *fault_addr, bool not_present, bool write,
+                   void *esp)
+{
+  struct thread *t = thread_current ();
+  uint32_t *pd = t->pagedir;
+  struct vm_space *vm = t->vm;
+  bool success;
+
+  if (pd == NULL || vm == NULL || !is_user_vaddr (fault_addr))
+    return false;
+
+  lock_acquire (&vm->lock);
+  success = resolve_fault (pd, vm, fault_addr, not_present, write, esp);
+  lock_release (&vm->lock);
+  return success;
+}
+
+/* Returns true if user page UPAGE lies in one of the running
+   process's regions, whether or not it has been faulted in. */
+bool
+page_in_region (const void *upage)
+{
+  struct vm_space *vm = thread_current ()->vm;
+  bool in_region;
+
+  if (vm == NULL)
+    return false;
+  lock_acquire (&vm->lock);
+  in_region = find_region (vm, upage) != NULL;
+  lock_release (&vm->lock);
+  return in_region;
+}
+
+/* Does the work of page_handle_fault() for page directory PD
+   and virtual memory state VM, whose lock must be held.  Another
+   thread of the process may have resolved the fault while we
+   waited for the lock, in which case there is nothing to do. */
+static bool
+resolve_fault (uint32_t *pd, struct vm_space *vm, void *fault_addr,
+               bool not_present, bool write, void *esp)
+{
+  struct rusage *ru = &process_leader (thread_current ())->rusage;
+  void *upage = pg_round_down (fault_addr);
+  struct region *r;
+  size_t slot;
+
+  if (!not_present && write && pagedir_is_cow (pd, upage))
+    {
+      ru->minor_faults++;
+      return break_cow (pd, upage);
+    }
+
+  if (!not_present)
+    return write && pagedir_is_writable (pd, upage);
+  if (pagedir_get_page (pd, upage) != NULL)
+    return true;
+
+  if (pagedir_get_swap (pd, upage, &slot))
+    {
+      ru->major_faults++;
+      return fault_in_swap (pd, vm, upage);
+    }
+
+  r = find_region (vm, upage);
+  if (r != NULL)
+    {
+      if (region_read_bytes (r, upage) > 0)
+        ru->major_faults++;
+      else
+        ru->minor_faults++;
+      return fault_in_region (pd, r, upage);
+    }
+
+  if (is_stack_access (fault_addr, esp))
+    {
+      ru->minor_faults++;
+      return grow_stack (pd, upage, write);
+    }
+
+  return false;
+}
+
+/* Prints demand paging statistics. */
+void
+page_print_stats (void)
+{
+  printf ("Page faults: %lld on file pages, %lld pages read ahead, "
+          "%lld used\n",
+          file_fault_cnt, file_ahead_cnt, file_ahead_hits);
+  printf ("Page faults: %lld on swapped pages, %lld pages read ahead, "
+          "%lld used\n",
+          swap_fault_cnt, swap_ahead_cnt, swap_ahead_hits);
+}
+
+/* Returns the region of VM that contains UPAGE, or a null
+   pointer if there is none. */
+static struct region *
+find_region (struct vm_space *vm, const void *upage)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&vm->regions); e != list_end (&vm->regions);
+       e = list_next (e))
+    {
+      struct region *r = list_entry (e, struct region, elem);
+      if ((const uint8_t *) upage >= r->start
+          && (const uint8_t *) upage < r->start + r->page_cnt * PGSIZE)
+        return r;
+    }
+  return NULL;
+}
+
+/* Returns the number of bytes of page UPAGE of region R that
+   come from R's file; the rest of the page is zeros. */
+static size_t
+region_read_bytes (const struct region *r, const uint8_t *upage)
+{
+  size_t ofs_in_region = upage - r->start;
+  size_t read_bytes = 0;
+
+  if (ofs_in_region < r->read_bytes)
+    {
+      read_bytes = r->read_bytes - ofs_in_region;
+      if (read_bytes > PGSIZE)
+        read_bytes = PGSIZE;
+    }
+  return read_bytes;
+}
+
+/* Reads page UPAGE of region R into memory and maps it in PD.
+   Read-only pages share frames with other processes running the
+   same executable, and pages of nothing but zeros start out
+   mapped to the zero frame.  Returns false if memory allocation
+   or the disk read fails. */
+static bool
+load_region_page (uint32_t *pd, struct region *r, uint8_t *upage)
+{
+  size_t read_bytes = region_read_bytes (r, upage);
+  off_t ofs = r->ofs + (upage - r->start);
+  uint8_t *kpage;
+  bool private = false;
+
+  if (read_bytes == 0)
+    kpage = frame_get_zero ();
+  else if (!r->writable)
+    kpage = frame_get_shared (r->file, ofs, read_bytes);
+  else
+    {
+      kpage = frame_alloc (0);
+      if (kpage == NULL)
+        return false;
+      if (file_read_at (r->file, kpage, read_bytes, ofs)
+          != (off_t) read_bytes)
+        {
+          frame_free (kpage);
+          return false;
+        }
+      memset (kpage + read_bytes, 0, PGSIZE - read_bytes);
+      private = true;
+    }
+  if (kpage == NULL)
+    return false;
+
+  if (!pagedir_set_page (pd, upage, kpage, private))
+    {
+      frame_free (kpage);
+      return false;
+    }
+  if (private)
+    frame_own (kpage, upage);
+  else if (r->writable)
+    pagedir_set_cow (pd, upage);
+  process_add_resident (process_leader (thread_current ()), 1);
+  return true;
+}
+
+/* Handles a fault on UPAGE in region R by reading it in along
+   with the following pages of R, up to R's read-ahead window.
+   Returns false if UPAGE itself cannot be read in. */
+static bool
+fault_in_region (uint32_t *pd, struct region *r, uint8_t *upage)
+{
+  uint8_t *end = r->start + r->page_cnt * PGSIZE;
+  uint8_t *p;
+  size_t i;
+
+  file_fault_cnt++;
+  file_ahead_hits += readahead_update (&r->ra, pd, upage);
+
+  if (!load_region_page (pd, r, upage))
+    return false;
+
+  r->ra.start = p = upage + PGSIZE;
+  for (i = 1; i < r->ra.window && p < end && is_unmapped (pd, p);
+       i++, p += PGSIZE)
+    {
+      if (!load_region_page (pd, r, p))
+        break;
+      r->ra.cnt++;
+    }
+  file_ahead_cnt += r->ra.cnt;
+  return true;
+}
+
+/* Handles a fault on swapped-out page UPAGE by reading it back
+   in along with the swapped-out pages right after it, up to the
+   process's swap read-ahead window.  Returns false if UPAGE
+   itself cannot be read in. */
+static bool
+fault_in_swap (uint32_t *pd, struct vm_space *vm, uint8_t *upage)
+{
+  struct readahead *ra = &vm->swap_ra;
+  uint8_t *p;
+  size_t slot;
+  size_t i;
+
+  swap_fault_cnt++;
+  swap_ahead_hits += readahead_update (ra, pd, upage);
+
+  if (!frame_swap_in (upage))
+    return false;
+
+  ra->start = p = upage + PGSIZE;
+  for (i = 1; i < ra->window && is_user_vaddr (p)
+         && pagedir_get_swap (pd, p, &slot);
+       i++, p += PGSIZE)
+    {
+      if (!frame_swap_in (p))
+        break;
+      ra->cnt++;
+    }
+  swap_ahead_cnt += ra->cnt;
+  return true;
+}
+
+/* Returns true if UPAGE is neither mapped in PD nor swapped
+   out. */
+static bool
+is_unmapped (uint32_t *pd, const void *upage)
+{
+  size_t slot;
+  return (pagedir_get_page (pd, upage) == NULL
+          && !pagedir_get_swap (pd, upage, &slot));
+}
+
+/* Initializes RA. */
+static void
+readahead_init (struct readahead *ra)
+{
+  ra->window = READAHEAD_INIT;
+  ra->start = NULL;
+  ra->cnt = 0;
+}
+
+/* Called on a fault on UPAGE in the stream that RA tracks.
+   Checks how many of the pages that RA read ahead last time have
+   been accessed since, resizes RA's window accordingly, and
+   returns that number.  If nothing was read ahead last time, the
+   window grows again only if UPAGE follows the page that faulted
+   then, as in a sequential scan. */
+static long long
+readahead_update (struct readahead *ra, uint32_t *pd, const void *upage)
+{
+  size_t hits = 0;
+  bool useful;
+  size_t i;
+
+  for (i = 0; i < ra->cnt; i++)
+    if (pagedir_is_accessed (pd, ra->start + i * PGSIZE))
+      hits++;
+  if (ra->cnt > 0)
+    useful = hits * 2 >= ra->cnt;
+  else
+    useful = upage == ra->start;
+
+  if (useful)
+    ra->window = (ra->window * 2 < READAHEAD_MAX
+                  ? ra->window * 2 : READAHEAD_MAX);
+  else if (ra->cnt > 0)
+    ra->window = (ra->window / 2 > READAHEAD_MIN
+                  ? ra->window / 2 : READAHEAD_MIN);
+  ra->cnt = 0;
+  return hits;
+}
+
+/* Handles a write to copy-on-write page UPAGE in PD by giving PD
+   a private, writable frame with the same contents.  Returns
+   false if memory is exhausted. */
+static bool
+break_cow (uint32_t *pd, void *upage)
+{
+  void *kpage = pagedir_get_page (pd, upage);
+  void *private;
+
+  ASSERT (kpage != NULL);
+  private = frame_unshare (kpage);
+  if (private == NULL)
+    return false;
+  pagedir_replace_page (pd, upage, private, true);
+  frame_own (private, upage);
+  return true;
+}
+
+/* Returns true if an access to FAULT_ADDR looks like a push onto
+   the user stack whose stack pointer is ESP, and is within the
+   stack size limit.  PUSHA checks its 32 bytes of space before
+   it moves the stack pointer, so it can fault that far below
+   ESP; every other instruction faults at or above ESP - 4. */
+static bool
+is_stack_access (const void *fault_addr, const void *esp)
+{
+  const uint8_t *addr = fault_addr;
+  const uint8_t *stack_bottom
+    = (uint8_t *) PHYS_BASE - page_stack_limit * PGSIZE;
+
+  return (addr >= stack_bottom
+          && esp != NULL
+          && addr + 32 >= (const uint8_t *) esp);
+}
+
+/* Maps a zeroed page at UPAGE in PD to extend the stack.  If
+   the faulting access was a read, the page is mapped to the zero
+   frame, copy-on-write, and only gets memory of its own when it
+   is written.  Returns false if memory is exhausted. */
+static bool
+grow_stack (uint32_t *pd, void *upage, bool write)
+{
+  void *kpage = write ? frame_alloc (PAL_ZERO) : frame_get_zero ();
+
+  if (kpage == NULL)
+    return false;
+  if (!pagedir_set_page (pd, upage, kpage, write))
+    {
+      frame_free (kpage);
+      return false;
+    }
+  if (write)
+    frame_own (kpage, upage);
+  else
+    pagedir_set_cow (pd, upage);
+  process_add_resident (process_leader (thread_current ()), 1);
+  return true;
+}
@@ -0,0 +1,27 @@
+#ifndef VM_PAGE_H
+#define VM_PAGE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "filesys/off_t.h"
+
+struct file;
+struct thread;
+
+/* Maximum size of a user stack, in pages.
+   Controlled by kernel command-line option "-stk=PAGES". */
+extern size_t page_stack_limit;
+
+bool page_space_create (void);
+bool page_space_fork (const struct thread *parent);
+void page_space_destroy (void);
+bool page_add_region (struct file *, off_t ofs, uint8_t *upage,
+                      uint32_t read_bytes, uint32_t zero_bytes,
+                      bool writable);
+bool page_handle_fault (void *fault_addr, bool not_present, bool write,
+                        void *esp);
+bool page_in_region (const void *upage);
+void page_print_stats (void);
+
+#endif /* vm/page.h */
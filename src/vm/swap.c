@@ -0,0 +1,428 @@
+#include "vm/swap.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/block.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "vm/lz.h"
+
+/* Swap space.
+
+   Pages evicted from the frame table are stored in swap slots,
+   each of which can hold one page.  A slot's contents live in
+   one of two places:
+
+     - In the compressed cache: kernel memory holding the page
+       compressed by lz_compress().  Reading a page back from the
+       cache is a memory copy, where the swap device costs a
+       round trip through the disk driver for every sector.
+
+     - On the swap device, in the page-sized run of sectors that
+       corresponds to the slot number.
+
+   A page goes into the cache when it is written, if it
+   compresses well enough to save memory and the cache has room.
+   When the cache reaches its size limit, the pages that have
+   been in it longest are written to the swap device to make
+   room.  Pages that are read back or freed before that never
+   cost a disk write at all.  The cache lives in kernel memory,
+   so it is also written back, oldest first, when the kernel
+   pool runs out (see cache_scan()).
+
+   A slot may be referenced by more than one page table entry,
+   after fork(), so each slot has a reference count; it is freed
+   when the last reference is read back in or discarded. */
+
+/* Number of sectors per page. */
+#define PAGE_SECTORS (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* Pages that compress to more than this many bytes go straight
+   to disk.  Bigger blocks cost malloc() a whole page anyway. */
+#define CACHE_MAX_SIZE (PGSIZE / 4)
+
+/* A page held in compressed form. */
+struct cached_page
+  {
+    size_t slot;                /* Slot the page belongs to. */
+    size_t size;                /* Compressed size in bytes. */
+    uint8_t *data;              /* Compressed data. */
+    struct hash_elem elem;      /* Element in `cache'. */
+    struct list_elem lru_elem;  /* Element in `cache_lru'. */
+  };
+
+/* Default compressed cache size of 256 kB. */
+size_t swap_cache_pages = 64;
+
+/* The swap device, or a null pointer if there is none. */
+static struct block *swap_device;
+
+/* Number of slots, and each slot's reference count. */
+static size_t slot_cnt;
+static uint16_t *slot_refs;
+
+/* Slot at which to start looking for a free one. */
+static size_t next_slot;
+
+/* Protects `slot_refs' and `next_slot'.  Never held across disk
+   I/O, so that the frame table can reserve a slot while it is
+   locked without waiting for other pages to be swapped. */
+static struct lock slot_lock;
+
+/* Compressed cache, keyed by slot, and its pages, least recently
+   written first. */
+static struct hash cache;
+static struct list cache_lru;
+static size_t cache_bytes;              /* Sum of compressed sizes. */
+
+/* Buffers for compressing and for writing cached pages back. */
+static uint8_t compress_buf[CACHE_MAX_SIZE];
+static void *bounce_page;
+
+/* Protects the compressed cache, the buffers and the swap
+   device. */
+static struct lock swap_lock;
+
+/* Statistics. */
+static long long write_cnt;             /* # of pages written. */
+static long long read_cnt;              /* # of pages read. */
+static long long disk_write_cnt;        /* # of pages written to disk. */
+static long long disk_read_cnt;         /* # of pages read from disk. */
+static long long cache_store_cnt;       /* # of pages compressed. */
+static long long cache_stored_bytes;    /* Compressed sizes, summed. */
+static long long cache_hit_cnt;         /* # of reads from the cache. */
+static long long cache_writeback_cnt;   /* # of cached pages written. */
+
+static hash_hash_func cached_page_hash;
+static hash_less_func cached_page_less;
+static struct cached_page *lookup_cached (size_t slot);
+static bool cache_page (size_t slot, const void *kpage);
+static void uncache_page (struct cached_page *);
+static void write_back_oldest (void);
+static void write_to_disk (size_t slot, const void *kpage);
+static void put_slot (size_t slot);
+static size_t cache_count (void);
+static size_t cache_scan (size_t nr);
+
+/* Gives the compressed cache's memory back under pressure. */
+static struct shrinker cache_shrinker =
+  {
+    .flags = 0,
+    .count = cache_count,
+    .scan = cache_scan,
+  };
+
+/* Initializes swap space.  Without a swap device, there are no
+   slots and swap_reserve() always fails. */
+void
+swap_init (void)
+{
+  lock_init (&slot_lock);
+  lock_init (&swap_lock);
+  hash_init (&cache, cached_page_hash, cached_page_less, NULL);
+  list_init (&cache_lru);
+
+  swap_device = block_get_role (BLOCK_SWAP);
+  if (swap_device == NULL)
+    return;
+
+  slot_cnt = block_size (swap_device) / PAGE_SECTORS;
+  slot_refs = calloc (slot_cnt, sizeof *slot_refs);
+  bounce_page = palloc_get_page (0);
+  if (slot_refs == NULL || bounce_page == NULL)
+    PANIC ("no memory for swap table");
+  palloc_register_shrinker (&cache_shrinker);
+}
+
+/* Reserves a free swap slot, with one reference, and returns it.
+   Returns SWAP_ERROR if all slots are in use. */
+size_t
+swap_reserve (void)
+{
+  size_t slot = SWAP_ERROR;
+  size_t i;
+
+  lock_acquire (&slot_lock);
+  for (i = 0; i < slot_cnt; i++)
+    {
+      size_t candidate = (next_slot + i) % slot_cnt;
+      if (slot_refs[candidate] == 0)
+        {
+          slot_refs[candidate] = 1;
+          next_slot = candidate + 1;
+          slot = candidate;
+          break;
+        }
+    }
+  lock_release (&slot_lock);
+
+  return slot;
+}
+
+/* Stores the page at KPAGE into SLOT, which must have been
+   obtained from swap_reserve() and not yet written. */
+void
+swap_write (size_t slot, const void *kpage)
+{
+  ASSERT (slot < slot_cnt);
+
+  lock_acquire (&swap_lock);
+  ASSERT (slot_refs[slot] > 0);
+  ASSERT (lookup_cached (slot) == NULL);
+  if (!cache_page (slot, kpage))
+    write_to_disk (slot, kpage);
+  write_cnt++;
+  lock_release (&swap_lock);
+}
+
+/* Reads the page in SLOT into KPAGE and drops a reference to
+   SLOT. */
+void
+swap_read (size_t slot, void *kpage)
+{
+  struct cached_page *p;
+
+  ASSERT (slot < slot_cnt);
+
+  lock_acquire (&swap_lock);
+  ASSERT (slot_refs[slot] > 0);
+  p = lookup_cached (slot);
+  if (p != NULL)
+    {
+      if (!lz_decompress (p->data, p->size, kpage, PGSIZE))
+        PANIC ("swap slot %zu: compressed page is corrupt", slot);
+      cache_hit_cnt++;
+    }
+  else
+    {
+      block_sector_t sector = slot * PAGE_SECTORS;
+      size_t i;
+
+      for (i = 0; i < PAGE_SECTORS; i++)
+        block_read (swap_device, sector + i,
+                    (uint8_t *) kpage + i * BLOCK_SECTOR_SIZE);
+      disk_read_cnt++;
+    }
+  read_cnt++;
+  put_slot (slot);
+  lock_release (&swap_lock);
+}
+
+/* Adds a reference to SLOT, for a page table entry that refers
+   to it in addition to the existing ones. */
+void
+swap_dup (size_t slot)
+{
+  ASSERT (slot < slot_cnt);
+
+  lock_acquire (&slot_lock);
+  ASSERT (slot_refs[slot] > 0 && slot_refs[slot] < UINT16_MAX);
+  slot_refs[slot]++;
+  lock_release (&slot_lock);
+}
+
+/* Drops a reference to SLOT without reading it. */
+void
+swap_free (size_t slot)
+{
+  ASSERT (slot < slot_cnt);
+
+  lock_acquire (&swap_lock);
+  put_slot (slot);
+  lock_release (&swap_lock);
+}
+
+/* Prints swap statistics. */
+void
+swap_print_stats (void)
+{
+  long long avoided = cache_store_cnt - cache_writeback_cnt;
+
+  printf ("Swap: %lld pages written, %lld read, "
+          "%lld disk writes, %lld disk reads\n",
+          write_cnt, read_cnt, disk_write_cnt, disk_read_cnt);
+  printf ("Compressed swap: %zu pages in %zu bytes, "
+          "%lld%% of original size, %lld of %lld reads hit, "
+          "%lld disk writes avoided\n",
+          hash_size (&cache), cache_bytes,
+          cache_store_cnt > 0
+          ? cache_stored_bytes * 100 / (cache_store_cnt * PGSIZE) : 0,
+          cache_hit_cnt, read_cnt, avoided);
+}
+
+/* Returns the cached page for SLOT, or a null pointer if SLOT is
+   not in the compressed cache.  The swap lock must be held. */
+static struct cached_page *
+lookup_cached (size_t slot)
+{
+  struct cached_page key;
+  struct hash_elem *e;
+
+  key.slot = slot;
+  e = hash_find (&cache, &key.elem);
+  return e != NULL ? hash_entry (e, struct cached_page, elem) : NULL;
+}
+
+/* Tries to store the page at KPAGE into the compressed cache as
+   SLOT's contents, writing older pages back to disk if needed to
+   make room.  Returns false if the page does not compress well
+   enough or memory is short, in which case the caller must write
+   it to disk itself.  The swap lock must be held. */
+static bool
+cache_page (size_t slot, const void *kpage)
+{
+  size_t limit = swap_cache_pages * PGSIZE;
+  struct cached_page *p;
+  size_t size;
+
+  size = lz_compress (kpage, PGSIZE, compress_buf, sizeof compress_buf);
+  if (size == 0 || size > limit)
+    return false;
+  while (cache_bytes + size > limit)
+    write_back_oldest ();
+
+  p = malloc (sizeof *p);
+  if (p == NULL)
+    return false;
+  p->data = malloc (size);
+  if (p->data == NULL)
+    {
+      free (p);
+      return false;
+    }
+  memcpy (p->data, compress_buf, size);
+  p->slot = slot;
+  p->size = size;
+  hash_insert (&cache, &p->elem);
+  list_push_back (&cache_lru, &p->lru_elem);
+  cache_bytes += size;
+
+  cache_store_cnt++;
+  cache_stored_bytes += size;
+  return true;
+}
+
+/* Removes P from the compressed cache and frees it.  The swap
+   lock must be held. */
+static void
+uncache_page (struct cached_page *p)
+{
+  hash_delete (&cache, &p->elem);
+  list_remove (&p->lru_elem);
+  cache_bytes -= p->size;
+  free (p->data);
+  free (p);
+}
+
+/* Writes the page that has been in the compressed cache longest
+   to its slot on disk and removes it from the cache.  The swap
+   lock must be held. */
+static void
+write_back_oldest (void)
+{
+  struct cached_page *p;
+
+  ASSERT (!list_empty (&cache_lru));
+  p = list_entry (list_front (&cache_lru), struct cached_page, lru_elem);
+  if (!lz_decompress (p->data, p->size, bounce_page, PGSIZE))
+    PANIC ("swap slot %zu: compressed page is corrupt", p->slot);
+  write_to_disk (p->slot, bounce_page);
+  uncache_page (p);
+  cache_writeback_cnt++;
+}
+
+/* Writes the page at KPAGE to SLOT's sectors on the swap
+   device.  The swap lock must be held. */
+static void
+write_to_disk (size_t slot, const void *kpage)
+{
+  block_sector_t sector = slot * PAGE_SECTORS;
+  size_t i;
+
+  for (i = 0; i < PAGE_SECTORS; i++)
+    block_write (swap_device, sector + i,
+                 (const uint8_t *) kpage + i * BLOCK_SECTOR_SIZE);
+  disk_write_cnt++;
+}
+
+/* Drops a reference to SLOT, freeing it and discarding its
+   cached copy, if any, when no references remain.  The swap
+   lock must be held. */
+static void
+put_slot (size_t slot)
+{
+  bool last;
+
+  lock_acquire (&slot_lock);
+  ASSERT (slot_refs[slot] > 0);
+  last = slot_refs[slot] == 1;
+  if (!last)
+    slot_refs[slot]--;
+  lock_release (&slot_lock);
+
+  /* Discard the cached copy before the slot becomes free, so
+     that swap_reserve() cannot hand it out with the copy still
+     there.  Nobody else holds a reference to take a new one. */
+  if (last)
+    {
+      struct cached_page *p = lookup_cached (slot);
+      if (p != NULL)
+        uncache_page (p);
+
+      lock_acquire (&slot_lock);
+      slot_refs[slot] = 0;
+      lock_release (&slot_lock);
+    }
+}
+
+/* Returns the number of pages in the compressed cache.  Read
+   without the swap lock, so it is only an estimate. */
+static size_t
+cache_count (void)
+{
+  return hash_size (&cache);
+}
+
+/* Writes up to NR of the pages that have been in the compressed
+   cache longest back to disk, freeing their memory, and returns
+   the number written.  Gives up if the swap lock is busy, since
+   the allocation that called us may be made with it held. */
+static size_t
+cache_scan (size_t nr)
+{
+  size_t cnt = 0;
+
+  if (lock_held_by_current_thread (&swap_lock)
+      || !lock_try_acquire (&swap_lock))
+    return 0;
+  while (cnt < nr && !list_empty (&cache_lru))
+    {
+      write_back_oldest ();
+      cnt++;
+    }
+  lock_release (&swap_lock);
+
+  return cnt;
+}
+
+/* Returns a hash value for cached page E. */
+static unsigned
+cached_page_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct cached_page *p = hash_entry (e, struct cached_page, elem);
+  return hash_int (p->slot);
+}
+
+/* Returns true if cached page A precedes cached page B. */
+static bool
+cached_page_less (const struct hash_elem *a_, const struct hash_elem *b_,
+                  void *aux UNUSED)
+{
+  const struct cached_page *a = hash_entry (a_, struct cached_page, elem);
+  const struct cached_page *b = hash_entry (b_, struct cached_page, elem);
+  return a->slot < b->slot;
+}
@@ -0,0 +1,23 @@
+#ifndef VM_SWAP_H
+#define VM_SWAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Returned by swap_reserve() when swap is full. */
+#define SWAP_ERROR SIZE_MAX
+
+/* Kernel memory, in pages, that compressed swapped-out pages may
+   use before they are written to the swap device.
+   Controlled by kernel command-line option "-zswap=PAGES". */
+extern size_t swap_cache_pages;
+
+void swap_init (void);
+size_t swap_reserve (void);
+void swap_write (size_t slot, const void *kpage);
+void swap_read (size_t slot, void *kpage);
+void swap_dup (size_t slot);
+void swap_free (size_t slot);
+void swap_print_stats (void);
+
+#endif /* vm/swap.h */